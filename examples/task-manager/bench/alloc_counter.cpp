@@ -0,0 +1,61 @@
+// Global operator new replacement that counts heap allocations for the harness
+#include "bench.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#  include <malloc.h>
+#endif
+
+namespace {
+
+std::atomic<size_t> allocationCount{0};
+
+void* countedAlloc(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+    if (void* p = std::malloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* countedAlignedAlloc(std::size_t size, std::align_val_t align) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    auto alignment = static_cast<std::size_t>(align);
+    // aligned_alloc requires the size to be a multiple of the alignment
+    std::size_t rounded = (size + alignment - 1) / alignment * alignment;
+#ifdef _WIN32
+    if (void* p = _aligned_malloc(rounded ? rounded : alignment, alignment)) return p;
+#else
+    if (void* p = std::aligned_alloc(alignment, rounded ? rounded : alignment)) return p;
+#endif
+    throw std::bad_alloc();
+}
+
+}  // namespace
+
+size_t Bench::allocations() { return allocationCount.load(std::memory_order_relaxed); }
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try { return countedAlloc(size); } catch (...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try { return countedAlloc(size); } catch (...) { return nullptr; }
+}
+void* operator new(std::size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+#ifdef _WIN32
+#  define ALIGNED_FREE _aligned_free
+#else
+#  define ALIGNED_FREE std::free
+#endif
+void operator delete(void* p, std::align_val_t) noexcept { ALIGNED_FREE(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { ALIGNED_FREE(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { ALIGNED_FREE(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { ALIGNED_FREE(p); }
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "dataset.h"
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/// Minimal self-registering benchmark harness for the task-manager
+namespace Bench {
+
+// Heap allocations made so far by the process (counted by the operator new replacement)
+size_t allocations();
+
+struct Result {
+    std::string group;  // BENCH_CASE the result came from
+    std::string name;
+    size_t ops;
+    double nsPerOp;
+    double allocsPerOp;
+    double opsPerSec;
+    double bytesPerSec;  // 0 when the case does not report a byte volume
+};
+
+struct Check {
+    std::string group;
+    std::string name;
+    bool passed;
+};
+
+class Context {
+public:
+    Context(DatasetSpec spec, unsigned maxThreads) : spec_(spec), maxThreads_(maxThreads) {}
+
+    // Dataset shape requested on the command line (--size N, --seed S, ...)
+    const DatasetSpec& spec() const { return spec_; }
+    size_t size() const { return spec_.tasks; }
+    // Upper end of thread-scaling runs (--threads N, default: hardware threads)
+    unsigned maxThreads() const { return maxThreads_; }
+
+    // Time one call of body, which is expected to perform `ops` operations
+    // moving `bytes` bytes in total (for MB/s figures)
+    template <typename F>
+    void run(const std::string& name, size_t ops, F&& body, size_t bytes = 0) {
+        size_t allocsBefore = allocations();
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto end = std::chrono::steady_clock::now();
+        size_t allocs = allocations() - allocsBefore;
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        record(name, ops, ns, allocs, bytes);
+    }
+
+    // Record a pass/fail assertion; any failure makes the harness exit non-zero
+    void check(bool ok, const std::string& what);
+
+    void beginCase(const std::string& name) { group_ = name; }
+
+    const std::vector<Result>& results() const { return results_; }
+    const std::vector<Check>& checks() const { return checks_; }
+    const Result& last() const { return results_.back(); }
+    bool failed() const { return failed_; }
+
+private:
+    DatasetSpec spec_;
+    unsigned maxThreads_;
+    bool failed_ = false;
+    std::string group_;
+    std::vector<Result> results_;
+    std::vector<Check> checks_;
+
+    void record(const std::string& name, size_t ops, double ns, size_t allocs, size_t bytes);
+};
+
+using CaseFn = void (*)(Context&);
+
+struct Registrar {
+    Registrar(const char* name, CaseFn fn);
+};
+
+// Scratch file in the system temp directory, removed by the caller
+std::filesystem::path tempPath(const std::string& name);
+
+// A program in the harness's own directory (build/app/tm next to tm-bench),
+// or an empty path if there is none, e.g. in the optimized bench build
+std::filesystem::path siblingExecutable(const std::string& name);
+
+// Run args[0] with stdin from `input` (the null device if empty) and stdout
+// discarded; true if it exited with status 0. Always false on Windows.
+bool runProcess(const std::vector<std::string>& args, const std::filesystem::path& input = {});
+
+// Point stdout at the null device while alive (for cases that print)
+class SilenceStdout {
+public:
+    SilenceStdout();
+    ~SilenceStdout();
+    SilenceStdout(const SilenceStdout&) = delete;
+    SilenceStdout& operator=(const SilenceStdout&) = delete;
+
+private:
+    int saved_;
+};
+
+// Keep the optimizer from discarding a computed value
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+}  // namespace Bench
+
+#define BENCH_CASE(name)                                    \
+    static void bench_##name(Bench::Context&);              \
+    static Bench::Registrar registrar_##name(#name, bench_##name); \
+    static void bench_##name(Bench::Context& ctx)
@@ -0,0 +1,68 @@
+// Heap allocations per description on add and load
+//
+// Each measurement runs twice: once with descriptions that fit the small-string
+// buffer and once with long ones. Index and vector growth is identical in both
+// runs, so the difference divided by N is what each description costs.
+#include "bench.h"
+#include "storage.h"
+#include <fstream>
+#include <optional>
+#include <string>
+
+using json = nlohmann::json;
+
+static const size_t SHORT_LEN = 8;
+static const size_t LONG_LEN = 96;
+
+// One-off growth (e.g. the JSON lexer's token buffer) is amortized over N
+static const double TOLERANCE = 0.01;
+
+static size_t countAddAllocations(size_t n, size_t descLen) {
+    auto path = Bench::tempPath("alloc-add.json");
+    std::filesystem::remove(path);
+    Storage storage(path.string());
+    storage.setAutoSave(false);
+
+    size_t before = Bench::allocations();
+    for (size_t i = 0; i < n; ++i) {
+        storage.addTask(std::string(descLen, 'a'));  // The one allocation for long descriptions
+    }
+    size_t count = Bench::allocations() - before;
+    std::filesystem::remove(path);
+    return count;
+}
+
+static size_t countLoadAllocations(size_t n, size_t descLen) {
+    auto path = Bench::tempPath("alloc-load.json");
+    {
+        json tasks = json::array();
+        for (size_t i = 0; i < n; ++i) {
+            tasks.push_back({{"id", i + 1}, {"description", std::string(descLen, 'b')}, {"completed", false}});
+        }
+        std::ofstream(path) << json{{"tasks", tasks}, {"nextId", n + 1}};
+    }
+
+    std::optional<Storage> storage;
+    size_t before = Bench::allocations();
+    storage.emplace(path.string());
+    size_t count = Bench::allocations() - before;
+    std::filesystem::remove(path);
+    return count;
+}
+
+BENCH_CASE(allocations) {
+    const size_t n = ctx.size();
+    const double dn = static_cast<double>(n);
+
+    size_t addShort = countAddAllocations(n, SHORT_LEN);
+    size_t addLong = countAddAllocations(n, LONG_LEN);
+    double addPerDesc = (static_cast<double>(addLong) - static_cast<double>(addShort)) / dn;
+    std::printf("  %-40s %12.3f allocs/desc\n", "addTask", addPerDesc);
+    ctx.check(addPerDesc <= 1.0 + TOLERANCE, "addTask: <= 1 allocation per description");
+
+    size_t loadShort = countLoadAllocations(n, SHORT_LEN);
+    size_t loadLong = countLoadAllocations(n, LONG_LEN);
+    double loadPerDesc = (static_cast<double>(loadLong) - static_cast<double>(loadShort)) / dn;
+    std::printf("  %-40s %12.3f allocs/desc\n", "load", loadPerDesc);
+    ctx.check(loadPerDesc <= 1.0 + TOLERANCE, "load: <= 1 allocation per description");
+}
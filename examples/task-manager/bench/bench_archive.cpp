@@ -0,0 +1,75 @@
+// Archive tier: load/save cost before and after moving old completed tasks out
+// of the store, and on-demand search over the archive file
+#include "bench.h"
+#include "storage.h"
+#include "utils.h"
+#include <cstdio>
+#include <fstream>
+#include <optional>
+#include <string>
+
+BENCH_CASE(archive) {
+    auto path = Bench::tempPath("archive.json");
+    Bench::writeDataset(ctx.spec(), path);
+    std::optional<Storage> storage;
+    storage.emplace(path.string());
+    auto archivePath = storage->archivePath();
+    std::filesystem::remove(archivePath);
+
+    const size_t n = ctx.size();
+    ctx.run("load, everything active", n, [&] { storage->load(); }, static_cast<size_t>(std::filesystem::file_size(path)));
+    ctx.run("save, everything active", n, [&] { storage->save(); }, static_cast<size_t>(std::filesystem::file_size(path)));
+    const double fullSaveNs = ctx.last().nsPerOp * static_cast<double>(n);
+
+    // Generated completion times cover 2025; archive everything done before July
+    const std::int64_t cutoff = 1751328000;
+    std::vector<Task> expectedActive;
+    std::vector<Task> expectedArchived;
+    for (const auto& task : storage->getAllTasks()) {
+        bool old = task.isCompleted() && task.getCompletedAt() <= cutoff;
+        (old ? expectedArchived : expectedActive).push_back(task);
+    }
+
+    size_t moved = 0;
+    ctx.run("archiveCompleted", expectedArchived.size(), [&] { moved = storage->archiveCompleted(cutoff); });
+    ctx.check(moved == expectedArchived.size() && Bench::sameTasks(storage->getAllTasks(), expectedActive),
+              "archived tasks leave the store");
+    ctx.check(Bench::sameTasks(storage->getArchivedTasks(), expectedArchived), "archive round-trips the tasks");
+
+    const size_t active = storage->getTaskCount();
+    const auto activeBytes = static_cast<size_t>(std::filesystem::file_size(path));
+    ctx.run("load, after archiving", active, [&] { storage.emplace(path.string()); }, activeBytes);
+    ctx.check(Bench::sameTasks(storage->getAllTasks(), expectedActive), "load() skips the archive");
+    ctx.run("save, after archiving", active, [&] { storage->save(); }, activeBytes);
+    std::printf("  %-40s %11.2fx\n", "save cost vs everything active",
+                ctx.last().nsPerOp * static_cast<double>(active) / fullSaveNs);
+
+    const auto archiveBytes = static_cast<size_t>(std::filesystem::file_size(archivePath));
+    const std::string needle = "deploy";
+    auto matches = [&needle](const Task& task) { return Utils::containsIgnoreCase(task.getDescription(), needle); };
+    size_t found = 0;
+    ctx.run("search active (filter)", active, [&] { found = storage->filter(matches).size(); });
+    Bench::doNotOptimize(found);
+    ctx.run("search archive (stream)", expectedArchived.size(),
+            [&] { found = storage->searchArchive(matches).size(); }, archiveBytes);
+    size_t expectedFound = 0;
+    for (const auto& task : expectedArchived) {
+        if (matches(task)) ++expectedFound;
+    }
+    ctx.check(found == expectedFound, "archive search finds every match");
+
+    // An interrupted append leaves a torn last line; it is skipped and does not
+    // corrupt the records appended after it
+    {
+        std::ofstream ofs(archivePath, std::ios::binary | std::ios::app);
+        ofs << "{\"completed\":true,\"completedAt\":17";
+    }
+    size_t completedLeft = storage->countIf([](const Task& task) { return task.isCompleted(); });
+    size_t movedAll = storage->archiveCompleted(cutoff + 365 * 86400);
+    ctx.check(movedAll == completedLeft && storage->getArchivedTasks().size() == expectedArchived.size() + completedLeft,
+              "torn archive tail is skipped");
+
+    storage.reset();
+    std::filesystem::remove(path);
+    std::filesystem::remove(archivePath);
+}
@@ -0,0 +1,192 @@
+// Binary record store: in-place single-record updates against full JSON rewrites
+#include "bench.h"
+#include "binary_store.h"
+#include "storage.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+
+static void removeStore(const std::filesystem::path& path) {
+    std::filesystem::remove(path);
+    std::filesystem::remove(path.string() + ".heap");
+}
+
+// Each loaded task is its version in `before` or in `after`, and none that
+// both have is missing
+static bool oldOrNew(const std::vector<Task>& loaded, const std::vector<Task>& before, const std::vector<Task>& after) {
+    auto find = [](const std::vector<Task>& tasks, int id) -> const Task* {
+        auto it = std::find_if(tasks.begin(), tasks.end(), [id](const Task& t) { return t.getId() == id; });
+        return it == tasks.end() ? nullptr : &*it;
+    };
+    for (const Task& task : loaded) {
+        const Task* old = find(before, task.getId());
+        const Task* now = find(after, task.getId());
+        if (!(old && Bench::sameTasks({task}, {*old})) && !(now && Bench::sameTasks({task}, {*now}))) return false;
+    }
+    for (const Task& task : before) {
+        if (find(after, task.getId()) && !find(loaded, task.getId())) return false;
+    }
+    return true;
+}
+
+BENCH_CASE(binary_store) {
+    const size_t n = ctx.size();
+    auto jsonPath = Bench::tempPath("binary-store.json");
+    auto binPath = Bench::tempPath("binary-store.bin");
+    Bench::writeDataset(ctx.spec(), jsonPath);
+    removeStore(binPath);
+
+    std::optional<Storage> json;
+    json.emplace(jsonPath.string());
+    {
+        Storage bin(binPath.string());
+        bin.setAutoSave(false);
+        for (const auto& task : json->getAllTasks()) {
+            int id = bin.addTask(std::string(task.getDescription()));
+            bin.setPriority(id, task.getPriority());
+            if (task.hasDue()) bin.setDue(id, task.getDue());
+            for (const auto& tag : task.getTags()) bin.addTag(id, tag);
+            if (task.isCompleted()) bin.completeTask(id);
+        }
+        bin.forEachIf([](const Task& task) { return task.isCompleted(); },
+                      [&](Task& task) { task.setCompletedAt(json->findTaskById(task.getId()).getCompletedAt()); });
+        Bench::SilenceStdout quiet;
+        bin.save();
+    }
+    const auto binBytes = static_cast<size_t>(std::filesystem::file_size(binPath) +
+                                              std::filesystem::file_size(binPath.string() + ".heap"));
+    std::optional<Storage> bin;
+    ctx.run("binary load", n, [&] { bin.emplace(binPath.string()); }, binBytes);
+    ctx.check(Bench::sameTasks(bin->getAllTasks(), json->getAllTasks()), "binary store round-trips the dataset");
+
+    // Pending tasks to complete, spread over the file
+    std::vector<int> pending;
+    for (const auto& task : json->getAllTasks()) {
+        if (!task.isCompleted()) pending.push_back(task.getId());
+    }
+    Bench::Rng rng(ctx.spec().seed);
+    for (size_t i = pending.size(); i > 1; --i) std::swap(pending[i - 1], pending[rng.below(i)]);
+
+    const size_t jsonOps = std::min<size_t>(10, pending.size());
+    ctx.run("completeTask + JSON save", jsonOps, [&] {
+        for (size_t i = 0; i < jsonOps; ++i) json->completeTask(pending[i]);
+    });
+    const double jsonNs = ctx.last().nsPerOp;
+
+    const BinaryStore& store = *bin->binaryStore();
+    auto before = store.stats();
+    bin->completeTask(pending[0]);
+    auto after = store.stats();
+    ctx.check(after.writeCalls - before.writeCalls == 1 && after.bytesWritten - before.bytesWritten == BinaryStore::RECORD_SIZE,
+              "completeTask writes one 48-byte record");
+
+    const size_t binOps = std::min<size_t>(10000, pending.size() - 1);
+    ctx.run("completeTask + binary flush", binOps, [&] {
+        for (size_t i = 1; i <= binOps; ++i) bin->completeTask(pending[i]);
+    });
+    std::printf("  %-40s %11.0fx\n", "speedup vs JSON save", jsonNs / ctx.last().nsPerOp);
+
+    before = store.stats();
+    int added = bin->addTask("Appended by the binary store benchmark");
+    bin->addTag(added, "bench");
+    after = store.stats();
+    ctx.check(after.writeCalls - before.writeCalls == 6, "add + tag: heap, record and header writes only");
+    ctx.run("addTask + binary flush", 1000, [&] {
+        for (int i = 0; i < 1000; ++i) bin->addTask("Appended task " + std::to_string(i));
+    });
+
+    // Deletes leave tombstones until garbage outweighs live records
+    std::vector<int> ids;
+    for (const auto& task : bin->getAllTasks()) ids.push_back(task.getId());
+    const size_t deletes = std::min<size_t>(ids.size() - 1, 2000);
+    ctx.run("deleteTask + binary flush", deletes, [&] {
+        for (size_t i = 0; i < deletes; ++i) bin->deleteTask(ids[ids.size() - 1 - i]);
+    });
+
+    std::vector<Task> expected = bin->getAllTasks();
+    Storage reloaded(binPath.string());
+    ctx.check(Bench::sameTasks(reloaded.getAllTasks(), expected), "reload after in-place updates matches memory");
+    auto stats = reloaded.binaryStore()->stats();
+    std::printf("  %-40s %6zu live %6zu dead %8.1f KiB garbage\n", "store after updates", stats.liveRecords,
+                stats.deadRecords, static_cast<double>(stats.heapGarbage) / 1024.0);
+
+    // Bulk edits rewrite (compact) the whole store
+    bin->forEachIf([](const Task& t) { return t.getId() % 2 == 0; }, [](Task& t) { t.setPriority(9); });
+    ctx.check(bin->binaryStore()->stats().deadRecords == 0 && bin->binaryStore()->stats().heapGarbage == 0,
+              "bulk edit compacts the store");
+    expected = bin->getAllTasks();
+    bin.reset();
+    Storage compacted(binPath.string());
+    ctx.check(Bench::sameTasks(compacted.getAllTasks(), expected), "reload after compaction matches memory");
+
+    // Flushes and compactions cut short after each of their writes and renames
+    const auto sample = static_cast<std::ptrdiff_t>(std::min<size_t>(expected.size(), 64));
+    const std::vector<Task> original(expected.begin(), expected.begin() + sample);
+    if (original.size() >= 8) {
+        const int originalNextId = original.back().getId() + 1;
+        const int tagged = original[1].getId();    // In place, pointing at new heap bytes
+        const int reprioritized = original[5].getId();  // In place
+        const int deleted = original[3].getId();   // Tombstone
+        std::vector<Task> edited = original;
+        edited[1].addTag("crash-check");
+        edited[5].setPriority(static_cast<std::uint8_t>((edited[5].getPriority() + 1) % 10));
+        edited.erase(edited.begin() + 3);
+        edited.emplace_back(originalNextId, "Added by the crash check");  // Appended
+        const int editedNextId = originalNextId + 1;
+        auto findEdited = [&](int id) -> const Task* {
+            auto it = std::find_if(edited.begin(), edited.end(), [id](const Task& t) { return t.getId() == id; });
+            return it == edited.end() ? nullptr : &*it;
+        };
+        auto crashPath = Bench::tempPath("binary-store-crash.bin");
+        auto reload = [&](std::vector<Task>& tasks) {
+            try {
+                BinaryStore store(crashPath);
+                int nextId = 0;
+                store.load(tasks, nextId);
+                return true;
+            } catch (const std::runtime_error&) {
+                return false;
+            }
+        };
+
+        bool flushes = true;
+        bool compactions = true;
+        for (size_t steps = 0; steps < 64; ++steps) {
+            bool done[2] = {false, false};
+            for (int compact = 0; compact < 2; ++compact) {
+                removeStore(crashPath);
+                {
+                    BinaryStore store(crashPath);
+                    store.rewrite(original, originalNextId);
+                    store.markDirty(tagged, BinaryStore::STRINGS);
+                    store.markDirty(reprioritized, BinaryStore::FIELDS);
+                    store.markDirty(deleted, BinaryStore::DELETED);
+                    store.markDirty(originalNextId, BinaryStore::ADDED);
+                    store.interruptAfter(steps);
+                    try {
+                        if (compact) store.rewrite(edited, editedNextId);
+                        else store.flush(findEdited, editedNextId);
+                        done[compact] = true;
+                    } catch (const std::runtime_error&) {
+                    }
+                }
+                std::vector<Task> loaded;
+                bool& ok = compact ? compactions : flushes;
+                if (!reload(loaded)) ok = false;
+                else if (compact) ok = ok && (Bench::sameTasks(loaded, original) || Bench::sameTasks(loaded, edited));
+                else ok = ok && oldOrNew(loaded, original, edited);
+                if (done[compact]) ok = ok && Bench::sameTasks(loaded, edited);
+            }
+            if (done[0] && done[1]) break;
+        }
+        ctx.check(flushes, "a flush cut short leaves each task old or new");
+        ctx.check(compactions, "a compaction cut short leaves the old or the new store");
+        removeStore(crashPath);
+    }
+
+    json.reset();
+    std::filesystem::remove(jsonPath);
+    removeStore(binPath);
+}
@@ -0,0 +1,104 @@
+// Bloom filters: false-positive rate and lookup latency at 10M keys, and
+// archive point lookups answered by the filters instead of a file scan
+#include "bench.h"
+#include "bloom_filter.h"
+#include "storage.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+BENCH_CASE(bloom) {
+    const size_t keys = 10000000;
+    const size_t probes = 1000000;
+    BloomFilter filter(keys, 0.01);
+    ctx.run("BloomFilter::add", keys, [&] {
+        for (size_t i = 0; i < keys; ++i) filter.add(BloomFilter::hash(static_cast<std::int64_t>(i)));
+    });
+    std::printf("  %-40s %11.2f bits/key, %u hashes\n", "filter size",
+                static_cast<double>(filter.bitCount()) / static_cast<double>(keys), filter.hashCount());
+
+    size_t hits = 0;
+    ctx.run("mightContain, present keys", probes, [&] {
+        for (size_t i = 0; i < probes; ++i) {
+            if (filter.mightContain(BloomFilter::hash(static_cast<std::int64_t>(i * (keys / probes))))) ++hits;
+        }
+    });
+    ctx.check(hits == probes, "no false negatives");
+
+    size_t falsePositives = 0;
+    ctx.run("mightContain, absent keys", probes, [&] {
+        for (size_t i = 0; i < probes; ++i) {
+            if (filter.mightContain(BloomFilter::hash(static_cast<std::int64_t>(keys + i)))) ++falsePositives;
+        }
+    });
+    const double rate = static_cast<double>(falsePositives) / static_cast<double>(probes);
+    std::printf("  %-40s %11.3f%% (target 1%%)\n", "false-positive rate", rate * 100.0);
+    ctx.check(rate < 0.015, "false-positive rate near target");
+
+    std::string encoded;
+    filter.write(encoded);
+    BloomFilter restored;
+    std::string_view in = encoded;
+    bool same = restored.read(in) && in.empty() && restored.size() == filter.size();
+    for (size_t i = 0; same && i < probes; ++i) {
+        auto key = BloomFilter::hash(static_cast<std::int64_t>(keys / 2 + i));
+        same = restored.mightContain(key) == filter.mightContain(key);
+    }
+    ctx.check(same, "filter round-trips through write/read");
+
+    // Archive lookups: misses should not touch the archive file
+    auto path = Bench::tempPath("bloom.json");
+    Bench::writeDataset(ctx.spec(), path);
+    Storage storage(path.string());
+    const auto archivePath = storage.archivePath();
+    std::filesystem::remove(archivePath);
+    std::filesystem::remove(archivePath.string() + ".bloom");
+    std::vector<int> archivedIds;
+    for (const auto& task : storage.getAllTasks()) {
+        if (task.isCompleted()) archivedIds.push_back(task.getId());
+    }
+    storage.archiveCompleted(2000000000);
+    const int missingId = static_cast<int>(ctx.size()) + 1000;
+
+    const size_t scans = 20;
+    size_t found = 0;
+    ctx.run("archive scan for an absent id", scans, [&] {
+        for (size_t i = 0; i < scans; ++i) {
+            found += storage.searchArchive([&](const Task& task) { return task.getId() == missingId; }).size();
+        }
+    });
+    const double scanNs = ctx.last().nsPerOp;
+    const size_t lookups = 100000;
+    ctx.run("findArchived, absent ids", lookups, [&] {
+        for (size_t i = 0; i < lookups; ++i) {
+            if (storage.findArchived(missingId + static_cast<int>(i))) ++found;
+        }
+    });
+    std::printf("  %-40s %11.0fx\n", "speedup vs scanning the archive", scanNs / ctx.last().nsPerOp);
+    ctx.check(found < lookups / 50, "absent ids rarely reach the archive");
+
+    bool allFound = !archivedIds.empty();
+    for (size_t i = 0; i < archivedIds.size(); i += archivedIds.size() / 16 + 1) {
+        auto task = storage.findArchived(archivedIds[i]);
+        allFound = allFound && task && task->getId() == archivedIds[i] &&
+                   storage.isArchivedDescription(task->getDescription());
+    }
+    ctx.check(allFound, "archived ids and descriptions are found");
+
+    // A record appended behind the filters' back makes them stale; the next
+    // store to open them notices the size change and rebuilds
+    {
+        std::ofstream ofs(archivePath, std::ios::binary | std::ios::app);
+        std::string line;
+        Task extra(missingId, "appended by hand", true);
+        TaskJson::writeLine(line, extra);
+        ofs << line;
+    }
+    Storage reopened(path.string());
+    ctx.check(reopened.findArchived(missingId).has_value() && reopened.isArchivedDescription("appended by hand"),
+              "stale filters are rebuilt");
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(archivePath);
+    std::filesystem::remove(archivePath.string() + ".bloom");
+}
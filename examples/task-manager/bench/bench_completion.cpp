@@ -0,0 +1,151 @@
+// Completion checks from reader threads while one writer completes and
+// reopens tasks: the wait-free completion bitset against findTask() under a
+// reader-writer lock, and snapshot() consistency across two tasks
+#include "bench.h"
+#include "storage.h"
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using State = CompletionBits::State;
+
+// Complete the task if it is pending, reopen it if it is completed
+void toggle(Storage& storage, int id) {
+    if (storage.findTaskById(id).isCompleted()) {
+        storage.reopenTask(id);
+    } else {
+        storage.completeTask(id);
+    }
+}
+
+}  // namespace
+
+BENCH_CASE(completion) {
+    const auto root = Bench::tempPath("completion");
+    std::filesystem::remove_all(root);
+    Storage storage((root / "tasks.json").string());
+    storage.setAutoSave(false);
+    const int tasks = static_cast<int>(ctx.size());
+    for (int i = 0; i < tasks; ++i) {
+        const int id = storage.addTask("Polled task " + std::to_string(i));
+        if (i % 3 == 0) storage.completeTask(id);
+    }
+    const CompletionBits& bits = storage.completionState();
+
+    const size_t reads = 2000000;
+    size_t completed = 0;
+    ctx.run("state(), one thread", reads, [&] {
+        for (size_t i = 0; i < reads; ++i) completed += bits.isCompleted(static_cast<int>(i % ctx.size()) + 1);
+    });
+    size_t viaTask = 0;
+    ctx.run("findTask()->isCompleted(), one thread", reads, [&] {
+        for (size_t i = 0; i < reads; ++i) viaTask += storage.findTask(static_cast<int>(i % ctx.size()) + 1)->isCompleted();
+    });
+    ctx.check(completed == viaTask, "the bitset agrees with the tasks");
+
+    // One writer toggling random tasks while every reader polls its own
+    for (const size_t readers : {size_t{1}, size_t{2}, size_t{4}, size_t{8}}) {
+        double nsPerRead[2] = {};
+        const size_t perReader = reads / readers;
+        for (const bool locked : {false, true}) {
+            std::shared_mutex mutex;
+            std::atomic<size_t> running{readers};
+            size_t toggles = 0;
+            std::atomic<size_t> seen{0};
+            const std::string name = std::string(locked ? "shared_mutex + findTask" : "state()") + ", " +
+                                     std::to_string(readers) + " reader" + (readers > 1 ? "s" : "");
+            ctx.run(name, perReader * readers, [&] {
+                std::vector<std::thread> threads;
+                for (size_t r = 0; r < readers; ++r) {
+                    threads.emplace_back([&, r] {
+                        Bench::Rng rng(r + 1);
+                        size_t count = 0;
+                        for (size_t i = 0; i < perReader; ++i) {
+                            const int id = static_cast<int>(rng.below(ctx.size())) + 1;
+                            if (locked) {
+                                std::shared_lock lock(mutex);
+                                const Task* task = storage.findTask(id);
+                                count += task && task->isCompleted();
+                            } else {
+                                count += bits.isCompleted(id);
+                            }
+                        }
+                        seen += count;
+                        --running;
+                    });
+                }
+                Bench::Rng rng(99);
+                while (running.load() > 0) {
+                    const int id = static_cast<int>(rng.below(ctx.size())) + 1;
+                    std::unique_lock lock(mutex, std::defer_lock);
+                    if (locked) lock.lock();
+                    toggle(storage, id);
+                    ++toggles;
+                }
+                for (auto& thread : threads) thread.join();
+            });
+            nsPerRead[locked] = ctx.last().nsPerOp;
+            Bench::doNotOptimize(seen.load());
+            std::printf("  %-40s %8zu toggles meanwhile\n", "  writer", toggles);
+        }
+        ctx.check(nsPerRead[0] < nsPerRead[1], "state() beats the lock, " + std::to_string(readers) + " readers");
+    }
+    bool agree = true;
+    for (const Task& task : storage.getAllTasks()) {
+        if (bits.state(task.getId()) != (task.isCompleted() ? State::Completed : State::Pending)) agree = false;
+    }
+    ctx.check(agree && bits.state(0) == State::Missing && bits.state(tasks + 1) == State::Missing,
+              "after the writer stops, every state matches its task");
+
+    // The writer only completes B after A and reopens A after B, so "A
+    // pending, B completed" never holds; snapshot() must never see it
+    const int a = 1;
+    const int b = 2;
+    if (storage.findTaskById(a).isCompleted()) storage.reopenTask(a);
+    if (storage.findTaskById(b).isCompleted()) storage.reopenTask(b);
+    std::atomic<bool> writing{true};
+    std::atomic<size_t> torn{0};
+    std::atomic<size_t> tornPlain{0};
+    const size_t pairs = 500000;
+    ctx.run("snapshot() of 2 tasks, 2 readers", pairs * 2, [&] {
+        std::vector<std::thread> threads;
+        for (int r = 0; r < 2; ++r) {
+            threads.emplace_back([&] {
+                const int ids[] = {a, b};
+                std::vector<State> states;
+                size_t bad = 0;
+                size_t badPlain = 0;
+                for (size_t i = 0; i < pairs; ++i) {
+                    bits.snapshot(ids, states);
+                    bad += states[0] == State::Pending && states[1] == State::Completed;
+                    // Two separate reads can straddle writes
+                    const State first = bits.state(a);
+                    badPlain += first == State::Pending && bits.state(b) == State::Completed;
+                }
+                torn += bad;
+                tornPlain += badPlain;
+            });
+        }
+        std::thread writer([&] {
+            while (writing.load()) {
+                storage.completeTask(a);
+                storage.completeTask(b);
+                storage.reopenTask(b);
+                storage.reopenTask(a);
+            }
+        });
+        for (auto& thread : threads) thread.join();
+        writing = false;
+        writer.join();
+    });
+    std::printf("  %-40s %zu in snapshots, %zu in plain reads\n", "torn pairs seen", torn.load(), tornPlain.load());
+    ctx.check(torn.load() == 0, "snapshot() never sees a torn pair");
+
+    std::filesystem::remove_all(root);
+}
@@ -0,0 +1,119 @@
+// Duplicate detection: hashing + MinHash/LSH at the dataset size and at 1M
+// tasks, recall against a brute-force pairwise compare, and merging
+#include "bench.h"
+#include "dedupe.h"
+#include "storage.h"
+#include <cstdio>
+#include <string>
+
+// Dataset tasks, about a fifth of them followed by a copy that differs only
+// in case and spacing (exact after normalization) or by a small edit (near)
+static std::vector<Task> tasksWithDuplicates(const Bench::DatasetSpec& spec) {
+    auto generated = Bench::generateTasks(spec);
+    Bench::Rng rng(spec.seed + 1);
+    std::vector<Task> tasks;
+    tasks.reserve(generated.size() + generated.size() / 4);
+    int id = 1;
+    for (auto& g : generated) {
+        std::string copy = g.description;
+        tasks.emplace_back(id++, std::move(g.description));
+        if (rng.below(10) >= 2) continue;
+        if (rng.below(2)) {
+            for (auto& c : copy) {
+                if (c >= 'a' && c <= 'z' && rng.below(4) == 0) c = static_cast<char>(c - 'a' + 'A');
+            }
+            copy = "  " + copy;
+        } else if (copy.size() > 30) {
+            copy[rng.below(copy.size())] = '#';  // One changed character
+        } else {
+            copy += " asap";
+        }
+        tasks.emplace_back(id++, std::move(copy));
+    }
+    return tasks;
+}
+
+BENCH_CASE(dedupe) {
+    auto tasks = tasksWithDuplicates(ctx.spec());
+    std::vector<Dedupe::Group> groups;
+    ctx.run("Dedupe::findGroups", tasks.size(), [&] { groups = Dedupe::findGroups(tasks); });
+    size_t duplicates = 0;
+    for (const auto& group : groups) duplicates += group.ids.size() - 1;
+    std::printf("  %-40s %6zu groups, %zu duplicates\n", "found", groups.size(), duplicates);
+
+    // Recall on a sample: every pair the O(N^2) compare accepts must share a group
+    const size_t sample = std::min<size_t>(tasks.size(), 1500);
+    std::vector<Task> pool(tasks.begin(), tasks.begin() + static_cast<std::ptrdiff_t>(sample));
+    auto poolGroups = Dedupe::findGroups(pool);
+    std::vector<int> groupOf(tasks.size() + 1, -1);
+    for (size_t g = 0; g < poolGroups.size(); ++g) {
+        for (int id : poolGroups[g].ids) groupOf[static_cast<size_t>(id)] = static_cast<int>(g);
+    }
+    std::vector<std::string> normalized;
+    for (const auto& task : pool) normalized.push_back(Dedupe::normalize(task.getDescription()));
+    size_t pairs = 0;
+    size_t missed = 0;
+    size_t exactMissed = 0;
+    ctx.run("brute-force pairwise compare", pool.size() * (pool.size() - 1) / 2, [&] {
+        for (size_t i = 0; i < pool.size(); ++i) {
+            for (size_t j = i + 1; j < pool.size(); ++j) {
+                bool exact = normalized[i] == normalized[j];
+                if (!exact && Dedupe::similarity(normalized[i], normalized[j]) < 0.8) continue;
+                ++pairs;
+                int a = groupOf[static_cast<size_t>(pool[i].getId())];
+                if (a < 0 || a != groupOf[static_cast<size_t>(pool[j].getId())]) {
+                    ++missed;
+                    if (exact) ++exactMissed;
+                }
+            }
+        }
+    });
+    std::printf("  %-40s %6zu / %zu pairs\n", "brute-force pairs missed by LSH", missed, pairs);
+    ctx.check(pairs > 0 && exactMissed == 0, "every exact duplicate is grouped");
+    ctx.check(missed * 20 <= pairs, "near-duplicate recall >= 95%");
+    const double pairNs = ctx.last().nsPerOp;
+
+    Bench::DatasetSpec big = ctx.spec();
+    big.tasks = 1000000;
+    auto million = tasksWithDuplicates(big);
+    ctx.run("Dedupe::findGroups, 1M tasks", million.size(), [&] { groups = Dedupe::findGroups(million); });
+    const double millionSeconds = ctx.last().nsPerOp * static_cast<double>(million.size()) * 1e-9;
+    const double pairwiseSeconds = pairNs * static_cast<double>(million.size()) * static_cast<double>(million.size()) * 0.5e-9;
+    std::printf("  %-40s %11.1f s (pairwise: ~%.0f s)\n", "1M tasks", millionSeconds, pairwiseSeconds);
+    ctx.check(millionSeconds * 1000 < pairwiseSeconds, "1M tasks: >1000x faster than pairwise");
+    million = {};
+
+    // Merge through Storage: one save, duplicates gone, keeper keeps their tags
+    auto path = Bench::tempPath("dedupe.json");
+    std::filesystem::remove(path);
+    {
+        Storage storage(path.string());
+        storage.setAutoSave(false);
+        for (const auto& task : tasks) storage.addTask(std::string(task.getDescription()));
+        storage.addTag(static_cast<int>(tasks.size()), "dupe");
+        {
+            Bench::SilenceStdout quiet;
+            storage.save();
+        }
+        storage.setAutoSave(true);
+        groups = Dedupe::findGroups(storage.getAllTasks());
+        size_t expected = 0;
+        int keeperOfLast = 0;
+        std::vector<std::vector<int>> ids;
+        for (const auto& group : groups) {
+            expected += group.ids.size() - 1;
+            if (group.ids.back() == static_cast<int>(tasks.size())) keeperOfLast = group.ids.front();
+            ids.push_back(group.ids);
+        }
+        size_t removed = 0;
+        ctx.run("Storage::mergeTasks", expected, [&] { removed = storage.mergeTasks(ids); });
+        ctx.check(removed == expected && storage.getTaskCount() == tasks.size() - expected, "merge deletes duplicates");
+        // Buckets change once duplicates are gone, so a second pass can pair a
+        // few texts whose first-pass bucket leader matched neither
+        size_t again = Dedupe::findGroups(storage.getAllTasks()).size();
+        std::printf("  %-40s %6zu groups\n", "second pass", again);
+        ctx.check(again * 50 <= groups.size(), "second pass finds < 2% more");
+        ctx.check(keeperOfLast == 0 || storage.findTaskById(keeperOfLast).hasTag("dupe"), "merge keeps tags");
+    }
+    std::filesystem::remove(path);
+}
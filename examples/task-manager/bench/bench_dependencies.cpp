@@ -0,0 +1,179 @@
+// Dependency scheduling on a million tasks and ten million edges: bulk load,
+// completing and reopening ready tasks (incremental Kahn updates) against a
+// from-scratch recompute, `next` queries, and single edges with their cycle check
+#include "bench.h"
+#include "storage.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Edge = DependencyGraph::Edge;
+
+// Ready tasks recomputed from the tasks and edges alone, in ID order
+std::vector<int> readyFromScratch(const std::vector<Task>& tasks, const std::vector<Edge>& edges) {
+    const int maxId = tasks.empty() ? 0 : tasks.back().getId();
+    std::vector<char> pending(static_cast<size_t>(maxId) + 1, 0);
+    for (const Task& task : tasks) pending[static_cast<size_t>(task.getId())] = !task.isCompleted();
+    std::vector<char> blocked(pending.size(), 0);
+    for (const auto& [blocker, dependent] : edges) {
+        if (pending[static_cast<size_t>(blocker)]) blocked[static_cast<size_t>(dependent)] = 1;
+    }
+    std::vector<int> ready;
+    for (const Task& task : tasks) {
+        const auto id = static_cast<size_t>(task.getId());
+        if (pending[id] && !blocked[id]) ready.push_back(task.getId());
+    }
+    return ready;
+}
+
+bool readyMatches(const Storage& storage) {
+    auto ready = storage.dependencies().ready(storage.getTaskCount());
+    std::sort(ready.begin(), ready.end());
+    return ready == readyFromScratch(storage.getAllTasks(), storage.dependencies().edges()) &&
+           ready.size() == storage.dependencies().readyCount();
+}
+
+}  // namespace
+
+BENCH_CASE(dependencies) {
+    const auto root = Bench::tempPath("dependencies");
+    std::filesystem::remove_all(root);
+    Storage storage((root / "tasks.json").string());
+    storage.setAutoSave(false);
+    const size_t tasks = 1000000;
+    Bench::Rng rng(48);
+    for (size_t i = 0; i < tasks; ++i) {
+        const int id = storage.addTask("Scheduled task " + std::to_string(i));
+        storage.setPriority(id, static_cast<int>(rng.below(10)));
+    }
+    // A random DAG: each task waits for 0-20 earlier ones, 10 on average
+    std::vector<Edge> edges;
+    edges.reserve(tasks * 10);
+    for (int id = 2; id <= static_cast<int>(tasks); ++id) {
+        const size_t count = rng.below(21);
+        for (size_t i = 0; i < count; ++i) edges.emplace_back(1 + static_cast<int>(rng.below(static_cast<size_t>(id - 1))), id);
+    }
+    size_t added = 0;
+    ctx.run("addDependencies(), 10M edges", edges.size(), [&] { added = storage.addDependencies(edges); });
+    const DependencyGraph& graph = storage.dependencies();
+    std::printf("  %-40s %zu edges, %zu ready, %.1f bytes/edge\n", "graph", graph.edgeCount(), graph.readyCount(),
+                static_cast<double>(graph.memoryBytes()) / static_cast<double>(graph.edgeCount()));
+    ctx.check(added == graph.edgeCount() && added > tasks * 9, "bulk load keeps every distinct edge");
+    ctx.check(readyMatches(storage), "ready tasks after the load match a recompute");
+
+    // Work through the schedule the way a user would: always take what is ready
+    const size_t steps = 200000;
+    std::vector<int> done;
+    done.reserve(steps);
+    ctx.run("completeTask() of a ready task", steps, [&] {
+        while (done.size() < steps) {
+            const auto batch = graph.ready(std::min<size_t>(1000, steps - done.size()));
+            if (batch.empty()) break;
+            for (int id : batch) storage.completeTask(id);
+            done.insert(done.end(), batch.begin(), batch.end());
+        }
+    });
+    const double completeNs = ctx.last().nsPerOp;
+    ctx.check(done.size() == steps, "the schedule never runs dry");
+    ctx.check(readyMatches(storage), "ready tasks after completing match a recompute");
+
+    const auto all = graph.edges();
+    std::vector<int> scratch;
+    ctx.run("recompute ready tasks from scratch", 1, [&] { scratch = readyFromScratch(storage.getAllTasks(), all); });
+    Bench::doNotOptimize(scratch.size());
+    ctx.check(completeNs * 100 < ctx.last().nsPerOp, "an update costs under 1% of a recompute");
+
+    size_t shown = 0;
+    ctx.run("getReady(10)", 100000, [&] {
+        for (size_t i = 0; i < 100000; ++i) shown += storage.getReady(10).size();
+    });
+    ctx.check(shown == 100000 * std::min<size_t>(10, graph.readyCount()), "next returns a full page");
+
+    ctx.run("reopenTask()", done.size(), [&] {
+        for (auto it = done.rbegin(); it != done.rend(); ++it) storage.reopenTask(*it);
+    });
+    ctx.check(readyMatches(storage), "ready tasks after reopening match a recompute");
+
+    // Single edges, each with its cycle check. Lower IDs always block higher
+    // ones here, so none closes a cycle, but many disagree with the ranks.
+    std::vector<Edge> extra;
+    while (extra.size() < 20000) {
+        const int a = 1 + static_cast<int>(rng.below(tasks));
+        const int b = 1 + static_cast<int>(rng.below(tasks));
+        if (a != b && !graph.hasEdge(std::min(a, b), std::max(a, b))) extra.emplace_back(std::min(a, b), std::max(a, b));
+    }
+    std::sort(extra.begin(), extra.end());
+    extra.erase(std::unique(extra.begin(), extra.end()), extra.end());
+    ctx.run("addDependency() with cycle check", extra.size(), [&] {
+        for (const auto& [blocker, blocked] : extra) storage.addDependency(blocked, blocker);
+    });
+    const size_t before = graph.edgeCount();
+    size_t refused = 0;
+    for (size_t i = 0; i < 100; ++i) {
+        const auto& [blocker, blocked] = edges[rng.below(edges.size())];
+        try {
+            storage.addDependency(blocker, blocked);
+        } catch (const std::runtime_error&) {
+            ++refused;
+        }
+    }
+    ctx.check(refused == 100 && graph.edgeCount() == before, "edges closing a cycle are refused");
+    ctx.check(readyMatches(storage), "ready tasks after single adds match a recompute");
+
+    ctx.run("removeDependency()", extra.size(), [&] {
+        for (const auto& [blocker, blocked] : extra) storage.removeDependency(blocked, blocker);
+    });
+    ctx.check(graph.edgeCount() == added && readyMatches(storage), "removing the single edges restores the schedule");
+
+    // A stored graph is read before the task states are known: a cycle in it
+    // must be refused then too
+    auto encode = [](const std::vector<Edge>& list) {
+        std::string out;
+        auto put = [&](std::uint64_t value, int bytes) {
+            for (int i = 0; i < bytes; ++i) out += static_cast<char>((value >> (8 * i)) & 0xFF);
+        };
+        put(list.size(), 8);
+        for (const auto& [blocker, blocked] : list) {
+            put(static_cast<std::uint64_t>(blocker), 4);
+            put(static_cast<std::uint64_t>(blocked), 4);
+        }
+        return out;
+    };
+    DependencyGraph stored;
+    ctx.check(stored.read(encode({{1, 2}, {2, 3}}), 4) == 0 && !stored.read(encode({{1, 2}, {2, 3}, {3, 1}}), 4) &&
+                  stored.edgeCount() == 0,
+              "a cyclic stored graph is refused");
+    // IDs no task can have are left out before anything is sized by them
+    ctx.check(stored.read(encode({{1, 2}, {2, 2000000000}}), 4) == 1 && stored.edgeCount() == 1 &&
+                  stored.memoryBytes() < 4096,
+              "a stored edge past the next ID allocates nothing");
+
+    // Deleted and archived tasks take their edges along, in memory and in the file
+    std::filesystem::remove_all(root);
+    {
+        Storage small((root / "tasks.json").string());
+        small.setQuiet(true);
+        for (int i = 1; i <= 4; ++i) small.addTask("Step " + std::to_string(i));
+        small.addDependencies({{1, 2}, {2, 3}, {3, 4}, {1, 4}});
+        small.deleteTask(2);
+        const bool deleted = small.dependencies().edgeCount() == 2;
+        small.completeTask(3);
+        small.archiveCompleted(std::numeric_limits<std::int64_t>::max());
+        ctx.check(deleted && small.dependencies().edges() == std::vector<Edge>{{1, 4}},
+                  "deleting or archiving a task drops its edges");
+    }
+    {
+        Storage reloaded((root / "tasks.json").string());
+        ctx.check(reloaded.dependencies().edges() == std::vector<Edge>{{1, 4}} && reloaded.dependencies().isReady(1) &&
+                      !reloaded.dependencies().isReady(4),
+                  "the dependency file drops them too");
+    }
+
+    std::filesystem::remove_all(root);
+}
@@ -0,0 +1,132 @@
+// Point lookups by task ID: interpolation search on the packed ID index
+// against branchless binary search, std::unordered_map and a linear scan,
+// on dense IDs, IDs thinned out by deletes, and a skewed layout
+#include "bench.h"
+#include "footprint.h"
+#include "id_index.h"
+#include "storage.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Layout {
+    const char* name;
+    std::vector<int> ids;
+};
+
+std::vector<Layout> layouts(size_t n) {
+    std::vector<Layout> result;
+    Layout dense{"dense", {}};
+    for (size_t i = 0; i < n; ++i) dense.ids.push_back(static_cast<int>(i) + 1);
+    result.push_back(std::move(dense));
+
+    // Every task that was completed and archived, or deleted, leaves a gap
+    Layout gaps{"30% deleted", {}};
+    Bench::Rng rng(7);
+    for (int id = 1; gaps.ids.size() < n; ++id) {
+        if (rng.below(10) >= 3) gaps.ids.push_back(id);
+    }
+    result.push_back(std::move(gaps));
+
+    // A few very old tasks ahead of a block of recent ones: the first guess
+    // over the whole range is far off, the bisection step after it recovers
+    Layout skewed{"skewed", {}};
+    for (int id = 1; id <= 8; ++id) skewed.ids.push_back(id);
+    for (size_t i = 8; i < n; ++i) skewed.ids.push_back(1000000000 + static_cast<int>(i));
+    result.push_back(std::move(skewed));
+    return result;
+}
+
+}  // namespace
+
+BENCH_CASE(id_lookup) {
+    const size_t lookups = 1000000;
+    for (const size_t n : {ctx.size(), size_t{1000000}}) {
+        for (const Layout& layout : layouts(n)) {
+            IdIndex index;
+            std::unordered_map<int, size_t> hash;
+            index.reserve(n);
+            hash.reserve(n);
+            for (size_t i = 0; i < n; ++i) {
+                index.push_back(layout.ids[i]);
+                hash[layout.ids[i]] = i;
+            }
+            // Random IDs that exist, plus one in eight past the end (deleted)
+            std::vector<int> keys(lookups);
+            Bench::Rng rng(n);
+            for (auto& key : keys) {
+                key = rng.below(8) == 0 ? layout.ids.back() + 1 + static_cast<int>(rng.below(n))
+                                        : layout.ids[rng.below(n)];
+            }
+            const std::string suffix = std::string(", ") + layout.name + ", " + std::to_string(n / 1000) + "K";
+
+            size_t interpolated = 0;
+            ctx.run("interpolation" + suffix, lookups, [&] {
+                for (int key : keys) {
+                    if (const size_t pos = index.find(key); pos != IdIndex::npos) interpolated += pos;
+                }
+            });
+            const double interpolationNs = ctx.last().nsPerOp;
+            size_t bisected = 0;
+            ctx.run("branchless binary" + suffix, lookups, [&] {
+                for (int key : keys) {
+                    const size_t pos = index.binaryLowerBound(key);
+                    if (pos < n && index.ids()[pos] == key) bisected += pos;
+                }
+            });
+            const double binaryNs = ctx.last().nsPerOp;
+            size_t hashed = 0;
+            ctx.run("unordered_map" + suffix, lookups, [&] {
+                for (int key : keys) {
+                    if (auto it = hash.find(key); it != hash.end()) hashed += it->second;
+                }
+            });
+            const double hashNs = ctx.last().nsPerOp;
+            ctx.check(interpolated == bisected && bisected == hashed, "all variants find the same positions" + suffix);
+            const bool dense = std::string(layout.name) == "dense";
+            if (dense) {
+                ctx.check(interpolationNs * 2 < binaryNs && interpolationNs < hashNs * 1.25,
+                          "2x binary search, on par with hashing" + suffix);
+            } else {
+                ctx.check(interpolationNs <= binaryNs, "no slower than binary search" + suffix);
+            }
+            if (dense && n == ctx.size()) {
+                std::printf("  %-40s %zu bytes per task, unordered_map %zu\n", "index memory", Footprint::of(index.ids()) / n,
+                            Footprint::of(hash) / n);
+            }
+        }
+    }
+
+    // Linear scan, the baseline before any index, on a loaded store
+    const auto path = Bench::tempPath("id_lookup.json");
+    Bench::writeDataset(ctx.spec(), path);
+    Storage storage(path.string());
+    const auto& tasks = storage.getAllTasks();
+    const size_t scans = 200;
+    std::vector<int> keys(scans);
+    Bench::Rng rng(3);
+    for (auto& key : keys) key = tasks[rng.below(tasks.size())].getId();
+    size_t scanned = 0;
+    ctx.run("linear scan, store", scans, [&] {
+        for (int key : keys) {
+            auto it = std::find_if(tasks.begin(), tasks.end(), [key](const Task& task) { return task.getId() == key; });
+            scanned += static_cast<size_t>(it - tasks.begin());
+        }
+    });
+    const double scanNs = ctx.last().nsPerOp;
+    size_t found = 0;
+    ctx.run("Storage::findTask, store", lookups, [&] {
+        for (size_t i = 0; i < lookups; ++i) {
+            const Task* task = storage.findTask(keys[i % scans]);
+            found += task ? static_cast<size_t>(task - tasks.data()) : 0;
+        }
+    });
+    std::printf("  %-40s %8.1fx\n", "findTask vs linear scan", scanNs / ctx.last().nsPerOp);
+    ctx.check(found == scanned * (lookups / scans), "findTask agrees with the scan");
+    ctx.check(scanNs > ctx.last().nsPerOp * 100, "findTask > 100x faster than a scan");
+    std::filesystem::remove(path);
+}
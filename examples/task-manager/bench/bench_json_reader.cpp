@@ -0,0 +1,184 @@
+// Task-file loading: schema-aware TaskJson::read (per instruction set) against
+// nlohmann::json::parse + fromDom, plus a differential fuzz of the two paths
+#include "bench.h"
+#include "storage.h"
+#include "task_json.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+static const char* isaName(TaskJson::Isa isa) {
+    switch (isa) {
+        case TaskJson::Isa::Scalar: return "scalar";
+        case TaskJson::Isa::Sse2: return "sse2";
+        case TaskJson::Isa::Avx2: return "avx2";
+    }
+    return "?";
+}
+
+// Random small task file exercising escapes, UTF-8, optional fields, key order
+// and whitespace. Built by sequential appends so the RNG draws happen in a fixed order.
+static std::string randomDocument(Bench::Rng& rng) {
+    static const char* const PIECES[] = {"plain", " ", "\\\"", "\\\\", "\\/", "\\n", "\\t", "\\u00e9", "\\ud83d\\ude00",
+                                         "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "tab\\u0009", "x",
+                                         "a longer run of plain ascii text that spans several vector widths"};
+    static const char* const SPACES[] = {"", " ", "\n    ", "\t", "\r\n"};
+    auto space = [&](std::string& out) { out += SPACES[rng.below(5)]; };
+    auto str = [&](std::string& out) {
+        out += '"';
+        for (size_t k = rng.below(5); k > 0; --k) out += PIECES[rng.below(sizeof(PIECES) / sizeof(PIECES[0]))];
+        out += '"';
+    };
+
+    std::string list = "\"tasks\"";
+    space(list);
+    list += ':';
+    space(list);
+    list += '[';
+    for (size_t t = rng.below(4); t > 0; --t) {
+        std::vector<std::string> fields(3);
+        fields[0] = "\"id\":";
+        space(fields[0]);
+        fields[0] += std::to_string(static_cast<int>(rng.below(2000)) - 5);
+        fields[1] = "\"description\":";
+        str(fields[1]);
+        fields[2] = rng.below(2) ? "\"completed\":true" : "\"completed\":false";
+        if (rng.below(2)) fields.push_back("\"priority\":" + std::to_string(static_cast<int>(rng.below(14)) - 2));
+        if (rng.below(3) == 0) fields.push_back("\"completedAt\":" + std::to_string(static_cast<long long>(rng.below(2000000000)) - 10));
+        if (rng.below(2)) fields.push_back("\"due\":" + std::to_string(static_cast<long long>(rng.below(3000000000)) - 10));
+        if (rng.below(2)) {
+            std::string& tags = fields.emplace_back("\"tags\":[");
+            for (size_t k = rng.below(3); k > 0; --k) {
+                if (tags.back() != '[') tags += ',';
+                str(tags);
+            }
+            tags += ']';
+        }
+        for (size_t k = fields.size(); k > 1; --k) std::swap(fields[k - 1], fields[rng.below(k)]);
+        if (list.back() != '[') list += ',';
+        space(list);
+        list += '{';
+        for (size_t k = 0; k < fields.size(); ++k) {
+            if (k) list += ',';
+            space(list);
+            list += fields[k];
+        }
+        space(list);
+        list += '}';
+    }
+    space(list);
+    list += ']';
+
+    std::vector<std::string> top{list};
+    if (rng.below(4)) {
+        std::string& next = top.emplace_back("\"nextId\":");
+        space(next);
+        next += std::to_string(rng.below(5000));
+    }
+    if (rng.below(2)) std::swap(top.front(), top.back());
+    std::string doc = "{";
+    for (size_t k = 0; k < top.size(); ++k) {
+        if (k) doc += ',';
+        space(doc);
+        doc += top[k];
+    }
+    space(doc);
+    doc += '}';
+    space(doc);
+    return doc;
+}
+
+// Corrupt a few bytes with JSON-significant characters
+static void mutate(std::string& doc, Bench::Rng& rng) {
+    static const char ALPHABET[] = "{}[],:\"\\u0123456789eE.-+tfnrl \n\x01\x80\xc3\xff";
+    for (size_t k = rng.below(4); k > 0 && !doc.empty(); --k) {
+        size_t at = rng.below(doc.size());
+        char c = ALPHABET[rng.below(sizeof(ALPHABET) - 1)];
+        switch (rng.below(3)) {
+            case 0: doc[at] = c; break;
+            case 1: doc.erase(at, 1); break;
+            default: doc.insert(doc.begin() + static_cast<std::ptrdiff_t>(at), c); break;
+        }
+    }
+}
+
+BENCH_CASE(json_reader) {
+    auto path = Bench::tempPath("json-reader.json");
+    Bench::writeDataset(ctx.spec(), path);
+    std::string text;
+    {
+        std::ifstream ifs(path);
+        std::stringstream ss;
+        ss << ifs.rdbuf();
+        text = std::move(ss).str();
+    }
+    const size_t n = ctx.size();
+    const TaskJson::Isa best = TaskJson::bestIsa();
+
+    std::vector<Task> expected;
+    int expectedNextId = 0;
+    ctx.run("nlohmann parse + fromDom", n, [&] {
+        json j = json::parse(text);
+        TaskJson::fromDom(j, expected, expectedNextId);
+    }, text.size());
+    const double nlohmannNs = ctx.last().nsPerOp;
+
+    for (int level = 0; level <= static_cast<int>(best); ++level) {
+        auto isa = static_cast<TaskJson::Isa>(level);
+        TaskJson::setIsa(isa);
+        std::vector<Task> tasks;
+        int nextId = 0;
+        bool ok = false;
+        ctx.run(std::string("TaskJson::read ") + isaName(isa), n, [&] { ok = TaskJson::read(text, tasks, nextId); },
+                text.size());
+        std::printf("  %-40s %11.1fx\n", "speedup vs nlohmann", nlohmannNs / ctx.last().nsPerOp);
+        ctx.check(ok && nextId == expectedNextId && Bench::sameTasks(tasks, expected),
+                  std::string(isaName(isa)) + ": pretty file identical");
+    }
+
+    // Compact files take the fast path too
+    std::string compact;
+    TaskJson::write(compact, expected, expectedNextId, TaskJson::Style::Compact);
+    std::vector<Task> fromCompact;
+    int compactNextId = 0;
+    ctx.check(TaskJson::read(compact, fromCompact, compactNextId) && Bench::sameTasks(fromCompact, expected),
+              "compact file identical");
+
+    // Differential fuzz: whenever the fast reader accepts, nlohmann must agree exactly
+    const size_t docs = 20000;
+    for (int level = 0; level <= static_cast<int>(best); ++level) {
+        auto isa = static_cast<TaskJson::Isa>(level);
+        TaskJson::setIsa(isa);
+        Bench::Rng rng(ctx.spec().seed + static_cast<std::uint64_t>(level));
+        size_t accepted = 0;
+        size_t mismatches = 0;
+        for (size_t d = 0; d < docs; ++d) {
+            std::string doc = randomDocument(rng);
+            if (rng.below(2)) mutate(doc, rng);
+            std::vector<Task> fast;
+            int fastNextId = 0;
+            if (!TaskJson::read(doc, fast, fastNextId)) continue;
+            ++accepted;
+            try {
+                json j = json::parse(doc);
+                std::vector<Task> slow;
+                int slowNextId = 0;
+                TaskJson::fromDom(j, slow, slowNextId);
+                if (slowNextId != fastNextId || !Bench::sameTasks(fast, slow)) ++mismatches;
+            } catch (const std::exception&) {
+                ++mismatches;
+                if (mismatches == 1) std::printf("  first mismatch: %s\n", doc.c_str());
+            }
+        }
+        std::printf("  %-40s %6zu / %zu\n", (std::string(isaName(isa)) + " fuzz docs on fast path").c_str(), accepted,
+                    docs);
+        ctx.check(mismatches == 0 && accepted > docs / 4, std::string(isaName(isa)) + ": fuzz agrees with nlohmann");
+    }
+
+    TaskJson::setIsa(best);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,91 @@
+// Task-file serialization: direct TaskJson writer against the nlohmann DOM + setw(4) path
+#include "bench.h"
+#include "storage.h"
+#include "task_json.h"
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Storage::toJson as it was before TaskJson
+static json legacyToJson(const std::vector<Task>& tasks, int nextId) {
+    json j = json::array();
+    for (const auto& task : tasks) {
+        j.push_back({{"id", task.getId()},
+                     {"description", task.getDescription()},
+                     {"completed", task.isCompleted()},
+                     {"completedAt", task.getCompletedAt()},
+                     {"priority", task.getPriority()},
+                     {"due", task.getDue()},
+                     {"tags", task.getTags()}});
+    }
+    return {{"tasks", j}, {"nextId", nextId}};
+}
+
+BENCH_CASE(json_writer) {
+    auto path = Bench::tempPath("json-writer.json");
+    Bench::writeDataset(ctx.spec(), path);
+    Storage storage(path.string());
+    storage.setAutoSave(false);
+    const auto& tasks = storage.getAllTasks();
+    const size_t n = tasks.size();
+    const int nextId = static_cast<int>(n) + 1;
+
+    std::ostringstream expected;
+    expected << std::setw(4) << legacyToJson(tasks, nextId) << std::endl;
+    const std::string legacy = std::move(expected).str();
+    const size_t bytes = legacy.size();
+    ctx.run("nlohmann toJson + dump(4)", n, [&] {
+        std::ostringstream out;
+        out << std::setw(4) << legacyToJson(tasks, nextId) << std::endl;
+        Bench::doNotOptimize(out.tellp());
+    }, bytes);
+    const double legacyNs = ctx.last().nsPerOp;
+
+    std::string buffer;
+    TaskJson::write(buffer, tasks, nextId);
+    ctx.check(buffer == legacy, "pretty output identical to nlohmann dump(4)");
+    ctx.run("TaskJson::write pretty", n, [&] { TaskJson::write(buffer, tasks, nextId); }, bytes);
+    ctx.check(ctx.last().allocsPerOp == 0.0, "reused buffer does not allocate");
+    std::printf("  %-40s %11.1fx\n", "speedup vs nlohmann", legacyNs / ctx.last().nsPerOp);
+
+    std::string compact;
+    TaskJson::write(compact, tasks, nextId, TaskJson::Style::Compact);
+    ctx.check(compact == legacyToJson(tasks, nextId).dump() + "\n", "compact output identical to nlohmann dump()");
+    ctx.run("TaskJson::write compact", n, [&] {
+        TaskJson::write(compact, tasks, nextId, TaskJson::Style::Compact);
+    }, compact.size());
+    std::printf("  %-40s %11.1f%%\n", "compact size vs pretty",
+                100.0 * static_cast<double>(compact.size()) / static_cast<double>(buffer.size()));
+
+    ctx.run("Storage::save pretty", n, [&] { storage.save(); }, bytes);
+    storage.setJsonStyle(TaskJson::Style::Compact);
+    ctx.run("Storage::save compact", n, [&] { storage.save(); }, compact.size());
+    Storage reloaded(path.string());
+    ctx.check(reloaded.getTaskCount() == n, "compact file loads back");
+
+    // Escaping must agree with nlohmann on awkward input
+    const std::string awkward[] = {"quote \" backslash \\ slash /", std::string("ctl \x01\x1f\b\f\n\r\t del \x7f", 21),
+                                   "utf8 \xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80", ""};
+    bool escapes = true;
+    for (const auto& text : awkward) {
+        std::string mine;
+        TaskJson::appendString(mine, text);
+        escapes = escapes && mine == json(text).dump();
+    }
+    ctx.check(escapes, "string escaping matches nlohmann");
+    bool rejected = false;
+    try {
+        std::string out;
+        TaskJson::appendString(out, "bad \xc3\x28 utf8");
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    ctx.check(rejected, "invalid UTF-8 rejected");
+
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,137 @@
+// Memory accounting on a 1M-task store against the allocator's own numbers,
+// and the memory budget: archiving the oldest completed tasks, refusing adds
+// and loads that do not fit
+#include "bench.h"
+#include "dataset.h"
+#include "storage.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#if defined(__GLIBC__)
+#  include <malloc.h>
+#endif
+
+namespace {
+
+// Bytes the allocator has handed out (chunks plus mmapped blocks), 0 where unknown
+size_t heapInUse() {
+#if defined(__GLIBC__)
+    const struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+template <typename F>
+bool throwsRuntimeError(F&& body) {
+    try {
+        body();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+BENCH_CASE(memory) {
+    const auto root = Bench::tempPath("memory");
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    Bench::DatasetSpec spec = ctx.spec();
+    spec.tasks = 1000000;
+    auto generated = Bench::generateTasks(spec);
+
+    // Built in memory (no file), so the heap delta is the store alone
+    const size_t heapBefore = heapInUse();
+    std::optional<Storage> store;
+    store.emplace((root / "tasks.json").string());
+    store->setAutoSave(false);
+    ctx.run("build 1M-task store", spec.tasks, [&] {
+        for (const auto& task : generated) {
+            int id = store->addTask(task.description);
+            store->setPriority(id, task.priority);
+            if (task.due != Task::NO_DUE) store->setDue(id, task.due);
+            for (const auto& tag : task.tags) store->addTag(id, tag);
+            if (task.completed) store->completeTask(id);
+        }
+        store->forEachIf([](const Task& task) { return task.isCompleted(); }, [&](Task& task) {
+            task.setCompletedAt(generated[static_cast<size_t>(task.getId() - 1)].completedAt);
+        });
+    });
+    const size_t heapStore = heapInUse() - heapBefore;
+
+    Storage::MemoryUsage usage;
+    ctx.run("memoryUsage(), 1M tasks", spec.tasks, [&] { usage = store->memoryUsage(); });
+    std::printf("  %-40s %s tasks, %s strings, %s indexes, %s caches\n", "memoryUsage()",
+                Utils::formatBytes(usage.tasks).c_str(), Utils::formatBytes(usage.strings).c_str(),
+                Utils::formatBytes(usage.indexes).c_str(), Utils::formatBytes(usage.caches).c_str());
+    if (heapBefore == 0) {
+        std::printf("  %-40s %s\n", "allocator view", "skipped (no mallinfo2)");
+    } else {
+        const double error = (static_cast<double>(usage.total()) - static_cast<double>(heapStore)) / static_cast<double>(heapStore);
+        std::printf("  %-40s %s accounted, %s by malloc (%+.2f%%)\n", "total", Utils::formatBytes(usage.total()).c_str(),
+                    Utils::formatBytes(heapStore).c_str(), error * 100.0);
+        ctx.check(error > -0.03 && error < 0.03, "accounting within 3% of malloc's count");
+    }
+
+    // A budget of 3/4 of that: the oldest completed tasks go to the archive
+    const size_t budget = usage.total() / 4 * 3;
+    ctx.run("setMemoryBudget(3/4), archives", 1, [&] { store->setMemoryBudget(budget); });
+    const auto afterEviction = store->memoryUsage().total();
+    const size_t heapEvicted = heapInUse() - heapBefore;
+    const auto archived = store->getArchivedTasks();
+    std::int64_t newestArchived = 0;
+    for (const auto& task : archived) newestArchived = std::max(newestArchived, task.getCompletedAt());
+    bool oldestFirst = true;
+    for (const auto& task : store->getAllTasks()) {
+        if (task.isCompleted() && task.getCompletedAt() < newestArchived) oldestFirst = false;
+    }
+    std::printf("  %-40s %zu tasks archived, %s in use\n", "after eviction", archived.size(),
+                Utils::formatBytes(afterEviction).c_str());
+    ctx.check(afterEviction <= budget && !archived.empty(), "eviction brings usage under the budget");
+    ctx.check(oldestFirst && archived.size() + store->getTaskCount() == spec.tasks,
+              "the oldest completed tasks move to the archive, none are lost");
+    if (heapBefore != 0) {
+        ctx.check(heapEvicted <= budget + budget / 20, "the freed memory goes back to the allocator");
+    }
+
+    // Budgets that cannot be met even without completed tasks
+    const size_t taskCount = store->getTaskCount();
+    ctx.check(throwsRuntimeError([&] { store->setMemoryBudget(afterEviction / 4); }) && store->memoryBudget() == budget &&
+                  store->getTaskCount() == taskCount,
+              "an impossible budget is refused and left unchanged");
+    store->setMemoryBudget(store->memoryUsage().total() + (size_t{1} << 20));
+    ctx.check(throwsRuntimeError([&] { store->addTask("One task too many"); }) && store->getTaskCount() == taskCount,
+              "an add that would outgrow the budget is refused");
+    store.reset();
+    generated = {};
+
+    // Loads: a store of --size tasks against budgets below and above its needs
+    Bench::DatasetSpec small = ctx.spec();
+    const auto smallPath = root / "small.json";
+    Bench::writeDataset(small, smallPath);
+    size_t needed = 0;
+    {
+        Storage probe(smallPath.string());
+        needed = probe.memoryUsage().total();
+    }
+    const auto smallSize = std::filesystem::file_size(smallPath);
+    ctx.check(throwsRuntimeError([&] { Storage refused(smallPath.string(), needed / 4); }) &&
+                  std::filesystem::file_size(smallPath) == smallSize,
+              "a load far over the budget is refused, the file untouched");
+    bool loaded = false;
+    ctx.run("load under a budget", small.tasks, [&] {
+        Storage fits(smallPath.string(), needed * 2);
+        loaded = fits.getTaskCount() == small.tasks;
+    });
+    ctx.check(loaded, "a load within the budget keeps every task");
+
+    std::filesystem::remove_all(root);
+}
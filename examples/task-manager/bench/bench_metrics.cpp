@@ -0,0 +1,59 @@
+// Cost of the latency timers (on and off) and histogram accuracy
+#include "bench.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+BENCH_CASE(metrics) {
+    const size_t n = std::max<size_t>(ctx.size() * 10, 100000);
+
+    Metrics::setEnabled(false);
+    ctx.run("ScopedTimer (disabled)", n, [&] {
+        for (size_t i = 0; i < n; ++i) {
+            Metrics::ScopedTimer timer(Metrics::Op::Parse);
+            Bench::doNotOptimize(i);
+        }
+    });
+    const double disabledNs = ctx.last().nsPerOp;
+
+    Metrics::reset();
+    Metrics::setEnabled(true);
+    ctx.run("ScopedTimer (enabled)", n, [&] {
+        for (size_t i = 0; i < n; ++i) {
+            Metrics::ScopedTimer timer(Metrics::Op::Parse);
+            Bench::doNotOptimize(i);
+        }
+    });
+    Metrics::setEnabled(false);
+    ctx.check(Metrics::histogram(Metrics::Op::Parse).count() == n, "enabled timer records every scope");
+    ctx.check(disabledNs < 5.0, "disabled timer costs < 5 ns");
+
+    // Log-normal-ish latencies spanning several decades
+    Bench::Rng rng(ctx.spec().seed);
+    std::vector<std::uint64_t> samples(n);
+    for (auto& s : samples) s = static_cast<std::uint64_t>(std::exp(rng.normal(10.0, 2.0))) + 1;
+
+    Metrics::Histogram h;
+    ctx.run("Histogram::record", n, [&] {
+        for (auto s : samples) h.record(s);
+    });
+
+    std::sort(samples.begin(), samples.end());
+    bool accurate = true;
+    for (double p : {50.0, 90.0, 99.0, 99.9}) {
+        auto rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(n)));
+        double exact = static_cast<double>(samples[rank - 1]);
+        double approx = static_cast<double>(h.percentile(p));
+        accurate = accurate && approx >= exact && approx <= exact * (1.0 + 1.0 / Metrics::Histogram::SUB_COUNT);
+    }
+    ctx.check(accurate, "percentiles within one sub-bucket");
+    ctx.check(h.max() == samples.back() && h.count() == n, "max and count exact");
+
+    std::string prom;
+    ctx.run("Metrics::toPrometheus", 1, [&] { prom = Metrics::toPrometheus(); }, 0);
+    ctx.check(prom.find("tm_op_duration_seconds_count{op=\"parse\"} " + std::to_string(n) + "\n") != std::string::npos,
+              "prometheus count matches");
+    Metrics::reset();
+}
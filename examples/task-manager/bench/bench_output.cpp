@@ -0,0 +1,157 @@
+// Console output: write(2) calls per command for a list-heavy session through
+// OutputSink, against the old per-segment printColored on a line-buffered
+// stdout, plus color coalescing and TTY detection
+#include "bench.h"
+#include "output.h"
+#include "table.h"
+#include "utils.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifdef _WIN32
+static const char* const NULL_DEVICE = "NUL";
+#else
+static const char* const NULL_DEVICE = "/dev/null";
+#endif
+
+// write(2) calls made by this process so far (Linux); 0 where unavailable
+static size_t writeSyscalls() {
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    size_t value = 0;
+    while (io >> key >> value) {
+        if (key == "syscw:") return value;
+    }
+    return 0;
+}
+
+// Utils::printColored as it was: color, text and reset as separate stream
+// writes, on a stream that is line-buffered like stdout on a terminal
+static void legacyPrint(std::FILE* out, const std::string& text, std::string_view color) {
+    std::fwrite(color.data(), 1, color.size(), out);
+    std::fputs(text.c_str(), out);
+    std::fwrite(Utils::RESET.data(), 1, Utils::RESET.size(), out);
+}
+
+// Everything a sink wrote to a scratch file
+static std::string sinkOutput(bool color, void (*fill)(OutputSink&)) {
+    auto path = Bench::tempPath("output.txt");
+    std::string text;
+    if (std::FILE* file = std::fopen(path.string().c_str(), "w")) {
+        {
+            OutputSink sink(fileno(file));
+            sink.setColorEnabled(color);
+            fill(sink);
+            sink.flush();
+        }
+        std::fclose(file);
+        std::ifstream in(path, std::ios::binary);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        text = ss.str();
+    }
+    std::filesystem::remove(path);
+    return text;
+}
+
+BENCH_CASE(output) {
+    auto mixed = [](OutputSink& sink) {
+        sink.write("Task 1 ", Utils::GREEN);
+        sink.write("completed.\n", Utils::GREEN);
+        sink.write("> ", Utils::BLUE);
+        sink.write("plain\n");
+    };
+    std::string colored;
+    colored += Utils::GREEN;
+    colored += "Task 1 completed.\n";
+    colored += Utils::BLUE;
+    colored += "> ";
+    colored += Utils::RESET;
+    colored += "plain\n";
+    ctx.check(sinkOutput(true, mixed) == colored, "same-color segments share one escape code");
+    ctx.check(sinkOutput(false, mixed) == "Task 1 completed.\n> plain\n", "no escape codes without color");
+
+    std::FILE* devNull = std::fopen(NULL_DEVICE, "w");
+    std::FILE* legacyOut = std::fopen(NULL_DEVICE, "w");
+    if (!devNull || !legacyOut) {
+        ctx.check(false, std::string("open ") + NULL_DEVICE);
+        if (devNull) std::fclose(devNull);
+        if (legacyOut) std::fclose(legacyOut);
+        return;
+    }
+    std::setvbuf(legacyOut, nullptr, _IOLBF, BUFSIZ);
+    {
+        OutputSink probe(fileno(devNull));
+        ctx.check(!probe.colorEnabled(), "colors are off when the fd is not a terminal");
+    }
+
+    // A session of `list` (25 rows), `complete` and a search that finds
+    // nothing, each followed by the prompt. The terminal gets colors.
+    std::vector<Task> tasks;
+    for (int id = 1; id <= 25; ++id) tasks.emplace_back(id, "Session task " + std::to_string(id), id % 4 == 0);
+    const size_t rounds = 2000;
+    const size_t commands = rounds * 3;
+
+    OutputSink sink(fileno(devNull));
+    sink.setColorEnabled(true);
+    TableRenderer table(sink);
+    table.setWidth(80);
+    auto sinkSession = [&] {
+        for (size_t i = 0; i < rounds; ++i) {
+            table.render(tasks, "TASKS");
+            sink.write("> ", Utils::BLUE);
+            sink.flush();
+            sink.write("Task " + std::to_string(i) + " completed.\n", Utils::GREEN);
+            sink.write("> ", Utils::BLUE);
+            sink.flush();
+            sink.write("No tasks match 'zzz'.\n", Utils::YELLOW);
+            sink.write("> ", Utils::BLUE);
+            sink.flush();
+        }
+    };
+
+    // The old path: the table had its own buffer and fd write, messages went
+    // through std::cout, which reading stdin flushes
+    OutputSink legacyTableOut(fileno(legacyOut));
+    TableRenderer legacyTable(legacyTableOut);
+    legacyTable.setWidth(80);
+    auto legacySession = [&] {
+        for (size_t i = 0; i < rounds; ++i) {
+            std::fflush(legacyOut);
+            legacyTable.render(tasks, "TASKS");
+            legacyTableOut.flush();
+            legacyPrint(legacyOut, "> ", Utils::BLUE);
+            std::fflush(legacyOut);
+            legacyPrint(legacyOut, "Task " + std::to_string(i) + " completed.\n", Utils::GREEN);
+            legacyPrint(legacyOut, "> ", Utils::BLUE);
+            std::fflush(legacyOut);
+            legacyPrint(legacyOut, "No tasks match 'zzz'.\n", Utils::YELLOW);
+            legacyPrint(legacyOut, "> ", Utils::BLUE);
+            std::fflush(legacyOut);
+        }
+    };
+
+    size_t before = writeSyscalls();
+    sinkSession();
+    const size_t sinkWrites = writeSyscalls() - before;
+    before = writeSyscalls();
+    legacySession();
+    const size_t legacyWrites = writeSyscalls() - before;
+    ctx.run("OutputSink session (commands)", commands, sinkSession);
+    ctx.run("printColored session (commands)", commands, legacySession);
+
+    if (sinkWrites == 0 && legacyWrites == 0) {
+        std::printf("  %-40s %s\n", "write syscalls", "not counted (no /proc/self/io)");
+    } else {
+        std::printf("  %-40s %8.2f vs %.2f per command\n", "write syscalls, sink vs printColored",
+                    static_cast<double>(sinkWrites) / static_cast<double>(commands),
+                    static_cast<double>(legacyWrites) / static_cast<double>(commands));
+        ctx.check(sinkWrites <= commands, "one write per command");
+        ctx.check(sinkWrites * 2 <= legacyWrites, "at least half the write syscalls of printColored");
+    }
+
+    std::fclose(legacyOut);
+    std::fclose(devNull);
+}
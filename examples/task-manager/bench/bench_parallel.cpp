@@ -0,0 +1,93 @@
+// Scaling of Storage's parallel scans from 1 thread to every hardware thread
+#include "bench.h"
+#include "storage.h"
+#include "utils.h"
+#include <string>
+
+BENCH_CASE(parallel) {
+    const size_t n = ctx.size();
+    auto path = Bench::tempPath("parallel.json");
+    std::filesystem::remove(path);
+    Storage storage(path.string());
+    storage.setAutoSave(false);
+    for (size_t i = 0; i < n; ++i) {
+        storage.addTask("Parallel scan task " + std::to_string(i * 2654435761u % 1000003));
+        if (i % 3 == 0) storage.completeTask(static_cast<int>(i + 1));
+    }
+
+    std::vector<unsigned> counts;
+    unsigned hw = ctx.maxThreads();
+    for (unsigned t = 1; t < hw; t *= 2) counts.push_back(t);
+    counts.push_back(hw);
+
+    double baseCount = 0, baseFilter = 0, baseUpdate = 0;
+    size_t expectedPending = 0, expectedMatches = 0;
+    bool consistent = true;
+    std::printf("  %-8s %14s %8s %14s %8s %14s %8s\n", "threads", "count_if ns/t", "speedup", "filter ns/t",
+                "speedup", "for_each ns/t", "speedup");
+    for (unsigned threads : counts) {
+        Parallel::setThreadCount(threads);
+        std::string suffix = " x" + std::to_string(threads);
+
+        size_t pending = 0, matches = 0;
+        ctx.run("countIf(pending)" + suffix, n, [&] {
+            pending = storage.countIf([](const Task& t) { return !t.isCompleted(); });
+        });
+        double count = ctx.last().nsPerOp;
+
+        ctx.run("filter(contains \"777\")" + suffix, n, [&] {
+            matches = storage.filter(
+                [](const Task& t) { return Utils::containsIgnoreCase(t.getDescription(), "777"); }).size();
+        });
+        double filter = ctx.last().nsPerOp;
+
+        ctx.run("forEachIf(bump priority)" + suffix, n, [&] {
+            Bench::doNotOptimize(storage.forEachIf([](const Task& t) { return t.getId() % 7 == 0; },
+                                                   [](Task& t) { t.setPriority((t.getPriority() + 1) % 10); }));
+        });
+        double update = ctx.last().nsPerOp;
+
+        if (threads == 1) {
+            expectedPending = pending;
+            expectedMatches = matches;
+            baseCount = count;
+            baseFilter = filter;
+            baseUpdate = update;
+        }
+        consistent = consistent && pending == expectedPending && matches == expectedMatches;
+        std::printf("  %-8u %14.2f %7.2fx %14.2f %7.2fx %14.2f %7.2fx\n", threads, count, baseCount / count, filter,
+                    baseFilter / filter, update, baseUpdate / update);
+    }
+    ctx.check(consistent, "same results at every thread count");
+    Parallel::setThreadCount(0);
+
+    // Bulk updates keep the bookkeeping of the single-task mutators
+    auto second = [](const Task& t) { return t.getId() % 3 == 2; };
+    const size_t flipped = storage.forEachIf(second, [](Task& t) { t.setCompleted(true); });
+    const bool stamped = storage.countIf([&](const Task& t) { return second(t) && t.getCompletedAt() == Task::UNKNOWN_TIME; }) == 0;
+    storage.forEachIf(second, [](Task& t) { t.setCompleted(false); });
+    const bool cleared = storage.countIf([&](const Task& t) { return second(t) && t.getCompletedAt() != Task::UNKNOWN_TIME; }) == 0;
+    ctx.check(flipped > 0 && stamped && cleared, "forEachIf stamps completion times like completeTask and reopenTask");
+    std::filesystem::remove(path);
+
+    auto budgetPath = Bench::tempPath("parallel-budget.json");
+    std::filesystem::remove(budgetPath);
+    std::filesystem::remove(std::filesystem::path(budgetPath).replace_extension(".archive.jsonl"));
+    {
+        Storage small(budgetPath.string());
+        small.setQuiet(true);
+        small.setAutoSave(false);
+        for (int id = 1; id <= 1000; ++id) {
+            small.addTask((id % 2 ? "Bulky completed task " : "Task ") + std::string(id % 2 ? 1000 : 10, 'x'));
+            if (id % 2) small.completeTask(id);
+        }
+        const size_t budget = small.memoryUsage().total() + (size_t{16} << 10);
+        small.setMemoryBudget(budget);
+        small.forEachIf([](const Task& t) { return !t.isCompleted(); },
+                        [](Task& t) { t.setDescription(std::string(t.getDescription()) + std::string(200, 'y')); });
+        ctx.check(small.getTaskCount() < 1000 && small.memoryUsage().total() <= budget,
+                  "forEachIf growing tasks archives completed ones to stay in budget");
+    }
+    std::filesystem::remove(budgetPath);
+    std::filesystem::remove(std::filesystem::path(budgetPath).replace_extension(".archive.jsonl"));
+}
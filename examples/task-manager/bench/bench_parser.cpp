@@ -0,0 +1,54 @@
+// Command parser throughput and heap usage, against the old istringstream parser
+#include "bench.h"
+#include "command.h"
+#include <sstream>
+#include <string>
+
+static const char* const INPUTS[] = {
+    "list",      "complete 42",        "delete 7",     "priority 3 5", "due 12 2026-01-01",
+    "tag 5 work", "untag 5 work",      "upcoming 20",  "tagged home",  "help",
+};
+static const size_t INPUT_COUNT = sizeof(INPUTS) / sizeof(INPUTS[0]);
+
+// Parsing as CLI::parseCommand did before the string_view tokenizer
+static int legacyParse(const std::string& input) {
+    std::istringstream iss(input);
+    std::string cmd;
+    iss >> cmd;
+    int id = 0, number = 0;
+    std::string text;
+    if (cmd == "add") {
+        std::getline(iss, text);
+    } else if (cmd == "complete" || cmd == "delete") {
+        iss >> id;
+    } else if (cmd == "priority") {
+        iss >> id >> number;
+    } else if (cmd == "due" || cmd == "tag" || cmd == "untag") {
+        iss >> id >> text;
+    } else if (cmd == "upcoming") {
+        iss >> number;
+    } else if (cmd == "tagged") {
+        iss >> text;
+    }
+    return id + number + static_cast<int>(text.size());
+}
+
+BENCH_CASE(parser) {
+    const size_t n = ctx.size() * 10;
+
+    // Inputs live in std::strings, as they do coming from std::getline
+    std::string lines[INPUT_COUNT];
+    for (size_t i = 0; i < INPUT_COUNT; ++i) lines[i] = INPUTS[i];
+
+    ctx.run("CommandParser::parse", n, [&] {
+        for (size_t i = 0; i < n; ++i) {
+            Command cmd = CommandParser::parse(lines[i % INPUT_COUNT]);
+            Bench::doNotOptimize(cmd);
+        }
+    });
+    ctx.check(ctx.last().allocsPerOp == 0.0, "parse: zero heap allocations");
+
+    ctx.run("legacy istringstream parse", n, [&] {
+        for (size_t i = 0; i < n; ++i) Bench::doNotOptimize(legacyParse(lines[i % INPUT_COUNT]));
+    });
+}
@@ -0,0 +1,110 @@
+// Batch throughput: a script of mixed commands through the synchronous
+// parseCommand loop (one full save per change) against CLI::runPipelined,
+// which overlaps execution with grouped writes on an I/O thread
+#include "bench.h"
+#include "cli.h"
+#include "dataset.h"
+#include "storage.h"
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+// Adds, completes, tags and reads in the proportions of a busy import script
+std::string makeScript(size_t commands, size_t existing) {
+    Bench::Rng rng(7);
+    std::string script;
+    for (size_t i = 0; i < commands; ++i) {
+        const int id = static_cast<int>(rng.below(existing)) + 1;
+        switch (i % 5) {
+            case 0:
+            case 1:
+                script += "add Scripted task " + std::to_string(i) + "\n";
+                break;
+            case 2:
+                script += "complete " + std::to_string(id) + "\n";
+                break;
+            case 3:
+                script += "tag " + std::to_string(id) + " batch\n";
+                break;
+            default:
+                script += "search Scripted task " + std::to_string(i) + "\n";
+                break;
+        }
+    }
+    script += "quit\n";
+    return script;
+}
+
+// Completion times come from the clock, so two runs agree on everything else
+bool sameIgnoringCompletedAt(std::vector<Task> a, std::vector<Task> b) {
+    for (auto& task : a) task.setCompletedAt(0);
+    for (auto& task : b) task.setCompletedAt(0);
+    return Bench::sameTasks(a, b);
+}
+
+// Run `body` with std::cin reading `script`
+template <typename F>
+void withInput(const std::string& script, F&& body) {
+    std::istringstream input(script);
+    auto* saved = std::cin.rdbuf(input.rdbuf());
+    std::cin.clear();
+    body();
+    std::cin.rdbuf(saved);
+    std::cin.clear();
+}
+
+}  // namespace
+
+BENCH_CASE(pipeline) {
+    const auto root = Bench::tempPath("pipeline");
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    Bench::DatasetSpec spec = ctx.spec();
+    spec.tasks = 2000;
+    const auto seed = root / "seed.json";
+    Bench::writeDataset(spec, seed);
+    const size_t commands = 2000;
+    const std::string script = makeScript(commands, spec.tasks);
+    const auto syncPath = root / "sync.json";
+    const auto pipedPath = root / "piped.json";
+
+    std::vector<Task> syncTasks;
+    ctx.run("parseCommand loop, save per change", commands, [&] {
+        std::filesystem::copy_file(seed, syncPath, std::filesystem::copy_options::overwrite_existing);
+        Storage storage(syncPath.string());
+        CLI cli(storage);
+        Bench::SilenceStdout quiet;
+        withInput(script, [&] {
+            std::string line;
+            while (std::getline(std::cin, line) && cli.parseCommand(line)) {
+            }
+        });
+        syncTasks = storage.getAllTasks();
+    });
+    const double syncNs = ctx.last().nsPerOp;
+
+    std::vector<Task> pipedTasks;
+    size_t writes = 0;
+    ctx.run("runPipelined, grouped writes", commands, [&] {
+        std::filesystem::copy_file(seed, pipedPath, std::filesystem::copy_options::overwrite_existing);
+        Storage storage(pipedPath.string());
+        CLI cli(storage);
+        Bench::SilenceStdout quiet;
+        withInput(script, [&] { writes = cli.runPipelined(); });
+        pipedTasks = storage.getAllTasks();
+    });
+    const double pipedNs = ctx.last().nsPerOp;
+
+    std::printf("  %-40s %8zu for %zu commands\n", "store writes, pipelined", writes, commands);
+    std::printf("  %-40s %8.1fx\n", "pipelined speedup", syncNs / pipedNs);
+    ctx.check(writes > 0 && writes * 20 < commands, "pipelined writes are grouped (< 1 per 20 commands)");
+    ctx.check(pipedNs < syncNs, "pipelined beats the synchronous loop");
+    ctx.check(sameIgnoringCompletedAt(syncTasks, pipedTasks), "both loops leave the same tasks in memory");
+    Storage reopened(pipedPath.string());
+    ctx.check(sameIgnoringCompletedAt(reopened.getAllTasks(), syncTasks), "every pipelined change is on disk");
+
+    std::filesystem::remove_all(root);
+}
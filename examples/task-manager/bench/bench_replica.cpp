@@ -0,0 +1,158 @@
+// Change-log replication: what the log costs the writer, how fast a replica
+// applies it, and replication lag while a follower thread tails a primary
+// under sustained writes
+#include "bench.h"
+#include "dataset.h"
+#include "storage.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+double percentileMs(const std::vector<std::int64_t>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    const auto index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+    return static_cast<double>(sorted[index]) * 1e-6;
+}
+
+}  // namespace
+
+BENCH_CASE(replica) {
+    const auto root = Bench::tempPath("replica");
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    Bench::DatasetSpec spec = ctx.spec();
+    spec.tasks = std::min<size_t>(spec.tasks, 10000);
+    const auto path = root / "tasks.bin";
+    Bench::writeDataset(spec, path);
+
+    Storage primary(path.string());
+    primary.setQuiet(true);
+    const int existing = static_cast<int>(spec.tasks);
+    const size_t edits = 5000;
+    ctx.run("setPriority, binary store, no change log", edits, [&] {
+        for (size_t i = 0; i < edits; ++i) primary.setPriority(static_cast<int>(i) % existing + 1, static_cast<int>(i % 10));
+    });
+    const double plainNs = ctx.last().nsPerOp;
+    primary.enableChangeLog();
+    ctx.run("setPriority, binary store, change log", edits, [&] {
+        for (size_t i = 0; i < edits; ++i) primary.setPriority(static_cast<int>(i) % existing + 1, static_cast<int>(9 - i % 10));
+    });
+    std::printf("  %-40s %8.2f us per change\n", "change log overhead", (ctx.last().nsPerOp - plainNs) * 1e-3);
+
+    Storage replica = Storage::replica(path.string());
+    ctx.check(replica.changeLsn() == primary.changeLsn() && Bench::sameTasks(replica.getAllTasks(), primary.getAllTasks()),
+              "a new replica starts at the primary's state");
+    for (size_t i = 0; i < edits; ++i) primary.setDue(static_cast<int>(i) % existing + 1, 1800000000 + static_cast<std::int64_t>(i));
+    size_t applied = 0;
+    ctx.run("catchUp, one change set each", edits, [&] { applied = replica.catchUp(); });
+    ctx.check(applied == edits && Bench::sameTasks(replica.getAllTasks(), primary.getAllTasks()) &&
+                  replica.getUpcoming(5).size() == 5,
+              "catchUp applies every change set in order");
+    bool readOnly = false;
+    try {
+        replica.addTask("written to a replica");
+    } catch (const std::runtime_error&) {
+        readOnly = true;
+    }
+    ctx.check(readOnly && replica.getAllTasks().size() == primary.getAllTasks().size(), "replicas reject changes");
+
+    // Sustained writes: adds, completes and tags as fast as the primary takes
+    // them, with a follower thread polling the log. The writer stamps each
+    // change set before making it; the follower measures when it sees it.
+    const size_t writes = 20000;
+    const std::uint64_t base = primary.changeLsn();
+    // Log rewrites take an LSN of their own, so leave room
+    std::vector<std::atomic<std::int64_t>> stamps(writes * 2 + 16);
+    std::atomic<bool> writing{true};
+    std::vector<std::int64_t> lags;
+    lags.reserve(writes);
+    size_t polls = 0;
+    std::thread follower([&] {
+        std::uint64_t seen = replica.changeLsn();
+        while (true) {
+            const bool last = !writing.load();
+            if (replica.catchUp() == 0) {
+                if (last) break;
+                std::this_thread::yield();
+                continue;
+            }
+            ++polls;
+            const std::int64_t now = nowNs();
+            const std::uint64_t lsn = replica.changeLsn();
+            for (std::uint64_t l = seen + 1; l <= lsn; ++l) {
+                const std::uint64_t slot = l - base;
+                if (slot >= stamps.size()) break;
+                if (auto stamp = stamps[slot].load(); stamp != 0) lags.push_back(now - stamp);
+            }
+            seen = lsn;
+        }
+    });
+    ctx.run("sustained writes, follower tailing", writes, [&] {
+        for (size_t i = 0; i < writes; ++i) {
+            const std::uint64_t next = primary.changeLsn() + 1 - base;
+            if (next < stamps.size()) stamps[next].store(nowNs());
+            const int id = static_cast<int>(i / 3) % existing + 1;
+            switch (i % 3) {
+                case 0:
+                    primary.addTask("Replicated task " + std::to_string(i));
+                    break;
+                case 1:
+                    primary.completeTask(id);
+                    break;
+                default:
+                    primary.setPriority(id, static_cast<int>(i % 10));
+                    break;
+            }
+        }
+    });
+    writing = false;
+    follower.join();
+
+    std::sort(lags.begin(), lags.end());
+    std::printf("  %-40s %8.3f ms p50, %.3f ms p99, %.3f ms max (%zu polls)\n", "replication lag", percentileMs(lags, 0.5),
+                percentileMs(lags, 0.99), percentileMs(lags, 1.0), polls);
+    ctx.check(replica.changeLsn() == primary.changeLsn() && Bench::sameTasks(replica.getAllTasks(), primary.getAllTasks()),
+              "the replica converges on the primary");
+    ctx.check(lags.size() * 10 >= writes * 9, "lag measured for most change sets");
+    ctx.check(percentileMs(lags, 0.99) < 250.0, "p99 replication lag < 250 ms");
+
+    // Queued JSON writes (batch mode): a change set is committed by its write
+    // job once the file holds it, so a write that fails never reaches a replica
+    {
+        const auto jsonPath = root / "queued.json";
+        Storage queued(jsonPath.string());
+        queued.setQuiet(true);
+        queued.setAutoSave(false);
+        queued.addTask("saved");
+        queued.enableChangeLog();
+        Storage behind = Storage::replica(jsonPath.string());
+        queued.addTask("lost with its write");
+        auto write = queued.saveJob();
+        std::filesystem::create_directories(jsonPath);  // Cannot be opened as a file
+        bool failed = false;
+        try {
+            write();
+        } catch (const std::runtime_error&) {
+            failed = true;
+        }
+        const bool hidden = behind.catchUp() == 0 && behind.getTaskCount() == 1;
+        std::filesystem::remove(jsonPath);
+        queued.saveJob()();
+        ctx.check(failed && hidden && behind.catchUp() == 1 && Bench::sameTasks(behind.getAllTasks(), queued.getAllTasks()),
+                  "a failed queued write commits no change set");
+    }
+
+    std::filesystem::remove_all(root);
+}
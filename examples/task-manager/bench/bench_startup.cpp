@@ -0,0 +1,64 @@
+// Cold start: opening a store that does not exist yet (must not write
+// anything), opening a small existing one, and a whole `tm` process
+#include "bench.h"
+#include "dataset.h"
+#include "storage.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+BENCH_CASE(startup) {
+    const auto root = Bench::tempPath("startup-root");
+    std::filesystem::remove_all(root);
+    const auto freshPath = (root / "nested" / "tasks.json").string();
+
+    const size_t opens = 200;
+    ctx.run("Storage(), store does not exist", opens, [&] {
+        for (size_t i = 0; i < opens; ++i) {
+            Storage storage(freshPath);
+            Bench::doNotOptimize(storage.getTaskCount());
+        }
+    });
+    ctx.check(ctx.last().nsPerOp < 1e6, "opening a fresh store takes < 1 ms");
+    ctx.check(!std::filesystem::exists(root), "opening a fresh store writes nothing");
+
+    {
+        Bench::SilenceStdout quiet;
+        Storage storage(freshPath);
+        storage.addTask("first change creates the file");
+    }
+    ctx.check(std::filesystem::exists(freshPath), "first change creates the store and its directory");
+
+    // A typical personal store: a few hundred tasks
+    Bench::DatasetSpec small = ctx.spec();
+    small.tasks = 300;
+    const auto smallPath = root / "small.json";
+    Bench::writeDataset(small, smallPath);
+    ctx.run("Storage(), 300 tasks", opens, [&] {
+        for (size_t i = 0; i < opens; ++i) {
+            Storage storage(smallPath.string());
+            Bench::doNotOptimize(storage.getTaskCount());
+        }
+    }, static_cast<size_t>(std::filesystem::file_size(smallPath)));
+    ctx.check(ctx.last().nsPerOp < 1e6, "opening a 300-task store takes < 1 ms");
+
+    // The CLI next to this binary (build/app); the optimized bench build has none
+    const auto tm = Bench::siblingExecutable("tm");
+    if (tm.empty()) {
+        std::printf("  %-40s %s\n", "tm process", "skipped (no tm binary next to tm-bench)");
+    } else {
+        const auto storeDir = root / "cli";
+        const size_t runs = 20;
+        bool clean = true;
+        ctx.run("tm process, fresh store, stdin at EOF", runs, [&] {
+            for (size_t i = 0; i < runs; ++i) {
+                clean = Bench::runProcess({tm.string(), "--store-dir", storeDir.string()}) && clean;
+            }
+        });
+        std::printf("  %-40s %11.2f ms\n", "tm cold start", ctx.last().nsPerOp * 1e-6);
+        ctx.check(clean && !std::filesystem::exists(storeDir), "tm exits cleanly without creating a store");
+        ctx.check(ctx.last().nsPerOp < 20e6, "tm cold start < 20 ms");
+    }
+
+    std::filesystem::remove_all(root);
+}
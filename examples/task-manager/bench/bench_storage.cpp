@@ -0,0 +1,68 @@
+// Core Storage operations and list rendering on a generated dataset
+#include "bench.h"
+#include "cli.h"
+#include "storage.h"
+#include <algorithm>
+#include <optional>
+#include <string>
+
+BENCH_CASE(storage) {
+    const size_t n = ctx.size();
+    auto path = Bench::tempPath("storage.json");
+    Bench::writeDataset(ctx.spec(), path);
+    const auto fileBytes = static_cast<size_t>(std::filesystem::file_size(path));
+    Bench::Rng rng(ctx.spec().seed ^ 0x5eed);
+
+    std::optional<Storage> storage;
+    ctx.run("Storage::load", n, [&] { storage.emplace(path.string()); }, fileBytes);
+
+    const size_t saves = 5;
+    ctx.run("Storage::save", saves * n, [&] {
+        for (size_t i = 0; i < saves; ++i) storage->save();
+    }, saves * fileBytes);
+
+    CLI cli(*storage);
+    ctx.run("CLI::handleList (rows)", n, [&] {
+        Bench::SilenceStdout quiet;
+        cli.parseCommand("list");
+    });
+
+    const size_t lookups = 1000000;
+    std::vector<int> ids(lookups);
+    for (auto& id : ids) id = static_cast<int>(rng.below(n) + 1);
+    ctx.run("Storage::findTaskById", lookups, [&] {
+        for (int id : ids) Bench::doNotOptimize(storage->findTaskById(id).getId());
+    });
+
+    storage->setAutoSave(false);
+
+    const size_t completes = std::min<size_t>(n, 100000);
+    ctx.run("Storage::completeTask", completes, [&] {
+        for (size_t i = 0; i < completes; ++i) storage->completeTask(ids[i]);
+    });
+
+    // Deletes shift the vector, so use fewer of them
+    const size_t deletes = std::max<size_t>(1, std::min<size_t>(n / 10, 1000));
+    std::vector<int> victims;
+    for (size_t i = 0; victims.size() < deletes && i < n; ++i) victims.push_back(static_cast<int>(n - i * 7 % n));
+    std::sort(victims.begin(), victims.end());
+    victims.erase(std::unique(victims.begin(), victims.end()), victims.end());
+    ctx.run("Storage::deleteTask", victims.size(), [&] {
+        for (int id : victims) storage->deleteTask(id);
+    });
+
+    auto fresh = Bench::generateTasks(ctx.spec());
+    ctx.run("Storage::addTask", fresh.size(), [&] {
+        for (auto& task : fresh) storage->addTask(std::move(task.description));
+    });
+
+    // What one interactive 'add' costs: the in-memory insert plus a full save
+    storage->setAutoSave(true);
+    const size_t savedAdds = 10;
+    ctx.run("Storage::addTask (auto-save)", savedAdds, [&] {
+        for (size_t i = 0; i < savedAdds; ++i) storage->addTask("Auto-saved benchmark task");
+    });
+
+    storage.reset();
+    std::filesystem::remove(path);
+}
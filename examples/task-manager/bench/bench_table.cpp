@@ -0,0 +1,68 @@
+// List rendering throughput (rows/second), against the old per-row stringstream path
+#include "bench.h"
+#include "table.h"
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+#ifdef _WIN32
+static const char* const NULL_DEVICE = "NUL";
+#else
+static const char* const NULL_DEVICE = "/dev/null";
+#endif
+
+// CLI::handleList as it was before TableRenderer
+static void legacyList(std::ostream& out, const std::vector<Task>& tasks) {
+    const int width = 70;
+    std::string border(width, '=');
+    std::string sep(width, '-');
+    out << border << "\n";
+    out << "| " << std::setw(width - 4) << std::left << "TASKS" << " |\n";
+    out << sep << "\n";
+    for (const auto& task : tasks) {
+        std::string status = task.isCompleted() ? "[C]" : "[P]";
+        std::stringstream line;
+        line << "| #" << std::setw(3) << std::right << task.getId() << " " << status << " " << std::left
+             << task.getDescription();
+        std::string output = line.str();
+        if ((int)output.size() > width - 1) {
+            output = output.substr(0, width - 4) + "... |";
+        } else {
+            output += std::string(width - 1 - output.size(), ' ') + "|";
+        }
+        out << output << "\n";
+        out.flush();  // std::cout on a terminal is line-buffered
+    }
+    out << sep << "\n" << border << "\n";
+}
+
+BENCH_CASE(table) {
+    const size_t n = ctx.size();
+    std::vector<Task> tasks;
+    tasks.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        int id = static_cast<int>(i + 1);
+        tasks.emplace_back(id, "Render benchmark task " + std::to_string(id) + std::string(i % 60, 'x'), i % 3 == 0);
+    }
+
+    std::FILE* sink = std::fopen(NULL_DEVICE, "w");
+    if (!sink) {
+        ctx.check(false, std::string("open ") + NULL_DEVICE);
+        return;
+    }
+    OutputSink out(fileno(sink));
+    TableRenderer renderer(out);
+    renderer.setWidth(100);
+    ctx.run("TableRenderer::render (rows)", n, [&] {
+        renderer.render(tasks, "TASKS");
+        out.flush();
+    });
+    std::printf("  %-40s %12zu\n", "write calls", out.writeCalls());
+
+    std::ofstream legacy(NULL_DEVICE);
+    ctx.run("legacy stringstream list (rows)", n, [&] { legacyList(legacy, tasks); });
+
+    std::fclose(sink);
+}
@@ -0,0 +1,119 @@
+// libtaskstore C API: in-process calls against running `tm` once per
+// operation, and allocation-free hot paths
+#include "bench.h"
+#include "taskstore.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+int countPending(const ts_task* task, void* user) {
+    if (!task->completed) ++*static_cast<size_t*>(user);
+    return 0;
+}
+
+}  // namespace
+
+BENCH_CASE(taskstore) {
+    const auto root = Bench::tempPath("taskstore");
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    // A store the size of a busy personal list
+    Bench::DatasetSpec spec = ctx.spec();
+    spec.tasks = 1000;
+    const auto jsonPath = root / "tasks.json";
+    Bench::writeDataset(spec, jsonPath);
+    const std::string description = "Task added through the C API";
+
+    ts_store* json = nullptr;
+    if (ts_open(jsonPath.string().c_str(), &json) != TS_OK) {
+        ctx.check(false, "ts_open " + jsonPath.string());
+        return;
+    }
+    const size_t jsonAdds = 200;
+    bool ok = true;
+    ctx.run("ts_add, JSON store, autosave", jsonAdds, [&] {
+        for (size_t i = 0; i < jsonAdds; ++i) ok = ts_add(json, description.data(), description.size(), nullptr) == TS_OK && ok;
+    });
+    const double jsonAddNs = ctx.last().nsPerOp;
+    ctx.check(ok && ts_count(json) == spec.tasks + jsonAdds, "ts_add persists every task");
+    ts_close(json);
+
+    ts_store* bin = nullptr;
+    const auto binPath = root / "tasks.bin";
+    ts_open(binPath.string().c_str(), &bin);
+    const size_t binAdds = 20000;
+    ok = bin != nullptr;
+    ctx.run("ts_add, binary store, autosave", binAdds, [&] {
+        for (size_t i = 0; i < binAdds && ok; ++i) ok = ts_add(bin, description.data(), description.size(), nullptr) == TS_OK;
+    });
+    const double binAddNs = ctx.last().nsPerOp;
+    ctx.check(ok && ts_count(bin) == binAdds, "binary store takes every task");
+    // The description and the record's slot, plus the odd reallocation of a growing index
+    ctx.check(ctx.last().allocsPerOp < 2.1, "ts_add allocates twice per task (see taskstore.h)");
+
+    // Hot paths: no heap allocation per call (a growing pending-change list
+    // still reallocates now and then)
+    ok = ok && ts_set_autosave(bin, 0) == TS_OK;
+    ctx.run("ts_complete, in memory", binAdds / 2, [&] {
+        for (int id = 1; id <= static_cast<int>(binAdds / 2); ++id) ok = ts_complete(bin, id) == TS_OK && ok;
+    });
+    ctx.check(ok && ctx.last().allocsPerOp < 0.01, "ts_complete allocates nothing");
+    ts_task task{};
+    ctx.run("ts_get", binAdds, [&] {
+        for (int id = 1; id <= static_cast<int>(binAdds); ++id) ok = ts_get(bin, id, &task) == TS_OK && ok;
+    });
+    ctx.check(ok && ctx.last().allocsPerOp == 0.0 && std::string(task.description, task.description_len) == description,
+              "ts_get allocates nothing");
+    size_t pending = 0;
+    ctx.run("ts_iterate (tasks)", binAdds, [&] { ts_iterate(bin, countPending, &pending); });
+    ctx.check(pending == binAdds / 2 && ctx.last().allocsPerOp == 0.0, "ts_iterate allocates nothing");
+    ctx.run("ts_delete, in memory", 100, [&] {
+        for (int id = 1; id <= 100; ++id) ok = ts_delete(bin, static_cast<int>(binAdds) + 1 - id) == TS_OK && ok;
+    });
+    ctx.check(ok && ctx.last().allocsPerOp < 0.01, "ts_delete allocates nothing");
+    ctx.check(ts_delete(bin, static_cast<int>(binAdds) + 1) == TS_NOT_FOUND && ts_get(bin, 0, &task) == TS_NOT_FOUND &&
+                  ts_add(bin, "", 0, nullptr) == TS_INVALID_ARGUMENT && *ts_last_error(bin) != '\0',
+              "errors come back as status codes");
+    ts_close(bin);
+
+    // The same add through the CLI: a process, a full load and a full save per task
+    const auto tm = Bench::siblingExecutable("tm");
+    if (tm.empty()) {
+        std::printf("  %-40s %s\n", "shell out to tm", "skipped (no tm binary next to tm-bench)");
+    } else {
+        const auto input = root / "input.txt";
+        std::ofstream(input) << "add " << description << "\nquit\n";
+        const size_t runs = 20;
+        ok = true;
+        ctx.run("shell out: tm add, JSON store", runs, [&] {
+            for (size_t i = 0; i < runs; ++i) ok = Bench::runProcess({tm.string(), "--store-dir", root.string()}, input) && ok;
+        });
+        const double shellNs = ctx.last().nsPerOp;
+        ts_open(jsonPath.string().c_str(), &json);
+        ctx.check(ok && json && ts_count(json) == spec.tasks + jsonAdds + runs, "every shelled-out add lands");
+        ts_close(json);
+        std::printf("  %-40s %8.0fx (JSON), %.0fx (binary)\n", "in-process speedup over shelling out",
+                    shellNs / jsonAddNs, shellNs / binAddNs);
+        ctx.check(jsonAddNs * 5 < shellNs && binAddNs * 100 < shellNs, "in-process adds beat shelling out");
+    }
+
+    // Loading is quiet too: a store with a damaged dependency file opens
+    // without a word on the host's streams
+    const auto quietPath = root / "quiet.json";
+    std::ofstream(quietPath) << "{\"nextId\": 1, \"tasks\": []}";
+    std::ofstream(std::filesystem::path(quietPath).replace_extension(".deps")) << "not a dependency file";
+    std::ostringstream captured;
+    auto* saved = std::cerr.rdbuf(captured.rdbuf());
+    ts_store* quiet = nullptr;
+    const ts_status opened = ts_open(quietPath.string().c_str(), &quiet);
+    std::cerr.rdbuf(saved);
+    ctx.check(opened == TS_OK && captured.str().empty(), "ts_open prints nothing while loading");
+    ts_close(quiet);
+
+    std::filesystem::remove_all(root);
+}
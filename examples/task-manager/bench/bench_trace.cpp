@@ -0,0 +1,68 @@
+// Cost of trace spans and ring-buffer behaviour
+#include "bench.h"
+#include "parallel.h"
+#include "trace.h"
+#include <algorithm>
+#include <string>
+#include <thread>
+
+BENCH_CASE(trace) {
+    const size_t n = std::max<size_t>(ctx.size() * 10, Trace::RING_CAPACITY * 2);
+
+    Trace::setEnabled(false);
+    Trace::clear();
+    ctx.run("TRACE_SCOPE (disabled)", n, [&] {
+        for (size_t i = 0; i < n; ++i) {
+            TRACE_SCOPE("bench");
+            Bench::doNotOptimize(i);
+        }
+    });
+    ctx.check(ctx.last().nsPerOp < 5.0, "disabled span costs < 5 ns");
+
+    Trace::setEnabled(true);
+    ctx.run("TRACE_SCOPE (enabled)", n, [&] {
+        for (size_t i = 0; i < n; ++i) {
+            TRACE_SCOPE("bench");
+            Bench::doNotOptimize(i);
+        }
+    });
+    ctx.check(Trace::eventCount() == Trace::RING_CAPACITY - 1, "ring keeps the newest spans");
+
+    // Every worker thread gets its own ring
+    Trace::clear();
+    Parallel::setThreadCount(ctx.maxThreads());
+    const size_t items = Parallel::MIN_GRAIN * 8;
+    Parallel::forRange(items, [](size_t begin, size_t end) {
+        TRACE_SCOPE("chunk");
+        Bench::doNotOptimize(end - begin);
+    });
+    ctx.check(Trace::eventCount() > 0 && Trace::eventCount() <= 8, "parallel chunks traced once each");
+
+    // Threads that come and go hand their rings on: pools rebuilt over and
+    // over need no more rings than the first time round
+    auto churn = [&] {
+        for (int round = 0; round < 8; ++round) {
+            Parallel::setThreadCount(round % 2 ? 2 : ctx.maxThreads());
+            Parallel::forRange(items, [](size_t begin, size_t end) {
+                TRACE_SCOPE("chunk");
+                Bench::doNotOptimize(end - begin);
+            });
+        }
+        for (int i = 0; i < 16; ++i) {
+            std::thread([] { TRACE_SCOPE("short-lived thread"); }).join();
+        }
+    };
+    churn();
+    const size_t rings = Trace::ringCount();
+    churn();
+    ctx.check(Trace::ringCount() == rings, "exited threads' rings are reused");
+
+    std::string json;
+    ctx.run("Trace::toChromeJson", 1, [&] { json = Trace::toChromeJson(); });
+    ctx.check(json.rfind("{\"displayTimeUnit\"", 0) == 0 && json.find("\"name\":\"chunk\"") != std::string::npos,
+              "chrome trace contains spans");
+
+    Trace::setEnabled(false);
+    Trace::clear();
+    Parallel::setThreadCount(0);
+}
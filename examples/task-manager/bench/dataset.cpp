@@ -0,0 +1,95 @@
+#include "dataset.h"
+#include "bench.h"
+#include "storage.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Bench {
+
+static const char* const WORDS[] = {
+    "review", "update", "deploy", "fix",     "write",   "call",    "email",  "plan",    "test",   "refactor",
+    "report", "budget", "meeting", "server", "client",  "invoice", "draft",  "release", "backup", "schedule",
+    "design", "docs",   "api",     "cache",  "metrics", "alert",   "ticket", "sprint",  "notes",  "migration",
+};
+static const size_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+static const char* const TAGS[] = {"work", "home", "urgent", "later", "errand", "review", "ops", "docs"};
+static const size_t TAG_COUNT = sizeof(TAGS) / sizeof(TAGS[0]);
+
+double Rng::normal(double mean, double stddev) {
+    // Box-Muller; one value per call keeps the sequence simple to reproduce
+    double u1 = std::max(uniform(), 1e-300);
+    double u2 = uniform();
+    return mean + stddev * std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * 3.14159265358979323846 * u2);
+}
+
+std::vector<GeneratedTask> generateTasks(const DatasetSpec& spec) {
+    Rng rng(spec.seed);
+    // Separate stream so completion times do not shift the other fields
+    Rng completionRng(spec.seed ^ 0xC0FFEEull);
+    std::vector<GeneratedTask> out;
+    out.reserve(spec.tasks);
+
+    for (size_t i = 0; i < spec.tasks; ++i) {
+        double wanted = rng.normal(spec.meanDescLength, spec.stddevDescLength);
+        auto length = static_cast<size_t>(std::clamp(wanted, static_cast<double>(std::max<size_t>(spec.minDescLength, 1)),
+                                                     static_cast<double>(spec.maxDescLength)));
+        GeneratedTask task;
+        task.description.reserve(length + 16);
+        while (task.description.size() < length) {
+            if (!task.description.empty()) task.description += ' ';
+            task.description += WORDS[rng.below(WORD_COUNT)];
+        }
+        task.description.resize(length);
+        while (task.description.back() == ' ') task.description.back() = 'x';
+
+        task.completed = rng.uniform() < spec.completedRatio;
+        task.completedAt = task.completed ? 1735689600 + static_cast<std::int64_t>(completionRng.below(365 * 86400))
+                                          : Task::UNKNOWN_TIME;
+        task.priority = static_cast<int>(rng.below(Task::MAX_PRIORITY + 1));
+        // Due dates spread over one year from 2026-01-01
+        task.due = rng.uniform() < spec.dueRatio ? 1767225600 + static_cast<std::int64_t>(rng.below(365)) * 86400
+                                                 : Task::NO_DUE;
+        if (rng.uniform() < spec.taggedRatio) {
+            size_t first = rng.below(TAG_COUNT);
+            task.tags.emplace_back(TAGS[first]);
+            if (rng.uniform() < 0.5) task.tags.emplace_back(TAGS[(first + 1 + rng.below(TAG_COUNT - 1)) % TAG_COUNT]);
+        }
+        out.push_back(std::move(task));
+    }
+    return out;
+}
+
+bool sameTasks(const std::vector<Task>& a, const std::vector<Task>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].getId() != b[i].getId() || a[i].getDescription() != b[i].getDescription() ||
+            a[i].isCompleted() != b[i].isCompleted() || a[i].getCompletedAt() != b[i].getCompletedAt() ||
+            a[i].getPriority() != b[i].getPriority() || a[i].getDue() != b[i].getDue() ||
+            a[i].getTags() != b[i].getTags()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void writeDataset(const DatasetSpec& spec, const std::filesystem::path& path) {
+    std::filesystem::remove(path);
+    Storage storage(path.string());
+    storage.setAutoSave(false);
+    auto tasks = generateTasks(spec);
+    for (auto& task : tasks) {
+        int id = storage.addTask(std::move(task.description));
+        storage.setPriority(id, task.priority);
+        if (task.due != Task::NO_DUE) storage.setDue(id, task.due);
+        for (const auto& tag : task.tags) storage.addTag(id, tag);
+        if (task.completed) storage.completeTask(id);
+    }
+    // completeTask() stamps the wall clock; pin the generated times instead (IDs start at 1)
+    storage.forEachIf([](const Task& task) { return task.isCompleted(); },
+                      [&](Task& task) { task.setCompletedAt(tasks[static_cast<size_t>(task.getId() - 1)].completedAt); });
+    SilenceStdout quiet;  // The first save announces the new file
+    storage.save();
+}
+
+}  // namespace Bench
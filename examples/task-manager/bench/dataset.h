@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "task.h"
+
+namespace Bench {
+
+/// Parameters of a synthetic task store. The same spec always yields the same
+/// tasks on every platform (own PRNG and distributions, no <random> engines).
+struct DatasetSpec {
+    size_t tasks = 100000;
+    size_t minDescLength = 8;
+    size_t maxDescLength = 120;
+    double meanDescLength = 40.0;  // Normal distribution clamped to [min, max]
+    double stddevDescLength = 15.0;
+    double completedRatio = 0.3;
+    double dueRatio = 0.5;          // Tasks with a due date
+    double taggedRatio = 0.4;       // Tasks with one or two tags
+    std::uint64_t seed = 42;
+};
+
+/// splitmix64: tiny, fast and identical everywhere
+class Rng {
+public:
+    explicit Rng(std::uint64_t seed) : state_(seed) {}
+
+    std::uint64_t next() {
+        std::uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, 1)
+    double uniform() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+    // Uniform in [0, bound)
+    size_t below(size_t bound) { return static_cast<size_t>(next() % bound); }
+    double normal(double mean, double stddev);
+
+private:
+    std::uint64_t state_;
+};
+
+struct GeneratedTask {
+    std::string description;
+    bool completed;
+    std::int64_t completedAt;  // Spread over 2025 for completed tasks
+    int priority;
+    std::int64_t due;
+    std::vector<std::string> tags;
+};
+
+std::vector<GeneratedTask> generateTasks(const DatasetSpec& spec);
+
+// Field-by-field equality of two task lists
+bool sameTasks(const std::vector<Task>& a, const std::vector<Task>& b);
+
+// Write the dataset through Storage so it matches the current file format
+void writeDataset(const DatasetSpec& spec, const std::filesystem::path& path);
+
+}  // namespace Bench
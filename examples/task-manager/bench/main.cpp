@@ -0,0 +1,243 @@
+#include "bench.h"
+#include "output.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+#ifdef _WIN32
+#  include <io.h>
+#  define dup _dup
+#  define dup2 _dup2
+#  define close _close
+#  define fileno _fileno
+#else
+#  include <fcntl.h>
+#  include <spawn.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+extern char** environ;
+#endif
+
+namespace Bench {
+
+namespace {
+
+struct Case {
+    const char* name;
+    CaseFn fn;
+};
+
+std::vector<Case>& registry() {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+}  // namespace
+
+Registrar::Registrar(const char* name, CaseFn fn) { registry().push_back({name, fn}); }
+
+void Context::record(const std::string& name, size_t ops, double ns, size_t allocs, size_t bytes) {
+    double dops = static_cast<double>(ops ? ops : 1);
+    Result r{group_, name, ops, ns / dops, static_cast<double>(allocs) / dops, ns > 0 ? dops * 1e9 / ns : 0.0,
+             ns > 0 && bytes ? static_cast<double>(bytes) * 1e9 / ns : 0.0};
+    std::printf("  %-40s %10zu ops %12.1f ns/op %9.2f allocs/op", r.name.c_str(), r.ops, r.nsPerOp, r.allocsPerOp);
+    if (r.bytesPerSec > 0) std::printf(" %9.1f MB/s", r.bytesPerSec / 1e6);
+    std::printf("\n");
+    std::fflush(stdout);
+    results_.push_back(std::move(r));
+}
+
+void Context::check(bool ok, const std::string& what) {
+    std::printf("  %-40s %s\n", what.c_str(), ok ? "PASS" : "FAIL");
+    checks_.push_back({group_, what, ok});
+    if (!ok) failed_ = true;
+}
+
+std::filesystem::path tempPath(const std::string& name) {
+    return std::filesystem::temp_directory_path() / ("tm-bench-" + name);
+}
+
+#ifdef _WIN32
+static const char* const NULL_DEVICE = "NUL";
+#else
+static const char* const NULL_DEVICE = "/dev/null";
+#endif
+
+std::filesystem::path siblingExecutable(const std::string& name) {
+    std::error_code ec;
+#ifdef _WIN32
+    (void)name;
+    return {};
+#else
+    auto path = std::filesystem::read_symlink("/proc/self/exe", ec).parent_path() / name;
+    return !ec && std::filesystem::exists(path, ec) ? path : std::filesystem::path();
+#endif
+}
+
+bool runProcess(const std::vector<std::string>& args, const std::filesystem::path& input) {
+#ifdef _WIN32
+    (void)args;
+    (void)input;
+    return false;
+#else
+    if (args.empty()) return false;
+    std::string stdinPath = input.empty() ? std::string(NULL_DEVICE) : input.string();
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 0, stdinPath.c_str(), O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, 1, NULL_DEVICE, O_WRONLY, 0);
+    std::vector<char*> argv;
+    for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+    pid_t pid = 0;
+    int rc = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    int status = 0;
+    return rc == 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+}
+
+SilenceStdout::SilenceStdout() : saved_(-1) {
+    OutputSink::console().flush();
+    std::cout.flush();
+    std::fflush(stdout);
+    if (std::FILE* null = std::fopen(NULL_DEVICE, "w")) {
+        saved_ = dup(fileno(stdout));
+        dup2(fileno(null), fileno(stdout));
+        std::fclose(null);
+    }
+}
+
+SilenceStdout::~SilenceStdout() {
+    OutputSink::console().flush();
+    std::cout.flush();
+    std::fflush(stdout);
+    if (saved_ >= 0) {
+        dup2(saved_, fileno(stdout));
+        close(saved_);
+    }
+}
+
+}  // namespace Bench
+
+static void usage(const char* argv0) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --size N             tasks in generated datasets (default 100000)\n"
+        "  --seed N             dataset seed (default 42)\n"
+        "  --desc-mean N        mean description length (default 40)\n"
+        "  --desc-min/max N     description length bounds (default 8/120)\n"
+        "  --completed R        completed ratio 0..1 (default 0.3)\n"
+        "  --threads N          upper end of thread-scaling runs\n"
+        "  --filter TEXT        only run cases whose name contains TEXT\n"
+        "  --json FILE          also write results as JSON\n"
+        "  --generate FILE      write a dataset to FILE and exit\n"
+        "  --list               list cases\n",
+        argv0);
+}
+
+static void writeJson(const Bench::Context& ctx, const std::string& path) {
+    using json = nlohmann::json;
+    const auto& spec = ctx.spec();
+    json benchmarks = json::array();
+    for (const auto& r : ctx.results()) {
+        json entry = {{"case", r.group},           {"name", r.name},
+                      {"ops", r.ops},              {"ns_per_op", r.nsPerOp},
+                      {"allocs_per_op", r.allocsPerOp}, {"ops_per_sec", r.opsPerSec}};
+        if (r.bytesPerSec > 0) entry["bytes_per_sec"] = r.bytesPerSec;
+        benchmarks.push_back(std::move(entry));
+    }
+    json checks = json::array();
+    for (const auto& c : ctx.checks()) {
+        checks.push_back({{"case", c.group}, {"name", c.name}, {"passed", c.passed}});
+    }
+    json doc = {
+        {"context",
+         {{"timestamp", static_cast<long long>(std::time(nullptr))},
+          {"max_threads", ctx.maxThreads()},
+          {"dataset",
+           {{"tasks", spec.tasks},
+            {"seed", spec.seed},
+            {"desc_mean", spec.meanDescLength},
+            {"desc_min", spec.minDescLength},
+            {"desc_max", spec.maxDescLength},
+            {"completed_ratio", spec.completedRatio}}}}},
+        {"benchmarks", benchmarks},
+        {"checks", checks}};
+    std::ofstream(path) << doc.dump(2) << "\n";
+}
+
+int main(int argc, char** argv) {
+    Bench::DatasetSpec spec;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::string filter, jsonPath, generatePath;
+    bool listOnly = false;
+
+    for (int i = 1; i < argc; ++i) {
+        auto option = [&](const char* name) { return std::strcmp(argv[i], name) == 0 && i + 1 < argc; };
+        if (option("--size")) {
+            spec.tasks = std::strtoull(argv[++i], nullptr, 10);
+        } else if (option("--seed")) {
+            spec.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (option("--desc-mean")) {
+            spec.meanDescLength = std::strtod(argv[++i], nullptr);
+        } else if (option("--desc-min")) {
+            spec.minDescLength = std::strtoull(argv[++i], nullptr, 10);
+        } else if (option("--desc-max")) {
+            spec.maxDescLength = std::strtoull(argv[++i], nullptr, 10);
+        } else if (option("--completed")) {
+            spec.completedRatio = std::strtod(argv[++i], nullptr);
+        } else if (option("--threads")) {
+            threads = static_cast<unsigned>(std::max(1ul, std::strtoul(argv[++i], nullptr, 10)));
+        } else if (option("--filter")) {
+            filter = argv[++i];
+        } else if (option("--json")) {
+            jsonPath = argv[++i];
+        } else if (option("--generate")) {
+            generatePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--list") == 0) {
+            listOnly = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (spec.tasks == 0 || spec.minDescLength > spec.maxDescLength) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (!generatePath.empty()) {
+        Bench::writeDataset(spec, generatePath);
+        std::printf("Wrote %zu tasks to %s\n", spec.tasks, generatePath.c_str());
+        return 0;
+    }
+
+    // Registration order depends on link order; run cases alphabetically
+    auto& cases = Bench::registry();
+    std::sort(cases.begin(), cases.end(), [](const auto& a, const auto& b) { return std::strcmp(a.name, b.name) < 0; });
+
+    Bench::Context ctx(spec, threads);
+    for (const auto& c : cases) {
+        if (!filter.empty() && std::strstr(c.name, filter.c_str()) == nullptr) continue;
+        if (listOnly) {
+            std::printf("%s\n", c.name);
+            continue;
+        }
+        std::printf("[%s] size=%zu\n", c.name, spec.tasks);
+        ctx.beginCase(c.name);
+        c.fn(ctx);
+    }
+    if (!jsonPath.empty()) {
+        writeJson(ctx, jsonPath);
+        std::printf("Results written to %s\n", jsonPath.c_str());
+    }
+    return ctx.failed() ? 1 : 0;
+}
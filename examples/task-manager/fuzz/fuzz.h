@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Differential fuzzing of the persistence formats (fuzz_storage.cpp). Built
+// either as a standalone driver (main.cpp, random inputs or replayed files)
+// or, with FUZZ_ENGINE=libfuzzer, against libFuzzer's LLVMFuzzerTestOneInput.
+namespace Fuzz {
+
+// Decode one input into a sequence of store operations and apply it to an
+// in-memory model and to a store, reloading it along the way: through every
+// encoder in memory, or with files, from a store in every format on disk.
+// Returns the first disagreement, empty if there is none.
+std::string run(const std::uint8_t* data, size_t size, bool files);
+
+// Whether an input is one of the sampled few that run() takes through the files
+bool sampled(const std::uint8_t* data, size_t size);
+
+// Scratch directory for the stores of this process (tmpfs when there is one)
+const std::filesystem::path& workDir();
+
+}  // namespace Fuzz
@@ -0,0 +1,511 @@
+// Differential harness for the persistence formats. One random sequence of
+// operations runs against a plain in-memory model and against a store that is
+// never saved; a reload takes its tasks through one of the encoders and back
+// in memory, and the final one through all of them (pretty and compact JSON,
+// read by the schema-aware reader and by nlohmann, and binary records). One
+// input in FILE_SAMPLE instead runs against
+// the store persisted every way it can be: pretty JSON saved on every change,
+// compact JSON saved only when reloaded, binary records written back
+// incrementally, and a change-logged primary with a replica following its
+// log. Every operation must succeed or fail alike everywhere, and after every
+// reload each store must hold exactly what it held before, which is what the
+// model holds.
+#include "fuzz.h"
+#include "binary_store.h"
+#include "storage.h"
+#include "task_json.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Inputs that also go through the files: those whose hash is a multiple of it
+constexpr std::uint64_t FILE_SAMPLE = 64;
+
+enum class Op : std::uint8_t {
+    Add,
+    Complete,
+    Reopen,
+    Delete,
+    Priority,
+    Due,
+    Tag,
+    Untag,
+    Depend,
+    Undepend,
+    Archive,
+    Reload,
+    Count,
+};
+
+constexpr const char* OP_NAMES[] = {"add",    "complete", "reopen",   "delete",  "priority", "due",
+                                    "tag",    "untag",    "depend",   "undepend", "archive", "reload"};
+static_assert(std::size(OP_NAMES) == static_cast<size_t>(Op::Count));
+
+// Description pieces: JSON escapes, a control character and multi-byte UTF-8
+constexpr std::string_view PIECES[] = {"a", "task", " ", "\"", "\\", "\n", "\t", "\x01", "/", "{}", "\xC3\xA9",
+                                       "\xE6\x97\xA5\xE6\x9C\xAC"};
+// The last three are invalid
+constexpr std::string_view TAGS[] = {"home", "work", "x", "\xC3\xA9t\xC3\xA9", "", "two words", "a\"b"};
+constexpr std::int64_t DUES[] = {Task::NO_DUE, 1, 1700000000, 4102444800, -5};
+
+// Bytes in, decisions out; an exhausted input reads as zeros
+class Input {
+public:
+    Input(const std::uint8_t* data, size_t size) : data_(data), size_(size) {}
+    bool empty() const { return size_ == 0; }
+    unsigned byte() {
+        if (size_ == 0) return 0;
+        --size_;
+        return *data_++;
+    }
+    size_t below(size_t n) { return byte() % n; }
+
+private:
+    const std::uint8_t* data_;
+    size_t size_;
+};
+
+struct Mismatch {
+    std::string what;
+};
+
+struct ModelTask {
+    std::string description;
+    bool completed = false;
+    int priority = 0;
+    std::int64_t due = Task::NO_DUE;
+    std::vector<std::string> tags;
+};
+
+// What every store should hold, kept the simplest possible way
+struct Model {
+    std::map<int, ModelTask> tasks;
+    int nextId = 1;
+    std::set<std::pair<int, int>> edges;  // (blocker, blocked); those of deleted tasks are ignored
+
+    bool has(int id) const { return tasks.count(id) != 0; }
+    bool pending(int id) const {
+        auto it = tasks.find(id);
+        return it != tasks.end() && !it->second.completed;
+    }
+    // A path from -> to over edges between existing tasks
+    bool reaches(int from, int to) const {
+        std::vector<int> stack{from};
+        std::set<int> seen{from};
+        while (!stack.empty()) {
+            const int id = stack.back();
+            stack.pop_back();
+            if (id == to) return true;
+            for (auto it = edges.lower_bound({id, INT_MIN}); it != edges.end() && it->first == id; ++it) {
+                if (has(it->second) && seen.insert(it->second).second) stack.push_back(it->second);
+            }
+        }
+        return false;
+    }
+    // Pending tasks without pending blockers, most urgent first, then by ID
+    std::vector<int> ready() const {
+        std::vector<int> result;
+        for (const auto& [id, task] : tasks) {
+            if (task.completed) continue;
+            bool blocked = false;
+            for (const auto& [blocker, blockedId] : edges) blocked = blocked || (blockedId == id && pending(blocker));
+            if (!blocked) result.push_back(id);
+        }
+        std::stable_sort(result.begin(), result.end(),
+                         [&](int a, int b) { return tasks.at(a).priority > tasks.at(b).priority; });
+        return result;
+    }
+};
+
+// One store and how it is persisted
+struct Subject {
+    const char* name;
+    const char* file;  // Distinct stems: archives, dependencies and logs are named after the store
+    bool autoSave;
+    TaskJson::Style style;
+    bool logged;
+    bool inMemory;     // Never saved: reloads round-trip the encoders in memory instead
+    std::optional<Storage> store;
+    std::optional<Storage> replica;
+
+    fs::path path() const { return Fuzz::workDir() / file; }
+    // Open (or reopen, reloading everything from disk)
+    void open() {
+        store.reset();
+        // Archived tasks are the only thing an unsaved store writes
+        if (inMemory) fs::remove(fs::path(path()).replace_extension(".archive.jsonl"));
+        store.emplace(path().string());
+        store->setQuiet(true);
+        store->setAutoSave(autoSave);
+        store->setJsonStyle(style);
+        if (logged) store->enableChangeLog();
+    }
+};
+
+std::string describe(size_t step, Op op, const Subject& subject) {
+    return "step " + std::to_string(step) + " (" + OP_NAMES[static_cast<size_t>(op)] + ") on " + subject.name + ": ";
+}
+
+// Run fn and say where a disagreement it finds happened; only the one that is
+// reported pays for the description
+template <typename Fn>
+void at(size_t step, Op op, const Subject& subject, Fn fn) {
+    try {
+        fn();
+    } catch (Mismatch& mismatch) {
+        mismatch.what.insert(0, describe(step, op, subject));
+        throw;
+    }
+}
+
+// Everything the model knows about
+void compareWithModel(const Storage& store, const Model& model) {
+    const auto& tasks = store.getAllTasks();
+    if (tasks.size() != model.tasks.size()) {
+        throw Mismatch{std::to_string(tasks.size()) + " tasks, the model has " + std::to_string(model.tasks.size())};
+    }
+    auto expected = model.tasks.begin();
+    for (const Task& task : tasks) {
+        const auto& [id, want] = *expected++;
+        auto differs = [id](const std::string& what) { return Mismatch{"task " + std::to_string(id) + ": " + what}; };
+        if (task.getId() != id) throw differs("found task " + std::to_string(task.getId()) + " instead");
+        if (task.getDescription() != want.description) throw differs("description differs");
+        if (task.isCompleted() != want.completed) throw differs("completion differs");
+        if ((task.getCompletedAt() != Task::UNKNOWN_TIME) != want.completed) throw differs("completion time");
+        if (task.getPriority() != want.priority) throw differs("priority differs");
+        if (task.getDue() != want.due) throw differs("due date differs");
+        if (task.getTags() != want.tags) throw differs("tags differ");
+    }
+}
+
+// A reload must give back exactly what was saved, completion times included
+void compareExact(const std::vector<Task>& before, const std::vector<Task>& after) {
+    if (before.size() != after.size()) throw Mismatch{"reload changed the number of tasks"};
+    for (size_t i = 0; i < before.size(); ++i) {
+        const Task& a = before[i];
+        const Task& b = after[i];
+        if (a.getId() != b.getId() || a.getDescription() != b.getDescription() || a.isCompleted() != b.isCompleted() ||
+            a.getCompletedAt() != b.getCompletedAt() || a.getPriority() != b.getPriority() || a.getDue() != b.getDue() ||
+            a.getTags() != b.getTags()) {
+            throw Mismatch{"reload changed task " + std::to_string(a.getId())};
+        }
+    }
+}
+
+// The in-memory encodings, by bit in roundTrip()'s mask
+constexpr const char* FORMATS[] = {"pretty JSON", "pretty JSON via nlohmann", "compact JSON", "compact JSON via nlohmann",
+                                   "binary"};
+constexpr unsigned ALL_FORMATS = (1u << std::size(FORMATS)) - 1;
+
+// The tasks through the encoders in formats and back, without touching a file
+void roundTrip(const std::vector<Task>& tasks, int nextId, unsigned formats) {
+    // Reused across runs: encoding into warm buffers allocates nothing
+    static std::string text;
+    static std::string records;
+    static std::string heap;
+    static std::vector<Task> decoded;
+    int decodedNextId = 0;
+    auto check = [&](size_t format) {
+        try {
+            compareExact(tasks, decoded);
+            if (decodedNextId != nextId) throw Mismatch{"reload changed the next ID"};
+        } catch (Mismatch& mismatch) {
+            mismatch.what.insert(0, std::string(FORMATS[format]) + ": ");
+            throw;
+        }
+    };
+    for (size_t format = 0; format < 4; format += 2) {
+        if ((formats >> format & 3) == 0) continue;
+        TaskJson::write(text, tasks, nextId, format == 0 ? TaskJson::Style::Pretty : TaskJson::Style::Compact);
+        if (formats >> format & 1) {
+            if (!TaskJson::read(text, decoded, decodedNextId)) {
+                throw Mismatch{std::string(FORMATS[format]) + ": refused by its reader"};
+            }
+            check(format);
+        }
+        if (formats >> (format + 1) & 1) {
+            auto doc = nlohmann::json::parse(text);
+            TaskJson::fromDom(doc, decoded, decodedNextId);
+            check(format + 1);
+        }
+    }
+    if (formats >> 4 & 1) {
+        BinaryStore::encode(tasks, nextId, records, heap);
+        BinaryStore::decode(records, heap, decoded, decodedNextId);
+        check(4);
+    }
+}
+
+void compareReady(const Storage& store, const Model& model) {
+    // Reused across calls, like roundTrip()'s buffers
+    static std::vector<int> ready;
+    ready.clear();
+    for (const Task& task : store.getReady(std::numeric_limits<size_t>::max())) ready.push_back(task.getId());
+    if (ready != model.ready()) throw Mismatch{"ready tasks differ"};
+}
+
+class Run {
+public:
+    explicit Run(bool files) {
+        if (files) {
+            subjects_.push_back({"pretty JSON", "pretty.json", true, TaskJson::Style::Pretty, false, false, {}, {}});
+            subjects_.push_back({"compact JSON", "compact.json", false, TaskJson::Style::Compact, false, false, {}, {}});
+            subjects_.push_back({"binary", "records.bin", true, TaskJson::Style::Pretty, false, false, {}, {}});
+            subjects_.push_back({"change log", "logged.json", true, TaskJson::Style::Compact, true, false, {}, {}});
+        } else {
+            subjects_.push_back({"memory", "memory.json", false, TaskJson::Style::Pretty, false, true, {}, {}});
+        }
+        for (Subject& subject : subjects_) {
+            subject.open();
+            if (subject.logged) subject.replica.emplace(Storage::replica(subject.path().string()));
+        }
+    }
+
+    void execute(Input& in) {
+        while (!in.empty()) {
+            const auto op = static_cast<Op>(in.below(static_cast<size_t>(Op::Count)));
+            step(op, in);
+            // The live stores too: a reload rebuilds what they update in place
+            for (const Subject& subject : subjects_) {
+                at(steps_, op, subject, [&] {
+                    compareWithModel(*subject.store, model_);
+                    compareReady(*subject.store, model_);
+                });
+            }
+            ++steps_;
+        }
+        reload(Op::Reload, ALL_FORMATS);
+    }
+
+private:
+    std::vector<Subject> subjects_;
+    Model model_;
+    size_t steps_ = 0;
+
+    // Mostly a task that exists; one time in eight any ID up to one past the
+    // last handed out, the invalid 0 included. A refused operation costs an
+    // exception, the most expensive thing a step does
+    int pickId(Input& in) const {
+        const unsigned byte = in.byte();
+        if (byte % 8 == 0 || model_.tasks.empty()) {
+            return static_cast<int>((byte / 8) % (static_cast<unsigned>(model_.nextId) + 1));
+        }
+        return std::next(model_.tasks.begin(), static_cast<std::ptrdiff_t>(byte % model_.tasks.size()))->first;
+    }
+
+    // Apply fn to every store: it must succeed where the model says ok and
+    // throw otherwise
+    template <typename Fn>
+    void expect(Op op, bool ok, Fn fn) {
+        for (Subject& subject : subjects_) {
+            at(steps_, op, subject, [&] {
+                try {
+                    fn(*subject.store);
+                } catch (const std::exception& e) {
+                    if (ok) throw Mismatch{std::string("failed: ") + e.what()};
+                    return;
+                }
+                if (!ok) throw Mismatch{"succeeded, the model refuses"};
+            });
+        }
+    }
+
+    void step(Op op, Input& in) {
+        switch (op) {
+            case Op::Add: {
+                std::string description;
+                for (size_t pieces = 1 + in.below(4); pieces > 0; --pieces) description += PIECES[in.below(std::size(PIECES))];
+                const int expected = model_.nextId;
+                expect(op, true, [&](Storage& store) {
+                    if (const int id = store.addTask(description); id != expected) {
+                        throw Mismatch{"new ID " + std::to_string(id) + ", expected " + std::to_string(expected)};
+                    }
+                });
+                model_.tasks[model_.nextId++].description = description;
+                break;
+            }
+            case Op::Complete:
+            case Op::Reopen: {
+                const int id = pickId(in);
+                const bool complete = op == Op::Complete;
+                const bool ok = model_.has(id) && (complete || model_.tasks[id].completed);
+                expect(op, ok, [&](Storage& store) {
+                    complete ? store.completeTask(id) : store.reopenTask(id);
+                });
+                if (ok) model_.tasks[id].completed = complete;
+                break;
+            }
+            case Op::Delete: {
+                const int id = pickId(in);
+                const bool ok = model_.has(id);
+                expect(op, ok, [&](Storage& store) { store.deleteTask(id); });
+                model_.tasks.erase(id);
+                break;
+            }
+            case Op::Priority: {
+                const int id = pickId(in);
+                const int priority = static_cast<int>(in.below(Task::MAX_PRIORITY + 3));
+                const bool ok = model_.has(id) && priority <= Task::MAX_PRIORITY;
+                expect(op, ok, [&](Storage& store) { store.setPriority(id, priority); });
+                if (ok) model_.tasks[id].priority = priority;
+                break;
+            }
+            case Op::Due: {
+                const int id = pickId(in);
+                const std::int64_t due = DUES[in.below(std::size(DUES))];
+                const bool ok = model_.has(id) && due >= 0;
+                expect(op, ok, [&](Storage& store) { store.setDue(id, due); });
+                if (ok) model_.tasks[id].due = due;
+                break;
+            }
+            case Op::Tag:
+            case Op::Untag: {
+                const int id = pickId(in);
+                const std::string tag(TAGS[in.below(std::size(TAGS))]);
+                const bool add = op == Op::Tag;
+                bool ok = false;
+                if (model_.has(id)) {
+                    auto& tags = model_.tasks[id].tags;
+                    const bool present = std::find(tags.begin(), tags.end(), tag) != tags.end();
+                    ok = add ? Task::isValidTag(tag) && !present : present;
+                }
+                expect(op, ok, [&](Storage& store) {
+                    add ? store.addTag(id, tag) : store.removeTag(id, tag);
+                });
+                if (!ok) break;
+                auto& tags = model_.tasks[id].tags;
+                if (add) {
+                    tags.push_back(tag);
+                } else {
+                    tags.erase(std::find(tags.begin(), tags.end(), tag));
+                }
+                break;
+            }
+            case Op::Depend:
+            case Op::Undepend: {
+                const int id = pickId(in);
+                const int blocker = pickId(in);
+                const bool add = op == Op::Depend;
+                const bool exists = model_.has(id) && model_.has(blocker);
+                const bool present = model_.edges.count({blocker, id}) != 0;
+                // The edge blocker -> id closes a cycle if id already leads to blocker
+                const bool ok = exists && (add ? id != blocker && !present && !model_.reaches(id, blocker) : present);
+                expect(op, ok, [&](Storage& store) {
+                    add ? store.addDependency(id, blocker) : store.removeDependency(id, blocker);
+                });
+                if (!ok) break;
+                if (add) {
+                    model_.edges.emplace(blocker, id);
+                } else {
+                    model_.edges.erase({blocker, id});
+                }
+                break;
+            }
+            case Op::Archive: {
+                size_t completed = 0;
+                for (const auto& [id, task] : model_.tasks) completed += task.completed;
+                expect(op, true, [&](Storage& store) {
+                    if (store.archiveCompleted(std::numeric_limits<std::int64_t>::max()) != completed) {
+                        throw Mismatch{"archived a different number of tasks"};
+                    }
+                });
+                std::erase_if(model_.tasks, [](const auto& entry) { return entry.second.completed; });
+                break;
+            }
+            case Op::Reload:
+                // Along the way one encoding at a time, all of them at the end
+                reload(op, 1u << in.below(std::size(FORMATS)));
+                break;
+            case Op::Count:
+                break;
+        }
+    }
+
+    void reload(Op op, unsigned formats) {
+        for (Subject& subject : subjects_) {
+            at(steps_, op, subject, [&] {
+                if (subject.inMemory) {
+                    roundTrip(subject.store->getAllTasks(), model_.nextId, formats);
+                    return;
+                }
+                if (!subject.autoSave) subject.store->save();
+                const std::vector<Task> before = subject.store->getAllTasks();
+                subject.open();
+                compareExact(before, subject.store->getAllTasks());
+                compareWithModel(*subject.store, model_);
+                compareReady(*subject.store, model_);
+                if (!subject.replica) return;
+                subject.replica->catchUp();
+                try {
+                    compareWithModel(*subject.replica, model_);
+                } catch (Mismatch& mismatch) {
+                    mismatch.what.insert(0, "replica: ");
+                    throw;
+                }
+            });
+        }
+    }
+};
+
+}  // namespace
+
+namespace Fuzz {
+
+const fs::path& workDir() {
+    static const fs::path dir = [] {
+        std::error_code ec;
+        // The harness is bound by file I/O: use tmpfs where there is one
+        const fs::path base = fs::is_directory("/dev/shm", ec) ? fs::path("/dev/shm") : fs::temp_directory_path();
+        const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+        return base / ("tm-fuzz-" + std::to_string(stamp));
+    }();
+    return dir;
+}
+
+bool sampled(const std::uint8_t* data, size_t size) {
+    // FNV-1a: the same inputs are sampled on every run and every replay
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i) hash = (hash ^ data[i]) * 0x100000001b3ull;
+    return hash % FILE_SAMPLE == 0;
+}
+
+std::string run(const std::uint8_t* data, size_t size, bool files) {
+    if (files) fs::remove_all(workDir());
+    fs::create_directories(workDir());
+    Input in(data, size);
+    try {
+        Run run(files);
+        run.execute(in);
+    } catch (const Mismatch& mismatch) {
+        return mismatch.what;
+    } catch (const std::exception& e) {
+        return std::string("unexpected exception: ") + e.what();
+    }
+    return {};
+}
+
+}  // namespace Fuzz
+
+// libFuzzer entry point (FUZZ_ENGINE=libfuzzer); a disagreement is a crash
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, size_t size) {
+    const std::string failure = Fuzz::run(data, size, Fuzz::sampled(data, size));
+    if (!failure.empty()) {
+        std::fprintf(stderr, "%s\n", failure.c_str());
+        std::abort();
+    }
+    return 0;
+}
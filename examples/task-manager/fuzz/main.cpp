@@ -0,0 +1,118 @@
+// Standalone driver for the differential harness, for compilers without
+// libFuzzer: random inputs for a number of runs (or seconds), or replays of
+// the files given, such as inputs it saved when a run disagreed
+#include "fuzz.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+// splitmix64: fast, and the same sequence for a seed everywhere
+class Rng {
+public:
+    explicit Rng(std::uint64_t seed) : state_(seed) {}
+    std::uint64_t next() {
+        std::uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+private:
+    std::uint64_t state_;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "Usage: %s [--runs N] [--seconds S] [--seed N] [--max-len N] [input...]\n"
+                 "  Random inputs until N runs (default 100000) or S seconds, whichever is first;\n"
+                 "  with input files, replay just those. A disagreement is saved as crash-<seed>-<run>.bin.\n",
+                 argv0);
+}
+
+bool replay(const char* path) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        std::fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+    const std::vector<char> bytes((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    // Replays always go through the files as well
+    const auto* data = reinterpret_cast<const std::uint8_t*>(bytes.data());
+    std::string failure = Fuzz::run(data, bytes.size(), false);
+    if (failure.empty()) failure = Fuzz::run(data, bytes.size(), true);
+    std::printf("%s: %s\n", path, failure.empty() ? "ok" : failure.c_str());
+    return failure.empty();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t runs = 100000;
+    double seconds = 0;
+    std::uint64_t seed = 1;
+    size_t maxLen = 256;
+    std::vector<const char*> inputs;
+
+    for (int i = 1; i < argc; ++i) {
+        auto option = [&](const char* name) { return std::strcmp(argv[i], name) == 0 && i + 1 < argc; };
+        if (option("--runs")) {
+            runs = std::strtoull(argv[++i], nullptr, 10);
+        } else if (option("--seconds")) {
+            seconds = std::strtod(argv[++i], nullptr);
+        } else if (option("--seed")) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (option("--max-len")) {
+            maxLen = std::strtoull(argv[++i], nullptr, 10);
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (maxLen == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int status = 0;
+    if (!inputs.empty()) {
+        for (const char* path : inputs) {
+            if (!replay(path)) status = 1;
+        }
+        std::filesystem::remove_all(Fuzz::workDir());
+        return status;
+    }
+
+    Rng rng(seed);
+    std::vector<std::uint8_t> input;
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&] { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+    size_t run = 0;
+    size_t bytes = 0;
+    for (; run < runs && (seconds <= 0 || elapsed() < seconds); ++run) {
+        input.resize(1 + static_cast<size_t>(rng.next() % maxLen));
+        for (auto& byte : input) byte = static_cast<std::uint8_t>(rng.next());
+        bytes += input.size();
+        const std::string failure = Fuzz::run(input.data(), input.size(), Fuzz::sampled(input.data(), input.size()));
+        if (failure.empty()) continue;
+        const std::string path = "crash-" + std::to_string(seed) + "-" + std::to_string(run) + ".bin";
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(input.data()),
+                                                    static_cast<std::streamsize>(input.size()));
+        std::printf("run %zu: %s\n  input saved to %s\n", run, failure.c_str(), path.c_str());
+        status = 1;
+        break;
+    }
+    const double time = elapsed();
+    std::printf("%zu runs, %.1f bytes/input, %.2f s: %.0f execs/s%s\n", run, run ? static_cast<double>(bytes) / static_cast<double>(run) : 0.0,
+                time, time > 0 ? static_cast<double>(run) / time : 0.0, status ? "" : ", no disagreements");
+    std::filesystem::remove_all(Fuzz::workDir());
+    return status;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Coroutines for overlapping command execution with file I/O.
+///
+/// An Executor belongs to one thread, which resumes coroutines; blocking work
+/// (file writes) runs on a few I/O threads and completes back on the owner
+/// thread through poll()/wait(). GroupCommit turns many changes into few
+/// writes: at most one write is in flight, and the next one covers every
+/// change made while it ran.
+namespace Async {
+
+/// Fire-and-forget coroutine: starts immediately, frees itself when done.
+/// The body must handle its own exceptions.
+struct Job {
+    struct promise_type {
+        Job get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+class Executor {
+public:
+    explicit Executor(unsigned ioThreads = 1);
+    ~Executor();  // drain()s first
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    // Run work on an I/O thread; done(error) runs later on the owner thread
+    void submit(std::function<void()> work, std::function<void(std::exception_ptr)> done);
+
+    // Run the callbacks of finished work; returns how many ran
+    size_t poll();
+    // Block until some work finishes, then poll()
+    size_t wait();
+    // Until no work is queued or running
+    void drain();
+    size_t inFlight() const { return inFlight_; }
+
+private:
+    struct Work {
+        std::function<void()> run;
+        std::function<void(std::exception_ptr)> done;
+        std::exception_ptr error;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable wake_;      // I/O threads: work queued or stopping
+    std::condition_variable finished_;  // Owner: work completed
+    std::deque<Work> queued_;
+    std::deque<Work> completed_;
+    std::vector<std::thread> threads_;
+    size_t inFlight_ = 0;  // Owner thread only
+    bool stop_ = false;
+
+    void ioLoop();
+};
+
+// co_await offload(executor, work): run work on an I/O thread and resume on
+// the owner thread; exceptions from work are rethrown at the co_await
+class Offload {
+public:
+    Offload(Executor& executor, std::function<void()> work) : executor_(executor), work_(std::move(work)) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle);
+    void await_resume() const {
+        if (error_) std::rethrow_exception(error_);
+    }
+
+private:
+    Executor& executor_;
+    std::function<void()> work_;
+    std::exception_ptr error_;
+};
+
+inline Offload offload(Executor& executor, std::function<void()> work) { return {executor, std::move(work)}; }
+
+class GroupCommit {
+public:
+    // prepare() runs on the owner thread, snapshots whatever must be written
+    // and returns the write itself (empty if it already wrote synchronously)
+    using Prepare = std::function<std::function<void()>()>;
+
+    GroupCommit(Executor& executor, Prepare prepare);
+
+    // Record a change that the next write must cover
+    void markDirty() { ++dirty_; }
+
+    class Durable {
+    public:
+        Durable(GroupCommit& commit, std::uint64_t target) : commit_(commit), target_(target) {}
+        bool await_ready() const noexcept { return commit_.durable_ >= target_; }
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const {
+            if (error_) std::rethrow_exception(error_);
+        }
+
+    private:
+        friend class GroupCommit;
+        GroupCommit& commit_;
+        std::uint64_t target_;
+        std::coroutine_handle<> handle_;
+        std::exception_ptr error_;
+    };
+
+    // co_await durable(): resumes (in call order) once every change marked
+    // so far is written; a failed write is rethrown to the changes it covered
+    Durable durable() { return {*this, dirty_}; }
+
+    size_t writes() const { return writes_; }
+
+private:
+    Executor& executor_;
+    Prepare prepare_;
+    std::uint64_t dirty_ = 0;    // Changes marked
+    std::uint64_t durable_ = 0;  // Changes written
+    bool writing_ = false;
+    size_t writes_ = 0;
+    std::deque<Durable*> waiters_;
+
+    Job writer();
+};
+
+}  // namespace Async
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "task.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// Fixed-width binary task store with in-place updates.
+///
+/// `<path>` holds a 64-byte header followed by one 48-byte record per task;
+/// `<path>.heap` holds descriptions and tag lists and is only ever appended to.
+/// flush() writes back just the records marked dirty: a field change
+/// overwrites one record, a new task appends its strings and a record at the
+/// tails, a delete leaves a tombstone. Superseded strings and tombstones stay
+/// as garbage until rewrite() compacts both files.
+///
+/// Integers are stored little-endian. flush() appends heap bytes and new
+/// records first, then the header that counts them, and overwrites records in
+/// place last, so a flush cut short by a crash leaves a store that opens: each
+/// record holds its old or its new contents, and anything past the header's
+/// counts is ignored. flush() does not sync; after a power loss its writes may
+/// reach the disk in any order. rewrite() builds both files aside, syncs them
+/// and renames them over the old ones, so a compaction leaves the old store
+/// or the new one even then.
+class BinaryStore {
+public:
+    enum Change : unsigned {
+        FIELDS = 1u << 0,   // completed, priority or due
+        STRINGS = 1u << 1,  // description or tags
+        ADDED = 1u << 2,
+        DELETED = 1u << 3,
+    };
+
+    static constexpr size_t HEADER_SIZE = 64;
+    static constexpr size_t RECORD_SIZE = 48;
+
+    struct Stats {
+        size_t liveRecords;
+        size_t deadRecords;
+        std::uint64_t heapBytes;
+        std::uint64_t heapGarbage;
+        size_t writeCalls;          // Since construction
+        std::uint64_t bytesWritten;
+    };
+
+    // Opens (creating if needed) the record and heap files
+    explicit BinaryStore(std::filesystem::path path);
+    ~BinaryStore();
+
+    BinaryStore(const BinaryStore&) = delete;
+    BinaryStore& operator=(const BinaryStore&) = delete;
+
+    // Stores whose file name ends in ".bin"
+    static bool handles(const std::filesystem::path& path);
+
+    // Throws std::runtime_error on a damaged or foreign file
+    void load(std::vector<Task>& tasks, int& nextId);
+    // Rewrite both files from scratch, dropping all garbage
+    void rewrite(const std::vector<Task>& tasks, int nextId);
+
+    // What rewrite() writes and load() reads, in memory: the records file
+    // (header included) and the heap file
+    static void encode(const std::vector<Task>& tasks, int nextId, std::string& records, std::string& heap);
+    // Throws std::runtime_error where load() would
+    static void decode(std::string_view records, std::string_view heap, std::vector<Task>& tasks, int& nextId);
+
+    void markDirty(int id, unsigned change);
+    // Bulk edits: the next write must be a rewrite()
+    void markAllDirty();
+    // Write pending changes; find() returns the current task for an id
+    void flush(const std::function<const Task*(int)>& find, int nextId);
+    // Pending bulk edit, or enough garbage that a rewrite pays off
+    bool needsCompaction() const;
+    // Crash checks: after `steps` more file writes or renames, each further
+    // one throws instead of happening, as if the process had died there
+    void interruptAfter(size_t steps);
+
+    Stats stats() const;
+    // Heap held by the slot table and flush() buffers
+    size_t memoryBytes() const;
+
+private:
+    struct Slot {
+        std::uint64_t index;
+        std::uint64_t descOffset;
+        std::uint64_t tagsOffset;
+        std::uint32_t descLength;
+        std::uint32_t tagsLength;
+    };
+    struct Parsed {
+        std::unordered_map<int, Slot> slots;
+        size_t dead = 0;
+        std::uint64_t liveBytes = 0;
+    };
+
+    std::filesystem::path path_;
+    std::filesystem::path heapPath_;
+    int fd_ = -1;
+    int heapFd_ = -1;
+
+    std::uint64_t recordCount_ = 0;  // Including tombstones
+    std::uint64_t heapSize_ = 0;
+    std::uint64_t heapGarbage_ = 0;
+    size_t deadRecords_ = 0;
+    int nextIdOnDisk_ = 0;
+    std::unordered_map<int, Slot> slots_;     // Live task id -> record
+    // (id, Change bits) in call order, merged per id by flush(). A vector keeps
+    // its capacity, so steady-state edits do not allocate.
+    std::vector<std::pair<int, unsigned>> dirty_;
+    bool rewriteAll_ = false;
+    // flush() scratch, reused between calls
+    std::vector<std::pair<std::uint64_t, std::array<char, RECORD_SIZE>>> writes_;  // (record index, bytes)
+    std::string heapScratch_;
+    std::string runScratch_;
+
+    size_t writeCalls_ = 0;
+    std::uint64_t bytesWritten_ = 0;
+    size_t stepsLeft_ = SIZE_MAX;  // interruptAfter()
+
+    void step(const std::filesystem::path& path);
+    void writeAt(int fd, const std::filesystem::path& path, const char* data, size_t size, std::uint64_t offset);
+    void readAt(int fd, const std::filesystem::path& path, char* data, size_t size, std::uint64_t offset) const;
+    void writeHeader(int nextId);
+    static Slot appendStrings(std::string& heap, std::uint64_t base, const Task& task);
+    // Both files' contents for tasks; slots, if given, receives their records
+    static void build(const std::vector<Task>& tasks, int nextId, std::string& records, std::string& heap,
+                      std::unordered_map<int, Slot>* slots);
+    // Live tasks of the records (header excluded) over heap
+    static Parsed parse(const std::filesystem::path& path, std::string_view records, std::string_view heap,
+                        std::vector<Task>& tasks);
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Cache-blocked Bloom filter for fast negative membership tests.
+///
+/// All probe bits of a key fall into one 512-bit block, so a lookup costs a
+/// single cache miss however many hash functions are in use; the price is a
+/// slightly higher false-positive rate than an unblocked filter of equal size.
+/// Keys are 64-bit hashes from hash(), which is stable across platforms so the
+/// filter can be persisted with write() and restored with read().
+class BloomFilter {
+public:
+    static constexpr size_t BLOCK_BITS = 512;
+
+    // An empty filter contains nothing and reports every key absent
+    BloomFilter() = default;
+    // Sized so that expectedItems keys give roughly falsePositiveRate
+    BloomFilter(size_t expectedItems, double falsePositiveRate);
+
+    void add(std::uint64_t key) noexcept;
+    bool mightContain(std::uint64_t key) const noexcept;
+
+    static std::uint64_t hash(std::string_view text) noexcept;
+    static std::uint64_t hash(std::int64_t value) noexcept;
+
+    size_t size() const noexcept { return count_; }          // Keys added
+    size_t capacity() const noexcept { return capacity_; }   // expectedItems
+    size_t bitCount() const noexcept { return words_.size() * 64; }
+    unsigned hashCount() const noexcept { return hashCount_; }
+
+    // Append the little-endian encoding to out
+    void write(std::string& out) const;
+    // Decode one filter from the front of in, advancing it; false if malformed
+    bool read(std::string_view& in);
+
+private:
+    std::vector<std::uint64_t> words_;  // BLOCK_BITS / 64 words per block
+    unsigned hashCount_ = 0;
+    size_t count_ = 0;
+    size_t capacity_ = 0;
+};
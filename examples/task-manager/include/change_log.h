@@ -0,0 +1,92 @@
+#pragma once
+
+#include "task.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// Change stream of a task store, for read replicas on the same machine.
+///
+/// The primary appends one change set per persisted mutation to a text file
+/// next to the store (tasks.json -> tasks.changes.log):
+///
+///     TMLOG 1 <base lsn> <epoch>   header
+///     P <task as a JSON line>      task added or changed
+///     D <id>                       task deleted (or archived)
+///     C <lsn> <nextId>             commit: the P/D lines above form change set <lsn>
+///
+/// Each change set reaches the file in one write, and readers ignore records
+/// after the last commit, so they never see half a set. A log starts with a
+/// snapshot of the whole store as its first set and is rewritten that way,
+/// under a new epoch, once it has grown well past the store; a reader that
+/// sees a new epoch starts over from that snapshot. LSNs increase across
+/// rewrites and restarts of the primary.
+class ChangeLog {
+public:
+    explicit ChangeLog(std::filesystem::path path);
+
+    const std::filesystem::path& path() const { return path_; }
+
+    // Replace the log with a snapshot (atomically, via rename)
+    void reset(const std::vector<Task>& tasks, int nextId);
+
+    // Records of the next change set; each ID at most once per set
+    void put(const Task& task);
+    void remove(int id);
+    // Write the pending records as one set; returns its LSN. Throws
+    // std::runtime_error if the log cannot be written.
+    std::uint64_t commit(int nextId);
+
+    // LSN of the last committed set
+    std::uint64_t lsn() const { return lsn_; }
+    // Records put or removed since the last commit
+    bool hasPending() const { return !pending_.empty(); }
+    // Enough superseded history that reset() pays off
+    bool needsRewrite() const;
+    // Heap held by the pending-record buffer
+    size_t memoryBytes() const;
+
+private:
+    std::filesystem::path path_;
+    std::ofstream out_;
+    std::string pending_;
+    std::uint64_t lsn_ = 0;
+    std::uint64_t bytes_ = 0;          // Current log size
+    std::uint64_t snapshotBytes_ = 0;  // Size right after the last reset()
+};
+
+/// Tails a ChangeLog written by another process (or thread).
+class ChangeLogReader {
+public:
+    struct ChangeSet {
+        std::uint64_t lsn = 0;
+        int nextId = 1;
+        std::vector<Task> puts;
+        std::vector<int> deletes;
+    };
+
+    struct Update {
+        bool restarted = false;  // sets[0] is a snapshot: drop all earlier state
+        std::vector<ChangeSet> sets;
+    };
+
+    explicit ChangeLogReader(std::filesystem::path path);
+
+    // Committed change sets appended since the last call, oldest first. A
+    // missing log yields nothing. Throws std::runtime_error on a record that
+    // does not parse.
+    Update read();
+
+    // LSN of the last set returned
+    std::uint64_t lsn() const { return lsn_; }
+
+private:
+    std::filesystem::path path_;
+    std::string header_;      // Identifies the log file being tailed
+    std::uint64_t offset_ = 0;  // Bytes consumed, up to the end of the last commit
+    std::uint64_t lsn_ = 0;
+    std::string buffer_;
+};
@@ -1,8 +1,14 @@
 #pragma once
 
+#include "async.h"
+#include "command.h"
+#include "output.h"
 #include "storage.h"
+#include "table.h"
 #include "utils.h"
 #include <string>
+#include <string_view>
+#include <vector>
 
 class CLI {
 public:
@@ -12,14 +18,46 @@ public:
     void run();
     void showHelp() const;
 
+    // Parse and execute one input line; returns false when the line asks to quit
+    bool parseCommand(std::string_view input);
+
+    // Batch mode: read commands from stdin until EOF or quit without a prompt,
+    // overlapping their execution with the store writes. Changes are grouped
+    // into one write per batch (at most one write in flight), and a command's
+    // reply is written only once its change is on disk, in input order. At
+    // most maxInFlight commands wait for a write at a time. Returns the number
+    // of store writes.
+    size_t runPipelined(size_t maxInFlight = 4096);
+
 private:
     Storage& storage_;
+    OutputSink& out_;  // Flushed before every read from stdin
+    TableRenderer table_;
 
-    void handleAdd(const std::string& desc);
-    void handleList();
+    void handleAdd(std::string desc);
+    void handleList(bool paginate, bool includeArchive);
     void handleComplete(int id);
+    void handleReopen(int id);
     void handleDelete(int id);
+    void handlePriority(int id, int priority);
+    void handleDue(int id, std::string_view date);
+    void handleTag(int id, std::string_view tag, bool add);
+    void handleDepend(int id, int blocker, bool add);
+    void handleNext(size_t limit);
+    void handleUpcoming(size_t limit);
+    void handleTagged(std::string_view tag);
+    void handleSearch(std::string_view text);
+    void handleFind(std::string_view text);
+    void handleArchive(int days);
+    void handleDedupe(bool merge);
+    void handleStats() const;
+    void handleTrace(std::string_view action);
+
+    void printTasks(const std::vector<Task>& tasks, std::string_view title, bool paginate = false);
+    void printTasks(const std::vector<const Task*>& tasks, std::string_view title);
 
     std::string getCommand();
-    void parseCommand(const std::string& input);
+    bool runCommand(const Command& cmd);
+    void execute(const Command& cmd);
+    Async::Job pipelineCommand(std::string line, Async::GroupCommit& commit, size_t& waiting, bool& reading);
 };
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// Commands understood by the CLI
+enum class CommandId : std::uint8_t {
+    Empty,
+    Unknown,
+    Add,
+    List,
+    Complete,
+    Reopen,
+    Depend,
+    Undepend,
+    Delete,
+    Priority,
+    Due,
+    Tag,
+    Untag,
+    Upcoming,
+    Next,
+    Tagged,
+    Search,
+    Find,
+    Archive,
+    Dedupe,
+    Stats,
+    Trace,
+    Help,
+    Quit,
+};
+
+/// Result of parsing one input line. Views point into the parsed line.
+struct Command {
+    CommandId id = CommandId::Empty;
+    int taskId = 0;          // complete/reopen/delete/priority/due/tag/untag/depend/undepend
+    int number = 0;          // priority value, blocker ID, upcoming/next limit or archive age in days
+    std::string_view text;   // add description, search/find text, due date, tag name, list/dedupe mode, trace action
+    const char* error = nullptr;  // Static message when the arguments are malformed
+};
+
+namespace CommandParser {
+
+// Keyword -> command, dispatched on length first so each lookup is at most
+// a couple of fixed-size compares. Usable at compile time.
+constexpr CommandId lookup(std::string_view word) noexcept {
+    switch (word.size()) {
+        case 1:
+            if (word == "q") return CommandId::Quit;
+            break;
+        case 3:
+            if (word == "add") return CommandId::Add;
+            if (word == "due") return CommandId::Due;
+            if (word == "tag") return CommandId::Tag;
+            break;
+        case 4:
+            if (word == "list") return CommandId::List;
+            if (word == "find") return CommandId::Find;
+            if (word == "next") return CommandId::Next;
+            if (word == "help") return CommandId::Help;
+            if (word == "quit") return CommandId::Quit;
+            break;
+        case 5:
+            if (word == "untag") return CommandId::Untag;
+            if (word == "stats") return CommandId::Stats;
+            if (word == "trace") return CommandId::Trace;
+            break;
+        case 6:
+            if (word == "delete") return CommandId::Delete;
+            if (word == "tagged") return CommandId::Tagged;
+            if (word == "search") return CommandId::Search;
+            if (word == "dedupe") return CommandId::Dedupe;
+            if (word == "reopen") return CommandId::Reopen;
+            if (word == "depend") return CommandId::Depend;
+            break;
+        case 7:
+            if (word == "archive") return CommandId::Archive;
+            break;
+        case 8:
+            if (word == "complete") return CommandId::Complete;
+            if (word == "priority") return CommandId::Priority;
+            if (word == "upcoming") return CommandId::Upcoming;
+            if (word == "undepend") return CommandId::Undepend;
+            break;
+        default:
+            break;
+    }
+    return CommandId::Unknown;
+}
+
+static_assert(lookup("add") == CommandId::Add);
+static_assert(lookup("complete") == CommandId::Complete);
+static_assert(lookup("q") == CommandId::Quit);
+static_assert(lookup("adds") == CommandId::Unknown);
+
+// Split off the next whitespace-separated token, advancing `rest` past it
+std::string_view nextToken(std::string_view& rest) noexcept;
+
+// Parse a line without touching the heap
+Command parse(std::string_view input) noexcept;
+
+}  // namespace CommandParser
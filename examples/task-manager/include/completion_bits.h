@@ -0,0 +1,76 @@
+#pragma once
+
+#include "task.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/// Whether each task exists and is completed, by ID, readable from any thread
+/// while one writer thread changes it.
+///
+/// Two bits per ID (live, completed) share a 64-bit word, so a single atomic
+/// load reads both and state() is wait-free: no lock, no retry, never a
+/// half-applied change. Words live in 1 KiB segments of 4096 IDs, reached
+/// through a fixed two-level directory; segments are added as IDs grow and
+/// never move or go away before the object does, so readers need no
+/// reclamation scheme. Reads spanning several tasks go through snapshot(), a
+/// seqlock: every write bumps a sequence counter to odd and back to even, and
+/// a reader that saw it change (or odd) reads again.
+class CompletionBits {
+public:
+    enum class State : std::uint8_t { Missing, Pending, Completed };
+
+    CompletionBits() = default;
+    ~CompletionBits();
+    CompletionBits(const CompletionBits&) = delete;
+    CompletionBits& operator=(const CompletionBits&) = delete;
+
+    // Any thread
+    State state(int id) const noexcept;
+    bool isCompleted(int id) const noexcept { return state(id) == State::Completed; }
+    // States of all ids as of one instant, into out (resized). Lock-free:
+    // retries while a write is in progress.
+    void snapshot(std::span<const int> ids, std::vector<State>& out) const;
+    // Even between writes; advances by 2 with every write
+    std::uint64_t sequence() const noexcept { return sequence_.load(std::memory_order_acquire); }
+
+    // Writer thread only
+    void set(int id, bool completed);  // The task exists
+    void clear(int id);                // Deleted or archived
+    // Replace every state with those of tasks (ascending IDs). Each word is
+    // stored once, so state() sees every task either before or after.
+    void assign(const std::vector<Task>& tasks);
+
+    size_t memoryBytes() const;
+
+private:
+    static constexpr unsigned SEGMENT_SHIFT = 12;  // IDs per segment: 4096
+    static constexpr unsigned MIDDLE_SHIFT = 10;   // Segments per middle block: 1024
+    static constexpr size_t SEGMENT_IDS = size_t{1} << SEGMENT_SHIFT;
+    static constexpr size_t IDS_PER_WORD = 32;
+    static constexpr size_t SEGMENT_WORDS = SEGMENT_IDS / IDS_PER_WORD;
+    static constexpr size_t MIDDLE_SIZE = size_t{1} << MIDDLE_SHIFT;
+    // Enough middle blocks for every non-negative int
+    static constexpr size_t TOP_SIZE = (size_t{1} << 31) >> (SEGMENT_SHIFT + MIDDLE_SHIFT);
+
+    struct Segment {
+        std::array<std::atomic<std::uint64_t>, SEGMENT_WORDS> words{};
+    };
+    struct Middle {
+        std::array<std::atomic<Segment*>, MIDDLE_SIZE> segments{};
+    };
+
+    Segment* findSegment(size_t segment) const noexcept;
+    Segment& makeSegment(size_t segment);  // Writer: allocates on first use
+    std::atomic<std::uint64_t>* findWord(int id) const noexcept;
+    void beginWrite() noexcept;
+    void endWrite() noexcept;
+
+    std::array<std::atomic<Middle*>, TOP_SIZE> top_{};
+    std::atomic<std::uint64_t> sequence_{0};
+    size_t segments_ = 0;  // Allocated, for memoryBytes()
+    size_t middles_ = 0;
+};
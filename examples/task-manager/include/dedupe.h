@@ -0,0 +1,39 @@
+#pragma once
+
+#include "task.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Duplicate and near-duplicate task detection.
+///
+/// Descriptions are normalized (ASCII case folded, whitespace runs collapsed)
+/// and hashed to find exact duplicates. One representative per distinct text
+/// then gets a MinHash signature over its character shingles; signatures are
+/// cut into LSH bands, and texts sharing a band bucket are verified by exact
+/// shingle Jaccard similarity and joined with union-find. Every stage runs in
+/// parallel (see parallel.h), so the cost is roughly linear in the task count.
+namespace Dedupe {
+
+struct Options {
+    double threshold = 0.8;  // Minimum shingle Jaccard similarity of near-duplicates
+    size_t shingle = 3;      // Characters per shingle
+    bool nearDuplicates = true;
+};
+
+struct Group {
+    std::vector<int> ids;  // Ascending; the first (oldest) task is the one merging keeps
+    bool exact;            // All normalized descriptions are identical
+};
+
+// Groups of two or more tasks, ordered by their first ID
+std::vector<Group> findGroups(const std::vector<Task>& tasks, const Options& options = {});
+
+// Lowercase ASCII letters, collapse whitespace runs to one space, trim
+std::string normalize(std::string_view text);
+
+// Exact Jaccard similarity of the two texts' shingle sets (after normalize())
+double similarity(std::string_view a, std::string_view b, size_t shingle = 3);
+
+}  // namespace Dedupe
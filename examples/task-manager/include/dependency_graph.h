@@ -0,0 +1,136 @@
+#pragma once
+
+#include "task.h"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// Which tasks wait for which, and which pending tasks are ready to start.
+///
+/// Edges run from a blocker to the tasks waiting for it and are stored in
+/// compressed sparse row form: one offset per task ID into a single array of
+/// dependents, sorted per blocker, four bytes per edge. Edges added since the
+/// last rebuild sit in a small side table, and removed ones leave a hole at
+/// the end of their row, until those changes add up to an eighth of the graph
+/// and the rows are rebuilt.
+///
+/// Every task carries a topological rank, lower than that of each task waiting
+/// for it. An edge that agrees with the ranks cannot close a cycle and costs a
+/// lookup; one that does not raises the ranks of the tasks reachable from its
+/// target, in rank order, and closes a cycle exactly when that reaches the
+/// blocker. Only the tasks between the two ranks are visited.
+///
+/// Scheduling is Kahn's algorithm run incrementally: each task counts its
+/// pending blockers, completing a task decrements the counts of its
+/// dependents, and a pending task whose count is zero is ready. Ready tasks
+/// are bits in one bitset per priority, so updates are O(1) and the most
+/// urgent come out first without sorting. Deleted and archived tasks take
+/// their edges with them. Task states are only tracked while there are edges,
+/// so a store that never uses dependencies pays nothing per task.
+class DependencyGraph {
+public:
+    using Edge = std::pair<int, int>;  // (blocker, blocked)
+
+    // false if the edge exists already. Throws std::invalid_argument for a
+    // task waiting for itself and std::runtime_error if the edge would close
+    // a cycle; the graph is unchanged then.
+    bool addEdge(int blocker, int blocked);
+    // All or nothing, in O(V + E): throws like addEdge() without adding any
+    // if one of them is invalid. Returns the number added (duplicates are not).
+    size_t addEdges(const std::vector<Edge>& edges);
+    bool removeEdge(int blocker, int blocked);  // false if absent
+    bool hasEdge(int blocker, int blocked) const;
+    void clear();
+
+    size_t edgeCount() const noexcept { return edges_; }
+    // Tasks waiting for blocker, in ID order
+    std::vector<int> dependents(int blocker) const;
+    // Edges between live tasks, by blocker then blocked
+    std::vector<Edge> edges() const;
+
+    // Task states: reset() with every task, then report each change. Without
+    // edges reset() lets go of them instead; track() before adding the first.
+    void reset(const std::vector<Task>& tasks);
+    void track(const std::vector<Task>& tasks);
+    bool tracking() const noexcept { return !status_.empty(); }
+    void added(const Task& task);
+    void completed(int id);
+    void reopened(int id);
+    // Deleted or archived: its edges go too; true if it had any
+    bool removed(int id);
+    void priorityChanged(int id, int priority);
+
+    // Up to limit ready tasks: highest priority first, then lowest ID (none
+    // unless tracking)
+    std::vector<int> ready(size_t limit) const;
+    size_t readyCount() const noexcept;
+    bool isReady(int id) const noexcept;
+    // Pending blockers of id (0 for unknown IDs)
+    int waitingFor(int id) const noexcept;
+
+    // Append the little-endian encoding of edges() to out
+    void write(std::string& out) const;
+    // Replace the edges with those encoded in in, leaving out any with an ID
+    // from idLimit up (no task has one). Returns how many were left out;
+    // nullopt (and no edges) if malformed or cyclic, whether or not task
+    // states are tracked yet. Task states are kept: reset() or not, as before.
+    std::optional<size_t> read(std::string_view in, int idLimit);
+
+    size_t memoryBytes() const;
+
+private:
+    enum Status : std::uint8_t { MISSING, PENDING, COMPLETED };
+    static constexpr int LEVELS = Task::MAX_PRIORITY - Task::MIN_PRIORITY + 1;
+    static constexpr int HOLE = -1;  // Removed edge: sorts last as unsigned
+
+    size_t nodeCount() const noexcept { return status_.size(); }
+    // addEdges(), ranking every edge or only those between live tasks
+    size_t addEdges(const std::vector<Edge>& edges, bool everyEdge);
+    void grow(size_t nodes);
+    // Calls fn(dependent) for every edge out of blocker
+    template <typename Fn>
+    void forEachDependent(int blocker, Fn fn) const;
+    // Raise ranks for blocker -> blocked; false (ranks unchanged) on a cycle
+    bool reorder(int blocker, int blocked);
+    // Ranks from Kahn's algorithm over the edges between live tasks (every
+    // edge if everyEdge); false on a cycle
+    bool rankAll(bool everyEdge = false);
+    // Rows holding the current edges plus extra, sorted and without duplicates
+    void rebuild(const std::vector<Edge>& extra, bool dropMissing, std::vector<std::uint32_t>& offsets,
+                 std::vector<int>& targets) const;
+    // Fold the side table and holes into the rows, dropping edges of missing tasks
+    void compact();
+    void maybeCompact();
+    // Counts and ready bits from status_ alone
+    void recount();
+    void setReady(int id, bool ready) noexcept;
+    // One edge whose blocker went from pending to done (-1) or back (+1)
+    void adjustWaiting(int dependent, int delta) noexcept;
+    bool live(int id) const noexcept {
+        return id >= 0 && static_cast<size_t>(id) < nodeCount() && status_[static_cast<size_t>(id)] != MISSING;
+    }
+    // Edges of tasks that went without removed() stay in the rows until the
+    // next rebuild; while states are tracked they take no part in ordering
+    bool counts(int id) const noexcept { return !tracking() || live(id); }
+
+    // Rows: dependents of blocker b are targets_[offsets_[b] .. offsets_[b + 1])
+    std::vector<std::uint32_t> offsets_;
+    std::vector<int> targets_;
+    std::unordered_map<int, std::vector<int>> added_;  // Edges not in the rows yet
+    size_t addedCount_ = 0;
+    size_t holes_ = 0;
+    size_t edges_ = 0;
+
+    // Per task ID
+    std::vector<std::uint8_t> status_;
+    std::vector<std::uint8_t> level_;  // Priority - MIN_PRIORITY
+    std::vector<int> waiting_;
+    std::vector<int> rank_;
+    std::vector<std::uint64_t> ready_[LEVELS];
+    size_t readyAt_[LEVELS] = {};  // Bits set per priority
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+/// Heap bytes owned by standard containers, as the allocator sees them.
+///
+/// Every block is charged what glibc malloc actually reserves for it (request
+/// plus an 8-byte header, rounded to 16, at least 32), and node containers
+/// are charged libstdc++'s node layouts, so totals match the process heap
+/// closely rather than counting sizeof(element) alone.
+namespace Footprint {
+
+inline size_t block(size_t bytes) {
+    if (bytes == 0) return 0;
+    const size_t chunk = (bytes + sizeof(size_t) + 15) & ~size_t{15};
+    return chunk < 32 ? 32 : chunk;
+}
+
+// Short strings live inside the object (small-string optimization)
+inline size_t of(const std::string& s) {
+    return s.capacity() > std::string().capacity() ? block(s.capacity() + 1) : 0;
+}
+
+template <typename T>
+size_t of(const std::vector<T>& v) {
+    return block(v.capacity() * sizeof(T));
+}
+
+// Nodes hold a next pointer, the value and, for keys whose hash is not
+// trivially cheap (strings), the cached hash; one bucket needs no allocation
+template <typename K, typename V, typename H, typename E, typename A>
+size_t of(const std::unordered_map<K, V, H, E, A>& map) {
+    constexpr size_t hashBytes = std::is_integral_v<K> ? 0 : sizeof(size_t);
+    const size_t node = block(sizeof(void*) + sizeof(typename std::unordered_map<K, V, H, E, A>::value_type) + hashBytes);
+    const size_t buckets = map.bucket_count() > 1 ? block(map.bucket_count() * sizeof(void*)) : 0;
+    return buckets + map.size() * node;
+}
+
+// Red-black tree nodes: color, parent, left and right, then the value
+template <typename K, typename C, typename A>
+size_t of(const std::set<K, C, A>& set) {
+    return set.size() * block(4 * sizeof(void*) + sizeof(K));
+}
+
+}  // namespace Footprint
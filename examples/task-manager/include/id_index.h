@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/// Task IDs in ascending order, packed into one array that runs parallel to
+/// the task vector: position i holds the ID of the task at position i. IDs
+/// must be distinct.
+///
+/// Lookups use interpolation search between the current bounds: evenly spread
+/// IDs, fresh or thinned out by deletes, take one or two probes, O(log log n).
+/// Clustered IDs (a long run of old tasks deleted or archived, imports that
+/// keep their own IDs) make guesses that do not halve the range; each of those
+/// is followed by a bisection step, and after a few rounds what is left is
+/// bisected, so no input costs more than O(log n). bench_id_lookup checks that
+/// dense, thinned and skewed layouts are all no slower than binary search.
+/// Four bytes per task, against a hash node and a bucket per task for
+/// std::unordered_map.
+class IdIndex {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // Position of id, or npos
+    size_t find(int id) const noexcept;
+    // First position whose ID is >= id (size() if none)
+    size_t lowerBound(int id) const noexcept;
+    // lowerBound() by branchless binary search alone, for comparison
+    size_t binaryLowerBound(int id) const noexcept;
+
+    // Callers keep the order: push_back() only IDs above back(), insert()
+    // at lowerBound()
+    void push_back(int id) { ids_.push_back(id); }
+    void insert(size_t pos, int id);
+    void erase(size_t pos);
+    void clear() noexcept { ids_.clear(); }
+    void reserve(size_t n) { ids_.reserve(n); }
+    void shrinkToFit() { ids_.shrink_to_fit(); }
+
+    bool empty() const noexcept { return ids_.empty(); }
+    size_t size() const noexcept { return ids_.size(); }
+    bool full() const noexcept { return ids_.size() == ids_.capacity(); }
+    int back() const noexcept { return ids_.back(); }
+    const std::vector<int>& ids() const noexcept { return ids_; }
+
+private:
+    std::vector<int> ids_;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/// Operation counters and latency histograms for Storage and the CLI.
+///
+/// Recording is off until setEnabled(true); a disabled timer costs one relaxed
+/// atomic load. Define TM_NO_METRICS to compile the timers out entirely.
+namespace Metrics {
+
+enum class Op : std::uint8_t { Add, Complete, Delete, Save, Load, Parse, Count };
+
+constexpr size_t OP_COUNT = static_cast<size_t>(Op::Count);
+
+const char* opName(Op op);
+
+/// HDR-style histogram of nanosecond latencies: one major bucket per power of
+/// two, split into 2^SUB_BITS linear sub-buckets (worst-case error 1/2^SUB_BITS).
+class Histogram {
+public:
+    static constexpr unsigned SUB_BITS = 3;
+    static constexpr size_t SUB_COUNT = size_t{1} << SUB_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+    void record(std::uint64_t ns) noexcept;
+    void reset() noexcept;
+
+    std::uint64_t count() const noexcept;
+    std::uint64_t sum() const noexcept;
+    std::uint64_t max() const noexcept;
+    // Upper bound of the bucket holding the p-th percentile (0 < p <= 100)
+    std::uint64_t percentile(double p) const noexcept;
+    // Number of samples <= ns; exact when ns + 1 is a power of two
+    std::uint64_t countAtOrBelow(std::uint64_t ns) const noexcept;
+
+    static size_t bucketIndex(std::uint64_t ns) noexcept;
+    static std::uint64_t bucketUpperBound(size_t index) noexcept;
+
+private:
+    std::array<std::atomic<std::uint64_t>, BUCKETS> buckets_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sum_{0};
+    std::atomic<std::uint64_t> max_{0};
+};
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+inline bool enabled() noexcept { return detail::enabled.load(std::memory_order_relaxed); }
+void setEnabled(bool on);
+
+void record(Op op, std::uint64_t ns) noexcept;
+const Histogram& histogram(Op op);
+void reset();
+
+// Human-readable table (count, mean, p50/p90/p99, max) for the `stats` command
+std::string summary();
+// Prometheus text exposition format
+std::string toPrometheus();
+// Write toPrometheus() to path via a temporary file + rename, so scrapers never see a partial file
+void writePrometheus(const std::filesystem::path& path);
+
+/// Times its scope and records it under op when metrics are enabled
+class ScopedTimer {
+public:
+#ifdef TM_NO_METRICS
+    explicit ScopedTimer(Op) noexcept {}
+#else
+    explicit ScopedTimer(Op op) noexcept : op_(op), active_(enabled()) {
+        if (active_) start_ = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() {
+        if (active_) {
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            record(op_, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    }
+
+private:
+    Op op_;
+    bool active_;
+    std::chrono::steady_clock::time_point start_;
+#endif
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+/// Background thread that rewrites a Prometheus text file every interval
+class PeriodicDumper {
+public:
+    PeriodicDumper(std::filesystem::path path, std::chrono::milliseconds interval);
+    ~PeriodicDumper();  // Stops the thread and writes a final snapshot
+
+    PeriodicDumper(const PeriodicDumper&) = delete;
+    PeriodicDumper& operator=(const PeriodicDumper&) = delete;
+
+private:
+    std::filesystem::path path_;
+    std::chrono::milliseconds interval_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread thread_;
+
+    void loop();
+};
+
+}  // namespace Metrics
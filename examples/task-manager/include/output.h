@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/// Buffered, colored output for one file descriptor.
+///
+/// Text accumulates in a single buffer and reaches the fd with one write per
+/// flush() (or per CHUNK_SIZE bytes for long output). Consecutive segments of
+/// the same color share one escape sequence, and no escape codes are written
+/// at all when the fd is not a terminal or $NO_COLOR is set. Nothing is
+/// written until flush(), so callers flush before reading input.
+class OutputSink {
+public:
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;  // Bytes buffered before an early write
+
+    explicit OutputSink(int fd);
+    ~OutputSink();
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    // The process-wide sink for standard output
+    static OutputSink& console();
+
+    // `color` is empty or one of the Utils color constants (kept by reference
+    // until the color changes, so it must outlive the sink's next flush)
+    void write(std::string_view text, std::string_view color = {});
+    void write(char c);
+    void fill(size_t count, char c);
+
+    // Close any open color and write everything buffered (std::cout first)
+    void flush();
+
+    int fd() const;
+    bool colorEnabled() const;
+    void setColorEnabled(bool enabled);
+
+    // Number of write(2) calls issued so far
+    size_t writeCalls() const;
+
+    // Held output: while held, flush() only writes text up to the latest
+    // release()d mark, so a command's reply can be buffered until its change
+    // is durable without reordering it. Un-holding releases and flushes all.
+    void setHeld(bool held);
+    // Position just past everything written so far
+    size_t mark() const;
+    void release(size_t mark);
+
+private:
+    int fd_;
+    bool color_;
+    bool held_ = false;
+    size_t writeCalls_;
+    size_t base_ = 0;      // Stream position of buffer_[0]
+    size_t released_ = 0;  // Stream position up to which a held sink may write
+    std::string_view active_;  // Color currently open in the buffered text
+    std::string buffer_;
+
+    void switchColor(std::string_view color);
+    size_t writable() const;
+    void flushIfFull();
+    void drain();
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/// Small data-parallel facility: a persistent worker pool plus for/reduce helpers.
+///
+/// A loop over [0, n) is cut into chunks that the caller and the workers claim
+/// from a shared atomic cursor, so fast threads keep taking work until none is
+/// left. Calls made from inside a worker run serially instead of deadlocking.
+namespace Parallel {
+
+// Below this many elements per thread the loop runs on the calling thread
+constexpr size_t MIN_GRAIN = 16 * 1024;
+
+// Number of threads (including the caller) used by the helpers. 0 = hardware concurrency.
+void setThreadCount(unsigned count);
+unsigned threadCount();
+
+// Run fn(chunk) for every chunk in [0, chunks) across the pool, return when all finished
+void runChunks(size_t chunks, const std::function<void(size_t)>& fn);
+
+// Call body(begin, end) over disjoint sub-ranges covering [0, n)
+template <typename Body>
+void forRange(size_t n, Body&& body) {
+    size_t threads = threadCount();
+    if (threads <= 1 || n < 2 * MIN_GRAIN) {
+        if (n) body(size_t{0}, n);
+        return;
+    }
+    // A few chunks per thread so uneven chunks even out
+    size_t chunks = std::min(threads * 4, (n + MIN_GRAIN - 1) / MIN_GRAIN);
+    size_t step = (n + chunks - 1) / chunks;
+    runChunks(chunks, [&](size_t c) {
+        size_t begin = c * step;
+        size_t end = std::min(n, begin + step);
+        if (begin < end) body(begin, end);
+    });
+}
+
+// map(begin, end) -> T for each sub-range, folded with combine in range order
+template <typename T, typename Map, typename Combine>
+T reduce(size_t n, T init, Map&& map, Combine&& combine) {
+    size_t threads = threadCount();
+    if (threads <= 1 || n < 2 * MIN_GRAIN) {
+        return n ? combine(std::move(init), map(size_t{0}, n)) : init;
+    }
+    size_t chunks = std::min(threads * 4, (n + MIN_GRAIN - 1) / MIN_GRAIN);
+    size_t step = (n + chunks - 1) / chunks;
+    std::vector<T> partial(chunks);
+    runChunks(chunks, [&](size_t c) {
+        size_t begin = c * step;
+        size_t end = std::min(n, begin + step);
+        if (begin < end) partial[c] = map(begin, end);
+    });
+    for (auto& p : partial) init = combine(std::move(init), std::move(p));
+    return init;
+}
+
+}  // namespace Parallel
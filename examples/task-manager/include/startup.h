@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// Where the cold start goes, for `tm --profile-startup`.
+///
+/// Each phase sums the nanoseconds spent in its scopes, from main() to the
+/// welcome screen reaching the terminal; whatever no scope covers is reported
+/// as "other". Recording is off until start(); a disabled scope costs one
+/// relaxed atomic load. Scopes of different phases must not nest.
+namespace Startup {
+
+enum class Phase : std::uint8_t { ExePath, StorePath, Stat, Read, Parse, Build, FirstPaint, Count };
+
+constexpr size_t PHASE_COUNT = static_cast<size_t>(Phase::Count);
+
+const char* phaseName(Phase phase);
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+inline bool enabled() noexcept { return detail::enabled.load(std::memory_order_relaxed); }
+// Clear the phases and start the clock for the total
+void start();
+
+void record(Phase phase, std::uint64_t ns) noexcept;
+std::uint64_t elapsed(Phase phase) noexcept;
+// Nanoseconds since start()
+std::uint64_t total() noexcept;
+
+// Phase table with shares of the total, for a store of `tasks` tasks in `bytes` bytes
+std::string report(const std::string& store, size_t tasks, std::uint64_t bytes);
+// The same as a CSV row (nanoseconds), preceded by its header line if asked
+std::string csv(size_t tasks, std::uint64_t bytes, bool header);
+
+/// Times its scope and adds it to phase when profiling
+class Scope {
+public:
+    explicit Scope(Phase phase) noexcept : phase_(phase), active_(enabled()) {
+        if (active_) start_ = std::chrono::steady_clock::now();
+    }
+    ~Scope() {
+        if (active_) {
+            auto elapsed = std::chrono::steady_clock::now() - start_;
+            record(phase_, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    Phase phase_;
+    bool active_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace Startup
@@ -1,38 +1,311 @@
 #pragma once
 
 #include <vector>
+#include "binary_store.h"
+#include "bloom_filter.h"
+#include "change_log.h"
+#include "completion_bits.h"
+#include "dependency_graph.h"
+#include "id_index.h"
+#include "parallel.h"
 #include "task.h"
+#include "task_json.h"
+#include <cstdint>
+#include <ctime>
 #include <filesystem>
-#include <nlohmann/json.hpp> 
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <nlohmann/json.hpp>
 
-/// Storage class for persistent Task management using JSON
+/// Storage class for persistent Task management using JSON, or the binary
+/// record store (see binary_store.h) when the file name ends in ".bin"
 class Storage {
 public:
+    // tasks.json in defaultDirectory()
     Storage();
-    explicit Storage(const std::string& filename);
+    // Relative names are resolved against the current directory. A non-zero
+    // memoryBudget and quiet apply to the load already (see setMemoryBudget
+    // and setQuiet).
+    explicit Storage(const std::string& filename, size_t memoryBudget = 0, bool quiet = false);
+    // Read-only replica of the store at `filename`, built from its primary's
+    // change log (see enableChangeLog) instead of the store file. Mutations
+    // and save() throw std::runtime_error. Dependencies are read once, when
+    // the replica is created.
+    static Storage replica(const std::string& filename);
 
-    // Add task with auto-increment ID
-    void addTask(const std::string& description);
-    std::vector<Task> getAllTasks() const;
+    // $TM_STORE_DIR if set, else the directory of the executable (cached)
+    static std::filesystem::path defaultDirectory();
+
+    // Add task with auto-increment ID, returns the new ID
+    int addTask(std::string description);
+    const std::vector<Task>& getAllTasks() const;
     void completeTask(int id);
+    // Undo completeTask: the task is pending again
+    void reopenTask(int id);
     void deleteTask(int id);
 
-    // Persistence
+    // Task attributes
+    void setPriority(int id, int priority);
+    void setDue(int id, std::int64_t due);
+    void addTag(int id, const std::string& tag);
+    void removeTag(int id, const std::string& tag);
+    // Merge each group into its first task, which gains the others' tags, the
+    // highest priority and the earliest due date; the others are deleted.
+    // Saves once. Returns the number of tasks deleted.
+    size_t mergeTasks(const std::vector<std::vector<int>>& groups);
+
+    // Indexed queries: O(log N + k) instead of a full scan. The tasks are
+    // not copied; the pointers are invalidated like findTaskById()'s reference.
+    // Pending tasks with a due date, earliest first
+    std::vector<const Task*> getUpcoming(size_t limit) const;
+    // All tasks carrying the tag, in ID order
+    std::vector<const Task*> getTasksByTag(const std::string& tag) const;
+
+    // Parallel scans over every task (see parallel.h). Predicates run
+    // concurrently on worker threads and must not modify shared state.
+    template <typename Pred>
+    size_t countIf(Pred pred) const;
+    template <typename Pred>
+    std::vector<Task> filter(Pred pred) const;  // Matches in ID order
+    // fn may change anything but the task ID; returns the number of matches.
+    // Completing or reopening a task stamps its completion time as
+    // completeTask() and reopenTask() do (unless fn set one), and a memory
+    // budget is checked afterwards, archiving completed tasks like an add.
+    template <typename Pred, typename Fn>
+    size_t forEachIf(Pred pred, Fn fn);
+
+    // Dependencies: a task waits for its blockers and is ready once none of
+    // them is pending (see dependency_graph.h). Edges are kept next to the
+    // store (tasks.json -> tasks.deps), rewritten whole when they change.
+    // Adding one that would close a cycle throws std::runtime_error.
+    std::filesystem::path dependencyPath() const;
+    void addDependency(int id, int blocker);
+    // All or nothing, for bulk imports: O(V + E) however many there are.
+    // Returns the number added (existing edges are skipped).
+    size_t addDependencies(const std::vector<DependencyGraph::Edge>& edges);
+    void removeDependency(int id, int blocker);
+    // Pending tasks none of whose blockers is pending: most urgent first, then by ID
+    std::vector<Task> getReady(size_t limit) const;
+    const DependencyGraph& dependencies() const { return dependencies_; }
+
+    // Persistence. For a binary store save() is a full rewrite (compaction);
+    // mutations only write back the records they changed. A store whose file
+    // does not exist yet is created (with its directory) by the first save.
     void save() const;
     void load();
+    // save() split for writing off the calling thread: serializes a JSON
+    // store now and returns the file write, which owns its data and touches
+    // nothing in this object. Binary stores write their changed records right
+    // away and return an empty job. For callers that turned autosave off.
+    std::function<void()> saveJob() const;
+
+    // Archive tier: completed tasks move to an append-only JSON-lines file next
+    // to the store (tasks.json -> tasks.archive.jsonl) that load() never reads,
+    // so memory and save cost scale with the active tasks only.
+    std::filesystem::path archivePath() const;
+    // Move tasks completed at or before the cutoff (seconds since the epoch;
+    // tasks completed before completion times were recorded count as old).
+    // Returns the number of tasks moved.
+    size_t archiveCompleted(std::int64_t completedBefore);
+    // Stream the archive, returning matches in file order. Lines that do not
+    // parse (a torn tail from an interrupted append) are skipped.
+    std::vector<Task> searchArchive(const std::function<bool(const Task&)>& pred) const;
+    std::vector<Task> getArchivedTasks() const;
+    // Point lookups in the archive. Bloom filters over archived IDs and
+    // descriptions, kept in <archive>.bloom and rebuilt whenever the archive
+    // changed behind their back, answer most misses without reading it.
+    std::optional<Task> findArchived(int id) const;
+    bool isArchivedDescription(std::string_view description) const;
+
+    // Mutations call save() unless auto-save is off (bulk imports save once at the end)
+    void setAutoSave(bool enabled);
+    // Pretty (default, 4-space indent) or compact files; load() reads either
+    void setJsonStyle(TaskJson::Style style);
+    // No notices on stdout (for embedders, see taskstore.h)
+    void setQuiet(bool quiet);
+    // Record/heap statistics of a binary store, nullptr for JSON
+    const BinaryStore* binaryStore() const { return binary_.get(); }
+
+    // Change log for replicas in other processes (tasks.json ->
+    // tasks.changes.log, see change_log.h). Off by default; enabling starts
+    // the log with a snapshot of the store, and every change persisted after
+    // that is appended as one change set.
+    void enableChangeLog();
+    std::filesystem::path changeLogPath() const;
+    bool isReplica() const { return follower_ != nullptr; }
+    // Replicas: apply the change sets committed since the last call and
+    // return their number (0 on a primary). Cheap when nothing changed.
+    size_t catchUp();
+    // Last change set written (primary) or applied (replica); 0 without a log
+    std::uint64_t changeLsn() const;
+
+    // Heap held by each part of the store, measured as the allocator sees it
+    // (see footprint.h). O(N): walks every task.
+    struct MemoryUsage {
+        size_t tasks = 0;    // Task objects (the whole capacity of the task vector)
+        size_t strings = 0;  // Descriptions and tags
+        size_t indexes = 0;  // ID, due-date, tag and completion indexes, dependencies
+        size_t caches = 0;   // Save buffer, archive filters, binary-store and change-log buffers
+        size_t total() const { return tasks + strings + indexes + caches; }
+    };
+    MemoryUsage memoryUsage() const;
+    // Bytes the store may use (0, the default, means no limit), checked on
+    // load and as tasks are added. Over budget, the oldest completed tasks
+    // move to the archive (still found by `find` and `list all`) until usage
+    // is back under 7/8 of it. If that is not enough, a load is refused (the
+    // store is dropped and load() throws std::runtime_error), and addTask()
+    // or this call throw std::runtime_error instead.
+    void setMemoryBudget(size_t bytes);
+    size_t memoryBudget() const { return memoryBudget_; }
 
     // Utilities
     bool exists() const;
     size_t getTaskCount() const;
-    Task findTaskById(int id) const;
+    // The reference is invalidated by the next add/delete/load
+    const Task& findTaskById(int id) const;
+    // Same, but nullptr for an unknown (or archived) ID
+    const Task* findTask(int id) const;
+    // Existence and completion of every task, for status checks from other
+    // threads while this one changes the store: unlike the calls above, safe
+    // to use concurrently (wait-free, see completion_bits.h). Lives as long
+    // as the store.
+    const CompletionBits& completionState() const { return *completion_; }
 
 private:
     std::filesystem::path filePath_;
     std::vector<Task> tasks_;
     int nextId_;
+    bool autoSave_ = true;
+    bool quiet_ = false;
+    size_t memoryBudget_ = 0;
+    size_t measuredUsage_ = 0;  // memoryUsage().total() when last measured
+    size_t unmeasured_ = 0;     // Upper bound of what adds allocated since
+    TaskJson::Style jsonStyle_ = TaskJson::Style::Pretty;
+    mutable std::string saveBuffer_;  // Reused by every save()
+    mutable bool onDisk_ = false;     // The store file exists
+    mutable std::unique_ptr<BinaryStore> binary_;  // Opened on load or by the first save
+    std::unique_ptr<ChangeLog> changeLog_;         // Primaries with enableChangeLog()
+    mutable std::vector<int> logPending_;          // IDs changed since the last change set
+    std::unique_ptr<ChangeLogReader> follower_;    // Replicas only
+
+    // Secondary indexes, kept in sync with tasks_ by every mutation
+    IdIndex idIndex_;                                         // IDs of tasks_, ascending like tasks_
+    std::set<std::pair<std::int64_t, int>> dueIndex_;         // (due, id) of pending tasks
+    std::unordered_map<std::string, std::vector<int>> tagIndex_;  // tag -> sorted ids
+    std::unique_ptr<CompletionBits> completion_ = std::make_unique<CompletionBits>();  // Read by other threads
+    DependencyGraph dependencies_;
+    mutable bool dependenciesDirty_ = false;  // Edges changed since the last save
+
+    // Archive filters, read or rebuilt on first use
+    mutable BloomFilter archiveIds_;
+    mutable BloomFilter archiveDescriptions_;
+    mutable bool archiveFiltersReady_ = false;
+
+    struct ReplicaTag {};
+    Storage(std::filesystem::path path, ReplicaTag);
 
     // Helpers
     void initialize();
-    nlohmann::json toJson() const;
-    void fromJson(const nlohmann::json& j);
-};
\ No newline at end of file
+    void noteCreated() const;
+    void requireWritable() const;
+    bool fitMemoryBudget(size_t incoming);
+    bool evictCompleted(size_t bytes);
+    void admitLoaded();
+    void reserveMemory(size_t descriptionBytes);
+
+    void persist();
+    void loadDependencies();
+    void saveDependencies() const;
+    void markDirty(int id, unsigned change);  // Binary stores and the change log
+    void markAllDirty();
+    bool stageChanges() const;  // Hand pending change-log records to the log; false if it has none
+    void shipChanges() const;   // Stage and commit them
+    Task& getTaskRef(int id);
+    void removeAt(size_t index);
+    void upsert(Task task);  // Replicas: add or replace by ID
+    void rebuildIndexes();
+    void indexTask(const Task& task);
+    void unindexTask(const Task& task);
+    void addPosting(const std::string& tag, int id);
+    void removePosting(const std::string& tag, int id);
+    [[noreturn]] void throwNotFound(int id) const;
+
+    // fn returns false to stop early
+    void forEachArchived(const std::function<bool(Task&)>& fn) const;
+    std::filesystem::path archiveFilterPath() const;
+    void loadArchiveFilters() const;
+    void rebuildArchiveFilters() const;
+    void saveArchiveFilters(std::uint64_t archiveBytes) const;
+};
+
+template <typename Pred>
+size_t Storage::countIf(Pred pred) const {
+    return Parallel::reduce(
+        tasks_.size(), size_t{0},
+        [&](size_t begin, size_t end) {
+            size_t count = 0;
+            for (size_t i = begin; i < end; ++i) {
+                if (pred(tasks_[i])) ++count;
+            }
+            return count;
+        },
+        [](size_t a, size_t b) { return a + b; });
+}
+
+template <typename Pred>
+std::vector<Task> Storage::filter(Pred pred) const {
+    return Parallel::reduce(
+        tasks_.size(), std::vector<Task>{},
+        [&](size_t begin, size_t end) {
+            std::vector<Task> matches;
+            for (size_t i = begin; i < end; ++i) {
+                if (pred(tasks_[i])) matches.push_back(tasks_[i]);
+            }
+            return matches;
+        },
+        [](std::vector<Task> a, std::vector<Task> b) {
+            if (a.empty()) return b;
+            a.insert(a.end(), std::make_move_iterator(b.begin()), std::make_move_iterator(b.end()));
+            return a;
+        });
+}
+
+template <typename Pred, typename Fn>
+size_t Storage::forEachIf(Pred pred, Fn fn) {
+    requireWritable();
+    const std::int64_t now = std::time(nullptr);
+    size_t matched = Parallel::reduce(
+        tasks_.size(), size_t{0},
+        [&](size_t begin, size_t end) {
+            size_t count = 0;
+            for (size_t i = begin; i < end; ++i) {
+                Task& task = tasks_[i];
+                if (!pred(static_cast<const Task&>(task))) continue;
+                const bool wasCompleted = task.isCompleted();
+                const std::int64_t completedAt = task.getCompletedAt();
+                fn(task);
+                if (task.isCompleted() != wasCompleted && task.getCompletedAt() == completedAt) {
+                    task.setCompletedAt(task.isCompleted() ? now : Task::UNKNOWN_TIME);
+                }
+                ++count;
+            }
+            return count;
+        },
+        [](size_t a, size_t b) { return a + b; });
+    if (matched) {
+        // Due dates, completion and tags may all have changed
+        rebuildIndexes();
+        markAllDirty();
+        persist();
+        // Descriptions and tags may have grown: measure again. If archiving
+        // cannot bring the store back under the budget, the next add refuses.
+        if (memoryBudget_) fitMemoryBudget(0);
+    }
+    return matched;
+}
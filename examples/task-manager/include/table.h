@@ -0,0 +1,61 @@
+#pragma once
+
+#include "output.h"
+#include "task.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Renders task tables into an OutputSink, which writes them out in large chunks.
+///
+/// Column layout follows the terminal width when the output is a TTY; pipes and
+/// files get DEFAULT_WIDTH. Paginated mode stops after each screenful. The end
+/// of a table stays buffered until the sink's next flush, so a table and the
+/// messages around it leave in one write.
+class TableRenderer {
+public:
+    static constexpr int DEFAULT_WIDTH = 70;
+    static constexpr int MIN_WIDTH = 40;
+
+    struct TerminalSize {
+        int columns;
+        int rows;
+        bool isTerminal;
+    };
+
+    explicit TableRenderer(OutputSink& out = OutputSink::console());
+
+    // Query the terminal attached to fd (falls back to $COLUMNS/$LINES, then defaults)
+    static TerminalSize terminalSize(int fd);
+
+    // 0 = detect from the terminal on every render
+    void setWidth(int width);
+
+    void render(const std::vector<Task>& tasks, std::string_view title, bool paginate = false);
+    // Tasks still held by their store (Storage's indexed queries), not copied
+    void render(const std::vector<const Task*>& tasks, std::string_view title, bool paginate = false);
+
+private:
+    OutputSink& out_;
+    int width_;
+
+    struct Layout {
+        int width;
+        int idWidth;
+        bool showDue;
+        bool showPriority;
+        int descWidth;
+    };
+
+    // Tasks is a vector of tasks or of pointers to them
+    template <typename Tasks>
+    void renderAll(const Tasks& tasks, std::string_view title, bool paginate);
+    template <typename Tasks>
+    Layout computeLayout(const Tasks& tasks, int width) const;
+    void appendRule(char fill, int width);
+    void appendTextRow(std::string_view text, int width);
+    void appendTaskRow(const Task& task, const Layout& layout);
+    void appendFooter(int width);
+    bool promptNextPage();
+};
@@ -1,24 +1,60 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 class Task {
 public:
+    // Priority range accepted by setPriority(); higher means more urgent
+    static constexpr int MIN_PRIORITY = 0;
+    static constexpr int MAX_PRIORITY = 9;
+
+    // Sentinel for "no due date" (due timestamps are seconds since the Unix epoch),
+    // so 1970-01-01 itself cannot be a due date; every store format encodes it so
+    static constexpr std::int64_t NO_DUE = 0;
+    // Completion time of tasks completed before it was recorded (or never completed)
+    static constexpr std::int64_t UNKNOWN_TIME = 0;
+
     Task();
-    Task(int id, const std::string& desc, bool comp = false);
+    // Sink parameters are taken by value and moved into place
+    Task(int id, std::string desc, bool comp = false);
 
     int getId() const;
-    std::string getDescription() const;
+    std::string_view getDescription() const;
     bool isCompleted() const;
+    int getPriority() const;
+    std::int64_t getDue() const;
+    bool hasDue() const;
+    std::int64_t getCompletedAt() const;
+    const std::vector<std::string>& getTags() const;
+    bool hasTag(std::string_view tag) const;
+    // Heap held by the description and tags (see footprint.h)
+    size_t heapBytes() const;
 
-    void setDescription(const std::string& desc);
+    void setDescription(std::string desc);
     void setCompleted(bool comp);
+    void setPriority(int priority);
+    void setDue(std::int64_t due);
+    void setCompletedAt(std::int64_t timestamp);
+
+    // Returns false if the tag was already present / not present
+    bool addTag(std::string tag);
+    bool removeTag(std::string_view tag);
 
     std::string toString() const;
     bool validate() const;
 
+    static bool isValidTag(std::string_view tag);
+
 private:
     int id_;
     std::string description_;
     bool completed_;
-};
\ No newline at end of file
+    int priority_;
+    std::int64_t due_;
+    std::int64_t completedAt_;
+    std::vector<std::string> tags_;
+};
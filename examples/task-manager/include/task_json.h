@@ -0,0 +1,63 @@
+#pragma once
+
+#include "task.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+/// Task-file serialization without an intermediate nlohmann::json tree.
+///
+/// Output is byte-identical to dumping the equivalent nlohmann::json document
+/// (object keys in sorted order, dump(4) or dump()), so either side can read
+/// what the other wrote. The reader accepts exactly the task-file schema and
+/// defers everything else to nlohmann.
+namespace TaskJson {
+
+enum class Style {
+    Pretty,   // 4-space indentation, the historical file format
+    Compact,  // No whitespace
+};
+
+// Replace the contents of out with the task file (including a trailing newline).
+// out keeps its capacity, so reusing one buffer avoids reallocating per save.
+// Throws std::runtime_error if a string is not valid UTF-8.
+void write(std::string& out, const std::vector<Task>& tasks, int nextId, Style style = Style::Pretty);
+
+// Append one task as a compact object plus newline (a JSON-lines record)
+void writeLine(std::string& out, const Task& task);
+
+// Append text as a quoted JSON string, escaped the way nlohmann::json does
+void appendString(std::string& out, std::string_view text);
+
+// Schema-aware loader. Returns false, leaving tasks/nextId untouched, when
+// text is anything other than a well-formed task file it fully understands
+// (unknown or duplicate keys, non-integer numbers, malformed JSON, ...); the
+// caller then falls back to nlohmann::json::parse + fromDom, which also
+// produces the error message. When it returns true the result is identical
+// to that fallback.
+bool read(std::string_view text, std::vector<Task>& tasks, int& nextId);
+
+// Parse one writeLine() record, appending the task if it is valid. Returns
+// false under the same conditions as read(); fall back to readLineDom().
+bool readLine(std::string_view line, std::vector<Task>& tasks);
+// nlohmann path for one record; throws on malformed input
+void readLineDom(std::string_view line, std::vector<Task>& tasks);
+
+// Build tasks from a parsed document, moving strings out of it. Tasks with
+// out-of-range attributes are skipped; a missing "nextId" means 1.
+void fromDom(nlohmann::json& doc, std::vector<Task>& tasks, int& nextId);
+
+// Instruction set used by read() to scan strings and whitespace
+enum class Isa { Scalar, Sse2, Avx2 };
+Isa activeIsa();
+Isa bestIsa();         // Best the CPU supports
+void setIsa(Isa isa);  // Clamped to bestIsa(); for benchmarks and differential tests
+
+namespace detail {
+// Length of the well-formed UTF-8 sequence starting at s[i] (s[i] >= 0x80), or 0
+size_t utf8SequenceLength(std::string_view s, size_t i);
+}
+
+}  // namespace TaskJson
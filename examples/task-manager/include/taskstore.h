@@ -0,0 +1,82 @@
+#pragma once
+
+/// C API of the task store (libtaskstore), for services that embed the
+/// storage engine instead of running `tm` once per operation.
+///
+/// Every function that can fail returns a ts_status; the message of the last
+/// failure is kept in the store (ts_last_error). No C++ exception crosses this
+/// boundary. complete/delete/get/count/iterate allocate nothing; add copies
+/// the description and, on a *.bin store, allocates the new record's entry in
+/// the store's ID-to-record map. Stores named *.bin write back only the
+/// records a call changed, JSON stores rewrite the file on each mutation
+/// unless autosave is turned off (then ts_save writes everything once).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  define TS_API __declspec(dllexport)
+#elif defined(__GNUC__) || defined(__clang__)
+#  define TS_API __attribute__((visibility("default")))
+#else
+#  define TS_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bumped whenever a declaration below changes incompatibly
+#define TS_API_VERSION 1
+
+typedef enum ts_status {
+    TS_OK = 0,
+    TS_NOT_FOUND = 1,         // No task with that ID
+    TS_INVALID_ARGUMENT = 2,  // Empty description, null pointer, ...
+    TS_IO_ERROR = 3,          // The store file could not be read or written
+    TS_ERROR = 4              // Anything else (see ts_last_error)
+} ts_status;
+
+typedef struct ts_store ts_store;
+
+// A view of one task. `description` is not NUL-terminated and, like the
+// struct itself, is only valid until the next call that modifies the store.
+typedef struct ts_task {
+    int id;
+    int completed;           // 0 or 1
+    int priority;            // 0..9
+    int64_t due;             // Seconds since the epoch, 0 = none
+    int64_t completed_at;    // Seconds since the epoch, 0 = unknown
+    const char* description;
+    size_t description_len;
+} ts_task;
+
+// Return non-zero to stop the iteration
+typedef int (*ts_visit_fn)(const ts_task* task, void* user);
+
+TS_API int ts_api_version(void);
+TS_API const char* ts_status_string(ts_status status);
+
+// Open (or prepare to create, on first change) the store at `path`; a
+// relative path is resolved against the current directory
+TS_API ts_status ts_open(const char* path, ts_store** store);
+TS_API void ts_close(ts_store* store);
+// Message of the last failed call on this store ("" after a success)
+TS_API const char* ts_last_error(const ts_store* store);
+
+TS_API ts_status ts_add(ts_store* store, const char* description, size_t len, int* id);
+TS_API ts_status ts_complete(ts_store* store, int id);
+TS_API ts_status ts_delete(ts_store* store, int id);
+
+TS_API ts_status ts_get(const ts_store* store, int id, ts_task* task);
+TS_API size_t ts_count(const ts_store* store);
+// Visit every task in store order
+TS_API ts_status ts_iterate(const ts_store* store, ts_visit_fn visit, void* user);
+
+// Autosave is on by default: every mutation is persisted before it returns
+TS_API ts_status ts_set_autosave(ts_store* store, int enabled);
+TS_API ts_status ts_save(ts_store* store);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+/// Scoped trace spans exported as Chrome trace_event JSON (chrome://tracing, Perfetto).
+///
+/// Each thread records into its own fixed-size ring buffer, so a span costs two
+/// clock reads and a few relaxed stores; nothing is shared between recording
+/// threads. When the ring wraps, the oldest spans are dropped. A thread's ring
+/// goes to the next new thread once it exits, so there are only ever as many
+/// rings as threads that recorded at the same time.
+namespace Trace {
+
+// Ring slots per thread; the newest RING_CAPACITY - 1 spans are readable, the
+// remaining slot being the one a recording thread may be writing
+constexpr size_t RING_CAPACITY = size_t{1} << 16;
+
+namespace detail {
+extern std::atomic<bool> enabled;
+std::int64_t nowNs() noexcept;
+void record(const char* name, std::int64_t startNs, std::int64_t endNs) noexcept;
+}
+
+inline bool enabled() noexcept { return detail::enabled.load(std::memory_order_relaxed); }
+void setEnabled(bool on);
+
+/// Records [construction, destruction) under `name`, which must outlive the
+/// trace (use string literals)
+class Span {
+public:
+    explicit Span(const char* name) noexcept : name_(enabled() ? name : nullptr) {
+        if (name_) start_ = detail::nowNs();
+    }
+    ~Span() {
+        if (name_) detail::record(name_, start_, detail::nowNs());
+    }
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* name_;
+    std::int64_t start_ = 0;
+};
+
+// Spans currently held in all rings
+size_t eventCount();
+// Rings allocated so far (RING_CAPACITY slots each)
+size_t ringCount();
+// Drop every recorded span
+void clear();
+
+std::string toChromeJson();
+void writeChromeJson(const std::filesystem::path& path);
+
+}  // namespace Trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) Trace::Span TRACE_CONCAT(traceSpan_, __LINE__)(name)
@@ -1,22 +1,35 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace Utils {
 
-// ANSI colors (cross-platform on modern terminals; Windows 10+ supported)
-const std::string RESET = "\033[0m";
-const std::string RED = "\033[31m";
-const std::string GREEN = "\033[32m";
-const std::string YELLOW = "\033[33m";
-const std::string BLUE = "\033[34m";
-const std::string CYAN = "\033[36m";
-
-// Print text with color
-void printColored(const std::string& text, const std::string& color);
+// ANSI colors (cross-platform on modern terminals; Windows 10+ supported).
+// Written through OutputSink, which drops them when stdout is not a terminal.
+constexpr std::string_view RESET = "\033[0m";
+constexpr std::string_view RED = "\033[31m";
+constexpr std::string_view GREEN = "\033[32m";
+constexpr std::string_view YELLOW = "\033[33m";
+constexpr std::string_view BLUE = "\033[34m";
+constexpr std::string_view CYAN = "\033[36m";
 
 // Other utilities
 std::string trim(const std::string& str);
+// Ask on the console sink and read a y/n answer from stdin
 bool confirm(const std::string& question);
 
+// ASCII case-insensitive substring test
+bool containsIgnoreCase(std::string_view haystack, std::string_view needle);
+
+// Dates use "YYYY-MM-DD" and are stored as seconds since the Unix epoch (UTC midnight)
+bool parseDate(std::string_view text, std::int64_t& timestamp);
+std::string formatDate(std::int64_t timestamp);
+
+// Byte counts: "65536", "512K", "64M", "2G" (binary units) / "1.5 MiB"
+bool parseBytes(std::string_view text, size_t& bytes);
+std::string formatBytes(size_t bytes);
+
 }  // namespace Utils
\ No newline at end of file
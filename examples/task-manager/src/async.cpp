@@ -0,0 +1,126 @@
+#include "async.h"
+#include "trace.h"
+#include <utility>
+
+namespace Async {
+
+Executor::Executor(unsigned ioThreads) {
+    if (ioThreads == 0) ioThreads = 1;
+    threads_.reserve(ioThreads);
+    for (unsigned i = 0; i < ioThreads; ++i) {
+        threads_.emplace_back([this] { ioLoop(); });
+    }
+}
+
+Executor::~Executor() {
+    // Callbacks resume coroutines that may still hold references into the
+    // owner's frame, so they run here rather than being dropped
+    drain();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) thread.join();
+}
+
+void Executor::submit(std::function<void()> work, std::function<void(std::exception_ptr)> done) {
+    ++inFlight_;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queued_.push_back({std::move(work), std::move(done), nullptr});
+    }
+    wake_.notify_one();
+}
+
+void Executor::ioLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return stop_ || !queued_.empty(); });
+        if (queued_.empty()) return;  // Stopping, and nothing left to do
+        Work work = std::move(queued_.front());
+        queued_.pop_front();
+        lock.unlock();
+        try {
+            TRACE_SCOPE("Async::io");
+            work.run();
+        } catch (...) {
+            work.error = std::current_exception();
+        }
+        lock.lock();
+        completed_.push_back(std::move(work));
+        finished_.notify_one();
+    }
+}
+
+size_t Executor::poll() {
+    std::deque<Work> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready.swap(completed_);
+    }
+    for (auto& work : ready) {
+        --inFlight_;
+        work.done(work.error);
+    }
+    return ready.size();
+}
+
+size_t Executor::wait() {
+    if (inFlight_ == 0) return poll();
+    {
+        TRACE_SCOPE("Async::wait");
+        std::unique_lock<std::mutex> lock(mutex_);
+        finished_.wait(lock, [this] { return !completed_.empty(); });
+    }
+    return poll();
+}
+
+void Executor::drain() {
+    while (inFlight_ > 0) wait();
+}
+
+void Offload::await_suspend(std::coroutine_handle<> handle) {
+    executor_.submit(std::move(work_), [this, handle](std::exception_ptr error) {
+        error_ = std::move(error);
+        handle.resume();
+    });
+}
+
+GroupCommit::GroupCommit(Executor& executor, Prepare prepare) : executor_(executor), prepare_(std::move(prepare)) {}
+
+void GroupCommit::Durable::await_suspend(std::coroutine_handle<> handle) {
+    handle_ = handle;
+    commit_.waiters_.push_back(this);
+    // The writer may finish synchronously and resume `handle` before this
+    // returns, so nothing here may touch the awaiter afterwards
+    if (!commit_.writing_) commit_.writer();
+}
+
+Job GroupCommit::writer() {
+    writing_ = true;
+    while (durable_ < dirty_) {
+        // Everything marked up to now goes into this write; later changes
+        // queue behind it and share the next one
+        const std::uint64_t covered = dirty_;
+        std::exception_ptr error;
+        try {
+            auto write = prepare_();
+            if (write) co_await offload(executor_, std::move(write));
+        } catch (...) {
+            error = std::current_exception();
+        }
+        ++writes_;
+        // A failed write settles its changes too: their waiters get the error
+        durable_ = covered;
+        while (!waiters_.empty() && waiters_.front()->target_ <= covered) {
+            Durable* waiter = waiters_.front();
+            waiters_.pop_front();
+            waiter->error_ = error;
+            waiter->handle_.resume();
+        }
+    }
+    writing_ = false;
+}
+
+}  // namespace Async
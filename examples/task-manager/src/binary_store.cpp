@@ -0,0 +1,546 @@
+#include "binary_store.h"
+#include "footprint.h"
+#include "startup.h"
+#include "trace.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#ifdef _WIN32
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char MAGIC[8] = {'T', 'M', 'S', 'T', 'O', 'R', 'E', '1'};
+constexpr std::uint32_t VERSION = 1;
+
+constexpr std::uint8_t FLAG_LIVE = 1u << 0;
+constexpr std::uint8_t FLAG_COMPLETED = 1u << 1;
+
+// Compaction thresholds: rewrite once garbage outweighs live data and is not trivially small
+constexpr size_t MIN_DEAD_RECORDS = 1024;
+constexpr std::uint64_t MIN_HEAP_GARBAGE = 1u << 20;
+
+template <typename T>
+void put(char* at, T value) {
+    if constexpr (std::endian::native == std::endian::big) value = std::byteswap(value);
+    std::memcpy(at, &value, sizeof(T));
+}
+
+template <typename T>
+T get(const char* at) {
+    T value;
+    std::memcpy(&value, at, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big) value = std::byteswap(value);
+    return value;
+}
+
+// Record layout (48 bytes):
+//   0 i32 id          4 u8 flags      5 u8 priority   6 u16 tag count
+//   8 i64 due        16 u64 desc off 24 u32 desc len 28 u32 tags len
+//  32 u64 tags off  40 i64 completed at
+using Record = std::array<char, BinaryStore::RECORD_SIZE>;
+
+[[noreturn]] void ioError(const std::string& what, const fs::path& path) {
+    throw std::runtime_error(what + " " + path.string() + ": " + std::strerror(errno));
+}
+
+[[noreturn]] void corrupt(const fs::path& path, const std::string& detail) {
+    throw std::runtime_error("Corrupt task store " + path.string() + ": " + detail);
+}
+
+int openFile(const fs::path& path) {
+#ifdef _WIN32
+    int fd = ::_open(path.string().c_str(), _O_RDWR | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+#endif
+    if (fd < 0) ioError("Cannot open", path);
+    return fd;
+}
+
+void closeFile(int fd) {
+#ifdef _WIN32
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+std::uint64_t fileSize(int fd, const fs::path& path) {
+#ifdef _WIN32
+    long long size = ::_lseeki64(fd, 0, SEEK_END);
+#else
+    off_t size = ::lseek(fd, 0, SEEK_END);
+#endif
+    if (size < 0) ioError("Cannot seek", path);
+    return static_cast<std::uint64_t>(size);
+}
+
+void truncateFile(int fd, std::uint64_t size, const fs::path& path) {
+#ifdef _WIN32
+    bool ok = ::_chsize_s(fd, static_cast<long long>(size)) == 0;
+#else
+    bool ok = ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+#endif
+    if (!ok) ioError("Cannot truncate", path);
+}
+
+void syncFile(int fd, const fs::path& path) {
+#ifdef _WIN32
+    bool ok = ::_commit(fd) == 0;
+#else
+    bool ok = ::fsync(fd) == 0;
+#endif
+    if (!ok) ioError("Cannot sync", path);
+}
+
+// Makes the renames in dir durable; Windows has no directory handle to sync
+void syncDirectory(const fs::path& dir) {
+#ifndef _WIN32
+    int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) ioError("Cannot open", dir);
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok) ioError("Cannot sync", dir);
+#else
+    (void)dir;
+#endif
+}
+
+// Where rewrite() builds the new version of a file
+fs::path aside(const fs::path& path) {
+    fs::path tmp = path;
+    tmp += ".tmp";
+    return tmp;
+}
+
+// rewrite() renames the new heap into place before the new records, so
+// records left aside without their heap were built for the heap now in place:
+// the interrupted compaction is finished. Anything else left aside is dropped.
+void finishRewrite(const fs::path& path, const fs::path& heapPath) {
+    std::error_code ec;
+    if (!fs::exists(aside(heapPath), ec) && fs::exists(aside(path), ec)) {
+        fs::rename(aside(path), path);
+        syncDirectory(path.parent_path());
+        return;
+    }
+    fs::remove(aside(path), ec);
+    fs::remove(aside(heapPath), ec);
+}
+
+std::array<char, BinaryStore::HEADER_SIZE> encodeHeader(std::uint64_t recordCount, std::uint64_t heapSize, int nextId) {
+    std::array<char, BinaryStore::HEADER_SIZE> header{};
+    std::memcpy(header.data(), MAGIC, sizeof(MAGIC));
+    put<std::uint32_t>(&header[8], VERSION);
+    put<std::uint32_t>(&header[12], static_cast<std::uint32_t>(BinaryStore::RECORD_SIZE));
+    put<std::uint64_t>(&header[16], recordCount);
+    put<std::uint64_t>(&header[24], heapSize);
+    put<std::int32_t>(&header[32], nextId);
+    return header;
+}
+
+struct Header {
+    std::uint64_t recordCount;
+    std::uint64_t heapSize;
+    int nextId;
+};
+
+Header checkHeader(const fs::path& path, const char* header) {
+    if (std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0) corrupt(path, "not a task store");
+    if (get<std::uint32_t>(header + 8) != VERSION || get<std::uint32_t>(header + 12) != BinaryStore::RECORD_SIZE) {
+        corrupt(path, "unsupported version");
+    }
+    return {get<std::uint64_t>(header + 16), get<std::uint64_t>(header + 24), get<std::int32_t>(header + 32)};
+}
+
+Record encodeRecord(const Task& task, std::uint64_t descOffset, std::uint32_t descLength, std::uint64_t tagsOffset,
+                    std::uint32_t tagsLength) {
+    Record r{};
+    put<std::int32_t>(&r[0], task.getId());
+    r[4] = static_cast<char>(FLAG_LIVE | (task.isCompleted() ? FLAG_COMPLETED : 0));
+    r[5] = static_cast<char>(task.getPriority());
+    put<std::uint16_t>(&r[6], static_cast<std::uint16_t>(task.getTags().size()));
+    put<std::int64_t>(&r[8], task.getDue());
+    put<std::uint64_t>(&r[16], descOffset);
+    put<std::uint32_t>(&r[24], descLength);
+    put<std::uint32_t>(&r[28], tagsLength);
+    put<std::uint64_t>(&r[32], tagsOffset);
+    put<std::int64_t>(&r[40], task.getCompletedAt());
+    return r;
+}
+
+Record tombstone(int id) {
+    Record r{};
+    put<std::int32_t>(&r[0], id);
+    return r;
+}
+
+}  // namespace
+
+BinaryStore::BinaryStore(fs::path path) : path_(std::move(path)), heapPath_(path_) {
+    heapPath_ += ".heap";
+    finishRewrite(path_, heapPath_);
+    fd_ = openFile(path_);
+    try {
+        heapFd_ = openFile(heapPath_);
+    } catch (...) {
+        closeFile(fd_);
+        throw;
+    }
+}
+
+BinaryStore::~BinaryStore() {
+    closeFile(fd_);
+    closeFile(heapFd_);
+}
+
+bool BinaryStore::handles(const fs::path& path) { return path.extension() == ".bin"; }
+
+void BinaryStore::interruptAfter(size_t steps) { stepsLeft_ = steps; }
+
+void BinaryStore::step(const fs::path& path) {
+    if (stepsLeft_ == 0) throw std::runtime_error("Interrupted before writing " + path.string());
+    --stepsLeft_;
+}
+
+void BinaryStore::writeAt(int fd, const fs::path& path, const char* data, size_t size, std::uint64_t offset) {
+    step(path);
+    while (size > 0) {
+#ifdef _WIN32
+        if (::_lseeki64(fd, static_cast<long long>(offset), SEEK_SET) < 0) ioError("Cannot seek", path);
+        int chunk = static_cast<int>(std::min<size_t>(size, 1u << 30));
+        int n = ::_write(fd, data, static_cast<unsigned>(chunk));
+#else
+        ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+#endif
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ioError("Cannot write", path);
+        }
+        ++writeCalls_;
+        bytesWritten_ += static_cast<std::uint64_t>(n);
+        data += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<std::uint64_t>(n);
+    }
+}
+
+void BinaryStore::readAt(int fd, const fs::path& path, char* data, size_t size, std::uint64_t offset) const {
+    while (size > 0) {
+#ifdef _WIN32
+        if (::_lseeki64(fd, static_cast<long long>(offset), SEEK_SET) < 0) ioError("Cannot seek", path);
+        int chunk = static_cast<int>(std::min<size_t>(size, 1u << 30));
+        int n = ::_read(fd, data, static_cast<unsigned>(chunk));
+#else
+        ssize_t n = ::pread(fd, data, size, static_cast<off_t>(offset));
+#endif
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ioError("Cannot read", path);
+        }
+        if (n == 0) corrupt(path, "unexpected end of file");
+        data += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<std::uint64_t>(n);
+    }
+}
+
+void BinaryStore::writeHeader(int nextId) {
+    const auto header = encodeHeader(recordCount_, heapSize_, nextId);
+    writeAt(fd_, path_, header.data(), header.size(), 0);
+    nextIdOnDisk_ = nextId;
+}
+
+// Appends the task's description and tag list (u8 length + bytes per tag) to
+// heap, which starts at offset base of the heap file
+BinaryStore::Slot BinaryStore::appendStrings(std::string& heap, std::uint64_t base, const Task& task) {
+    Slot slot{};
+    slot.descOffset = base + heap.size();
+    slot.descLength = static_cast<std::uint32_t>(task.getDescription().size());
+    heap += task.getDescription();
+    slot.tagsOffset = base + heap.size();
+    for (const auto& tag : task.getTags()) {
+        heap += static_cast<char>(tag.size());
+        heap += tag;
+    }
+    slot.tagsLength = static_cast<std::uint32_t>(base + heap.size() - slot.tagsOffset);
+    return slot;
+}
+
+void BinaryStore::build(const std::vector<Task>& tasks, int nextId, std::string& records, std::string& heap,
+                        std::unordered_map<int, Slot>* slots) {
+    records.clear();
+    heap.clear();
+    records.reserve(HEADER_SIZE + tasks.size() * RECORD_SIZE);
+    records.resize(HEADER_SIZE);
+    if (slots) slots->reserve(tasks.size());
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        const Task& task = tasks[i];
+        Slot slot = appendStrings(heap, 0, task);
+        slot.index = i;
+        Record r = encodeRecord(task, slot.descOffset, slot.descLength, slot.tagsOffset, slot.tagsLength);
+        records.append(r.data(), r.size());
+        if (slots) (*slots)[task.getId()] = slot;
+    }
+    const auto header = encodeHeader(tasks.size(), heap.size(), nextId);
+    std::memcpy(records.data(), header.data(), header.size());
+}
+
+BinaryStore::Parsed BinaryStore::parse(const fs::path& path, std::string_view records, std::string_view heap,
+                                       std::vector<Task>& tasks) {
+    Parsed parsed;
+    const std::uint64_t recordCount = records.size() / RECORD_SIZE;
+    const std::uint64_t heapSize = heap.size();
+    std::vector<Task> loaded;
+    loaded.reserve(static_cast<size_t>(recordCount));
+    for (std::uint64_t i = 0; i < recordCount; ++i) {
+        const char* r = records.data() + i * RECORD_SIZE;
+        auto flags = static_cast<std::uint8_t>(r[4]);
+        if (!(flags & FLAG_LIVE)) {
+            ++parsed.dead;
+            continue;
+        }
+        Slot slot{i, get<std::uint64_t>(r + 16), get<std::uint64_t>(r + 32), get<std::uint32_t>(r + 24),
+                  get<std::uint32_t>(r + 28)};
+        if (slot.descOffset > heapSize || slot.descLength > heapSize - slot.descOffset ||
+            slot.tagsOffset > heapSize || slot.tagsLength > heapSize - slot.tagsOffset) {
+            corrupt(path, "record " + std::to_string(i) + " points outside the heap");
+        }
+        Task t(get<std::int32_t>(r), std::string(heap.substr(static_cast<size_t>(slot.descOffset), slot.descLength)),
+               (flags & FLAG_COMPLETED) != 0);
+        // Same acceptance rules as the JSON loaders
+        try {
+            t.setPriority(static_cast<std::uint8_t>(r[5]));
+            t.setDue(get<std::int64_t>(r + 8));
+            t.setCompletedAt(get<std::int64_t>(r + 40));
+            size_t at = static_cast<size_t>(slot.tagsOffset);
+            size_t end = at + slot.tagsLength;
+            while (at < end) {
+                size_t length = static_cast<unsigned char>(heap[at++]);
+                if (length > end - at) corrupt(path, "record " + std::to_string(i) + " has a bad tag list");
+                t.addTag(std::string(heap.substr(at, length)));
+                at += length;
+            }
+        } catch (const std::invalid_argument&) {
+            ++parsed.dead;
+            continue;
+        }
+        if (!t.validate()) {
+            ++parsed.dead;
+            continue;
+        }
+        parsed.liveBytes += slot.descLength + slot.tagsLength;
+        parsed.slots[t.getId()] = slot;
+        loaded.push_back(std::move(t));
+    }
+    tasks = std::move(loaded);
+    return parsed;
+}
+
+void BinaryStore::encode(const std::vector<Task>& tasks, int nextId, std::string& records, std::string& heap) {
+    build(tasks, nextId, records, heap, nullptr);
+}
+
+void BinaryStore::decode(std::string_view records, std::string_view heap, std::vector<Task>& tasks, int& nextId) {
+    const fs::path path = "(buffer)";
+    if (records.size() < HEADER_SIZE) corrupt(path, "missing header");
+    const Header header = checkHeader(path, records.data());
+    if (header.recordCount > (records.size() - HEADER_SIZE) / RECORD_SIZE) corrupt(path, "truncated records");
+    if (header.heapSize > heap.size()) corrupt(path, "truncated heap");
+    parse(path, records.substr(HEADER_SIZE, static_cast<size_t>(header.recordCount * RECORD_SIZE)),
+          heap.substr(0, static_cast<size_t>(header.heapSize)), tasks);
+    nextId = header.nextId;
+}
+
+void BinaryStore::load(std::vector<Task>& tasks, int& nextId) {
+    TRACE_SCOPE("BinaryStore::load");
+    std::uint64_t size = fileSize(fd_, path_);
+    if (size < HEADER_SIZE) corrupt(path_, "missing header");
+    std::array<char, HEADER_SIZE> bytes;
+    readAt(fd_, path_, bytes.data(), bytes.size(), 0);
+    const Header header = checkHeader(path_, bytes.data());
+    if (header.recordCount > (size - HEADER_SIZE) / RECORD_SIZE) corrupt(path_, "truncated records");
+    if (header.heapSize > fileSize(heapFd_, heapPath_)) corrupt(heapPath_, "truncated heap");
+
+    std::string records(static_cast<size_t>(header.recordCount * RECORD_SIZE), '\0');
+    std::string heap(static_cast<size_t>(header.heapSize), '\0');
+    {
+        Startup::Scope scope(Startup::Phase::Read);
+        readAt(fd_, path_, records.data(), records.size(), HEADER_SIZE);
+        readAt(heapFd_, heapPath_, heap.data(), heap.size(), 0);
+    }
+
+    Startup::Scope scope(Startup::Phase::Parse);
+    Parsed parsed = parse(path_, records, heap, tasks);
+    nextId = header.nextId;
+    recordCount_ = header.recordCount;
+    heapSize_ = header.heapSize;
+    heapGarbage_ = header.heapSize - parsed.liveBytes;
+    deadRecords_ = parsed.dead;
+    nextIdOnDisk_ = nextId;
+    slots_ = std::move(parsed.slots);
+    dirty_.clear();
+    rewriteAll_ = false;
+}
+
+void BinaryStore::rewrite(const std::vector<Task>& tasks, int nextId) {
+    TRACE_SCOPE("BinaryStore::rewrite");
+    std::string heap;
+    std::string records;
+    std::unordered_map<int, Slot> slots;
+    build(tasks, nextId, records, heap, &slots);
+
+    // Both files are built aside and synced before either replaces the old
+    // one, so an interrupted compaction leaves the old store or the new one
+    const fs::path heapTmp = aside(heapPath_);
+    const fs::path recordsTmp = aside(path_);
+    int heapFd = -1;
+    int fd = -1;
+    try {
+        heapFd = openFile(heapTmp);
+        truncateFile(heapFd, 0, heapTmp);
+        writeAt(heapFd, heapTmp, heap.data(), heap.size(), 0);
+        syncFile(heapFd, heapTmp);
+        fd = openFile(recordsTmp);
+        truncateFile(fd, 0, recordsTmp);
+        writeAt(fd, recordsTmp, records.data(), records.size(), 0);
+        syncFile(fd, recordsTmp);
+    } catch (...) {
+        if (fd >= 0) closeFile(fd);
+        if (heapFd >= 0) closeFile(heapFd);
+        std::error_code ec;
+        fs::remove(recordsTmp, ec);
+        fs::remove(heapTmp, ec);
+        throw;
+    }
+    closeFile(fd);
+    closeFile(heapFd);
+
+    // Heap first: finishRewrite() completes a compaction cut short in between
+    closeFile(fd_);
+    closeFile(heapFd_);
+    fd_ = heapFd_ = -1;
+    step(heapPath_);
+    fs::rename(heapTmp, heapPath_);
+    syncDirectory(heapPath_.parent_path());
+    step(path_);
+    fs::rename(recordsTmp, path_);
+    syncDirectory(path_.parent_path());
+    heapFd_ = openFile(heapPath_);
+    fd_ = openFile(path_);
+
+    recordCount_ = tasks.size();
+    heapSize_ = heap.size();
+    heapGarbage_ = 0;
+    deadRecords_ = 0;
+    nextIdOnDisk_ = nextId;
+    slots_ = std::move(slots);
+    dirty_.clear();
+    rewriteAll_ = false;
+}
+
+void BinaryStore::markDirty(int id, unsigned change) { dirty_.emplace_back(id, change); }
+
+void BinaryStore::markAllDirty() { rewriteAll_ = true; }
+
+bool BinaryStore::needsCompaction() const {
+    if (rewriteAll_) return true;
+    if (deadRecords_ >= MIN_DEAD_RECORDS && deadRecords_ > slots_.size()) return true;
+    return heapGarbage_ >= MIN_HEAP_GARBAGE && heapGarbage_ * 2 > heapSize_;
+}
+
+void BinaryStore::flush(const std::function<const Task*(int)>& find, int nextId) {
+    if (dirty_.empty() && nextId == nextIdOnDisk_) return;
+    TRACE_SCOPE("BinaryStore::flush");
+
+    // Ids ascend with insertion order, so appended records keep the file in ID order
+    std::sort(dirty_.begin(), dirty_.end());
+    auto& writes = writes_;
+    auto& heap = heapScratch_;
+    writes.clear();
+    heap.clear();
+    std::uint64_t recordCount = recordCount_;
+
+    for (size_t d = 0; d < dirty_.size();) {
+        const int id = dirty_[d].first;
+        unsigned change = 0;
+        for (; d < dirty_.size() && dirty_[d].first == id; ++d) change |= dirty_[d].second;
+        auto it = slots_.find(id);
+        if (change & DELETED) {
+            if (it != slots_.end()) {
+                writes.emplace_back(it->second.index, tombstone(id));
+                heapGarbage_ += it->second.descLength + it->second.tagsLength;
+                ++deadRecords_;
+                slots_.erase(it);
+            }
+            continue;
+        }
+        const Task* task = find(id);
+        if (!task) continue;
+        Slot slot;
+        if (it == slots_.end()) {
+            slot = appendStrings(heap, heapSize_, *task);
+            slot.index = recordCount++;
+        } else if (change & STRINGS) {
+            heapGarbage_ += it->second.descLength + it->second.tagsLength;
+            slot = appendStrings(heap, heapSize_, *task);
+            slot.index = it->second.index;
+        } else {
+            slot = it->second;
+        }
+        slots_[id] = slot;
+        writes.emplace_back(slot.index, encodeRecord(*task, slot.descOffset, slot.descLength, slot.tagsOffset, slot.tagsLength));
+    }
+
+    // Appended heap bytes and records lie past the header's counts until the
+    // header takes them in, and records are overwritten in place only after
+    // that: cut short anywhere, the file never points outside its heap
+    writeAt(heapFd_, heapPath_, heap.data(), heap.size(), heapSize_);
+    heapSize_ += heap.size();
+
+    // One write per run of adjacent records
+    std::sort(writes.begin(), writes.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    auto& run = runScratch_;
+    auto writeRuns = [&](size_t from, size_t to) {
+        for (size_t i = from; i < to;) {
+            size_t j = i;
+            run.clear();
+            do {
+                run.append(writes[j].second.data(), RECORD_SIZE);
+                ++j;
+            } while (j < to && writes[j].first == writes[j - 1].first + 1);
+            writeAt(fd_, path_, run.data(), run.size(), HEADER_SIZE + writes[i].first * RECORD_SIZE);
+            i = j;
+        }
+    };
+    const auto appended = static_cast<size_t>(
+        std::partition_point(writes.begin(), writes.end(), [&](const auto& w) { return w.first < recordCount_; }) -
+        writes.begin());
+    writeRuns(appended, writes.size());
+
+    bool grew = recordCount != recordCount_ || !heap.empty();
+    recordCount_ = recordCount;
+    if (grew || nextId != nextIdOnDisk_) writeHeader(nextId);
+    writeRuns(0, appended);
+    dirty_.clear();
+}
+
+BinaryStore::Stats BinaryStore::stats() const {
+    return {slots_.size(), deadRecords_, heapSize_, heapGarbage_, writeCalls_, bytesWritten_};
+}
+
+size_t BinaryStore::memoryBytes() const {
+    return Footprint::of(slots_) + Footprint::of(dirty_) + Footprint::of(writes_) + Footprint::of(heapScratch_) +
+           Footprint::of(runScratch_);
+}
@@ -0,0 +1,118 @@
+#include "bloom_filter.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+constexpr size_t WORDS_PER_BLOCK = BloomFilter::BLOCK_BITS / 64;
+constexpr unsigned MAX_HASHES = 16;
+constexpr size_t ENCODED_HEADER = 8 + 8 + 4 + 4 + 8;  // capacity, count, hashes, reserved, words
+
+template <typename T>
+void put(std::string& out, T value) {
+    if constexpr (std::endian::native == std::endian::big) value = std::byteswap(value);
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+template <typename T>
+T get(const char* at) {
+    T value;
+    std::memcpy(&value, at, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big) value = std::byteswap(value);
+    return value;
+}
+
+// splitmix64 finalizer
+std::uint64_t mix(std::uint64_t z) noexcept {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+}  // namespace
+
+BloomFilter::BloomFilter(size_t expectedItems, double falsePositiveRate) : capacity_(std::max<size_t>(expectedItems, 1)) {
+    const double p = std::clamp(falsePositiveRate, 1e-9, 0.5);
+    const double n = static_cast<double>(capacity_);
+    const double ln2 = std::log(2.0);
+    auto bits = static_cast<size_t>(std::ceil(-n * std::log(p) / (ln2 * ln2)));
+    size_t blocks = std::max<size_t>((bits + BLOCK_BITS - 1) / BLOCK_BITS, 1);
+    words_.assign(blocks * WORDS_PER_BLOCK, 0);
+    double perKey = static_cast<double>(bitCount()) / n;
+    hashCount_ = static_cast<unsigned>(std::clamp(std::lround(perKey * ln2), 1L, static_cast<long>(MAX_HASHES)));
+}
+
+// The block comes from a remix of the key, the bit positions inside it from
+// double hashing over the key's two halves
+void BloomFilter::add(std::uint64_t key) noexcept {
+    if (words_.empty()) return;
+    std::uint64_t* block = words_.data() + (mix(key) % (words_.size() / WORDS_PER_BLOCK)) * WORDS_PER_BLOCK;
+    auto h1 = static_cast<std::uint32_t>(key);
+    auto h2 = static_cast<std::uint32_t>(key >> 32) | 1u;
+    for (unsigned i = 0; i < hashCount_; ++i) {
+        std::uint32_t bit = (h1 + i * h2) & (BLOCK_BITS - 1);
+        block[bit >> 6] |= std::uint64_t{1} << (bit & 63);
+    }
+    ++count_;
+}
+
+bool BloomFilter::mightContain(std::uint64_t key) const noexcept {
+    if (words_.empty()) return false;
+    const std::uint64_t* block = words_.data() + (mix(key) % (words_.size() / WORDS_PER_BLOCK)) * WORDS_PER_BLOCK;
+    auto h1 = static_cast<std::uint32_t>(key);
+    auto h2 = static_cast<std::uint32_t>(key >> 32) | 1u;
+    for (unsigned i = 0; i < hashCount_; ++i) {
+        std::uint32_t bit = (h1 + i * h2) & (BLOCK_BITS - 1);
+        if (!(block[bit >> 6] & (std::uint64_t{1} << (bit & 63)))) return false;
+    }
+    return true;
+}
+
+std::uint64_t BloomFilter::hash(std::string_view text) noexcept {
+    // FNV-1a, finalized so that short keys still spread over all 64 bits
+    std::uint64_t h = 0xCBF29CE484222325ull;
+    for (char c : text) {
+        h = (h ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+    }
+    return mix(h);
+}
+
+std::uint64_t BloomFilter::hash(std::int64_t value) noexcept {
+    return mix(static_cast<std::uint64_t>(value) + 0x9E3779B97F4A7C15ull);
+}
+
+void BloomFilter::write(std::string& out) const {
+    out.reserve(out.size() + ENCODED_HEADER + words_.size() * 8);
+    put<std::uint64_t>(out, capacity_);
+    put<std::uint64_t>(out, count_);
+    put<std::uint32_t>(out, hashCount_);
+    put<std::uint32_t>(out, 0);
+    put<std::uint64_t>(out, words_.size());
+    for (std::uint64_t word : words_) put(out, word);
+}
+
+bool BloomFilter::read(std::string_view& in) {
+    if (in.size() < ENCODED_HEADER) return false;
+    auto capacity = get<std::uint64_t>(in.data());
+    auto count = get<std::uint64_t>(in.data() + 8);
+    auto hashes = get<std::uint32_t>(in.data() + 16);
+    auto words = get<std::uint64_t>(in.data() + 24);
+    if (words % WORDS_PER_BLOCK != 0 || words > (in.size() - ENCODED_HEADER) / 8) return false;
+    if (words != 0 && (hashes == 0 || hashes > MAX_HASHES)) return false;
+
+    words_.resize(static_cast<size_t>(words));
+    const char* at = in.data() + ENCODED_HEADER;
+    for (auto& word : words_) {
+        word = get<std::uint64_t>(at);
+        at += 8;
+    }
+    capacity_ = static_cast<size_t>(capacity);
+    count_ = static_cast<size_t>(count);
+    hashCount_ = hashes;
+    in.remove_prefix(ENCODED_HEADER + static_cast<size_t>(words) * 8);
+    return true;
+}
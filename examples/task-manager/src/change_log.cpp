@@ -0,0 +1,216 @@
+#include "change_log.h"
+#include "footprint.h"
+#include "task_json.h"
+#include "trace.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <stdexcept>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::string_view MAGIC = "TMLOG 1 ";
+// Superseded history allowed beyond twice the snapshot before a rewrite
+constexpr std::uint64_t REWRITE_SLACK = 1 << 20;
+// How far from the end lastLsn() looks for a commit
+constexpr std::uint64_t TAIL_BYTES = 64 * 1024;
+
+template <typename T>
+bool parseNumber(std::string_view& text, T& value) {
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc()) return false;
+    text.remove_prefix(static_cast<size_t>(end - text.data()));
+    if (!text.empty() && text.front() == ' ') text.remove_prefix(1);
+    return true;
+}
+
+void appendCommit(std::string& out, std::uint64_t lsn, int nextId) {
+    out += "C ";
+    out += std::to_string(lsn);
+    out += ' ';
+    out += std::to_string(nextId);
+    out += '\n';
+}
+
+// LSN of the last commit in an existing log: the last "C" line near the end,
+// else the base LSN in the header; 0 without a log
+std::uint64_t lastLsn(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return 0;
+    const auto size = static_cast<std::uint64_t>(in.tellg());
+    const std::uint64_t tail = std::min(size, TAIL_BYTES);
+    std::string data(static_cast<size_t>(tail), '\0');
+    in.seekg(static_cast<std::streamoff>(size - tail));
+    in.read(data.data(), static_cast<std::streamsize>(tail));
+    // Complete lines only: drop a torn last one, and the first one unless it
+    // starts the file
+    size_t end = data.rfind('\n');
+    while (end != std::string::npos && end > 0) {
+        const size_t newline = data.rfind('\n', end - 1);
+        if (newline == std::string::npos && tail < size) break;
+        const size_t start = newline == std::string::npos ? 0 : newline + 1;
+        std::string_view line(data.data() + start, end - start);
+        std::uint64_t lsn = 0;
+        if (line.starts_with("C ")) {
+            line.remove_prefix(2);
+            if (parseNumber(line, lsn)) return lsn;
+        }
+        if (newline == std::string::npos) break;
+        end = newline;
+    }
+    in.clear();
+    in.seekg(0);
+    std::string header;
+    std::getline(in, header);
+    std::string_view base = header;
+    std::uint64_t lsn = 0;
+    if (base.starts_with(MAGIC)) {
+        base.remove_prefix(MAGIC.size());
+        parseNumber(base, lsn);
+    }
+    return lsn;
+}
+
+[[noreturn]] void throwBadRecord(const fs::path& path, std::string_view line) {
+    throw std::runtime_error("Bad change log record in " + path.string() + ": " +
+                             std::string(line.substr(0, std::min<size_t>(line.size(), 60))));
+}
+
+}  // namespace
+
+ChangeLog::ChangeLog(fs::path path) : path_(std::move(path)) {}
+
+void ChangeLog::reset(const std::vector<Task>& tasks, int nextId) {
+    TRACE_SCOPE("ChangeLog::reset");
+    if (lsn_ == 0) lsn_ = lastLsn(path_);
+    const std::uint64_t base = ++lsn_;
+    const auto epoch = std::chrono::system_clock::now().time_since_epoch().count();
+    std::string data(MAGIC);
+    data += std::to_string(base);
+    data += ' ';
+    data += std::to_string(epoch);
+    data += '\n';
+    for (const Task& task : tasks) {
+        data += "P ";
+        TaskJson::writeLine(data, task);
+    }
+    appendCommit(data, base, nextId);
+
+    // Readers must see either the old log or the whole snapshot
+    out_.close();
+    fs::path tmp = path_;
+    tmp += ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        if (!ofs) {
+            throw std::runtime_error("Cannot open file for writing: " + tmp.string());
+        }
+        ofs.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!ofs.flush()) {
+            throw std::runtime_error("Cannot write file: " + tmp.string());
+        }
+    }
+    fs::rename(tmp, path_);
+    out_.open(path_, std::ios::binary | std::ios::app);
+    if (!out_) {
+        throw std::runtime_error("Cannot open file for writing: " + path_.string());
+    }
+    bytes_ = snapshotBytes_ = data.size();
+    pending_.clear();
+}
+
+void ChangeLog::put(const Task& task) {
+    pending_ += "P ";
+    TaskJson::writeLine(pending_, task);
+}
+
+void ChangeLog::remove(int id) {
+    pending_ += "D ";
+    pending_ += std::to_string(id);
+    pending_ += '\n';
+}
+
+std::uint64_t ChangeLog::commit(int nextId) {
+    TRACE_SCOPE("ChangeLog::commit");
+    if (!out_.is_open()) {
+        throw std::runtime_error("Change log not started: " + path_.string());
+    }
+    appendCommit(pending_, ++lsn_, nextId);
+    out_.write(pending_.data(), static_cast<std::streamsize>(pending_.size()));
+    out_.flush();
+    const size_t written = pending_.size();
+    pending_.clear();
+    if (!out_) {
+        out_.clear();
+        throw std::runtime_error("Cannot write file: " + path_.string());
+    }
+    bytes_ += written;
+    return lsn_;
+}
+
+bool ChangeLog::needsRewrite() const { return bytes_ > 2 * snapshotBytes_ + REWRITE_SLACK; }
+
+size_t ChangeLog::memoryBytes() const { return Footprint::of(pending_); }
+
+ChangeLogReader::ChangeLogReader(fs::path path) : path_(std::move(path)) {}
+
+ChangeLogReader::Update ChangeLogReader::read() {
+    TRACE_SCOPE("ChangeLogReader::read");
+    Update update;
+    std::ifstream in(path_, std::ios::binary);
+    std::string header;
+    if (!in || !std::getline(in, header)) return update;
+    if (!header.starts_with(MAGIC)) {
+        throw std::runtime_error("Not a change log: " + path_.string());
+    }
+    if (header != header_) {
+        // A new log (or the first look at one): start over from its snapshot
+        header_ = std::move(header);
+        offset_ = header_.size() + 1;
+        update.restarted = true;
+    }
+    in.seekg(0, std::ios::end);
+    const auto size = static_cast<std::uint64_t>(in.tellg());
+    if (size <= offset_) return update;
+    buffer_.resize(static_cast<size_t>(size - offset_));
+    in.seekg(static_cast<std::streamoff>(offset_));
+    in.read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.resize(static_cast<size_t>(in.gcount()));
+
+    ChangeSet current;
+    size_t consumed = 0;
+    size_t pos = 0;
+    size_t newline;
+    while ((newline = buffer_.find('\n', pos)) != std::string::npos) {
+        std::string_view line(buffer_.data() + pos, newline - pos);
+        pos = newline + 1;
+        if (line.size() < 2 || line[1] != ' ') throwBadRecord(path_, line);
+        const char kind = line[0];
+        std::string_view body = line.substr(2);
+        if (kind == 'P') {
+            try {
+                if (!TaskJson::readLine(body, current.puts)) TaskJson::readLineDom(body, current.puts);
+            } catch (const std::exception&) {
+                throwBadRecord(path_, line);
+            }
+        } else if (kind == 'D') {
+            int id = 0;
+            if (!parseNumber(body, id)) throwBadRecord(path_, line);
+            current.deletes.push_back(id);
+        } else if (kind == 'C') {
+            if (!parseNumber(body, current.lsn) || !parseNumber(body, current.nextId)) throwBadRecord(path_, line);
+            lsn_ = current.lsn;
+            update.sets.push_back(std::move(current));
+            current = ChangeSet();
+            consumed = pos;
+        } else {
+            throwBadRecord(path_, line);
+        }
+    }
+    // Records past the last commit belong to a set still being written
+    offset_ += consumed;
+    return update;
+}
@@ -1,127 +1,511 @@
 #include "cli.h"
+#include "dedupe.h"
+#include "metrics.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
 #include <iostream>
-#include <sstream>
+#include <iterator>
+#include <string>
 #include <stdexcept>
-#include <iomanip>
+#include <utility>
 
-CLI::CLI(Storage& storage) : storage_(storage) {}
+// Active tasks plus archived ones in ID order. A task found in both tiers (an
+// archive run interrupted before the store was saved) shows its active copy.
+static std::vector<Task> mergeById(std::vector<Task> active, std::vector<Task> archived) {
+    auto byId = [](const Task& a, const Task& b) { return a.getId() < b.getId(); };
+    std::sort(active.begin(), active.end(), byId);
+    std::stable_sort(archived.begin(), archived.end(), byId);
+    std::vector<Task> merged;
+    merged.reserve(active.size() + archived.size());
+    auto a = active.begin();
+    for (auto& task : archived) {
+        while (a != active.end() && a->getId() < task.getId()) merged.push_back(std::move(*a++));
+        if (a != active.end() && a->getId() == task.getId()) continue;
+        if (!merged.empty() && merged.back().getId() == task.getId()) continue;
+        merged.push_back(std::move(task));
+    }
+    merged.insert(merged.end(), std::make_move_iterator(a), std::make_move_iterator(active.end()));
+    return merged;
+}
+
+// Commands that change the store (a failed one marks it dirty too, which
+// only costs a redundant write)
+static bool mutates(const Command& cmd) {
+    switch (cmd.id) {
+        case CommandId::Add:
+        case CommandId::Complete:
+        case CommandId::Reopen:
+        case CommandId::Delete:
+        case CommandId::Priority:
+        case CommandId::Due:
+        case CommandId::Tag:
+        case CommandId::Untag:
+        case CommandId::Depend:
+        case CommandId::Undepend:
+        case CommandId::Archive:
+            return !cmd.error;
+        case CommandId::Dedupe:
+            return !cmd.error && cmd.text == "merge";
+        default:
+            return false;
+    }
+}
+
+CLI::CLI(Storage& storage) : storage_(storage), out_(OutputSink::console()), table_(out_) {}
 
 void CLI::showWelcome() const {
-    Utils::printColored("\n================ Task Manager CLI ================\n", Utils::GREEN);
-    Utils::printColored("Welcome! Type ", Utils::GREEN);
-    std::cout << "'help'";
-    Utils::printColored(" for available commands.\n", Utils::GREEN);
-    Utils::printColored("Type 'quit' or 'q' to exit.\n\n", Utils::GREEN);
+    out_.write("\n================ Task Manager CLI ================\n", Utils::GREEN);
+    out_.write("Welcome! Type ", Utils::GREEN);
+    out_.write("'help'");
+    out_.write(" for available commands.\n", Utils::GREEN);
+    out_.write("Type 'quit' or 'q' to exit.\n\n", Utils::GREEN);
 }
 
 void CLI::run() {
-    while (true) {
-        std::string input = getCommand();
-        if (input == "quit" || input == "q") {
-            Utils::printColored("Goodbye!\n", Utils::YELLOW);
-            break;
-        }
-        parseCommand(input);
+    while (parseCommand(getCommand())) {
     }
+    out_.flush();
 }
 
 void CLI::showHelp() const {
-    std::cout << "Commands:\n";
-    std::cout << "  add \"description\"  - Add a new task\n";
-    std::cout << "  list                - List all tasks\n";
-    std::cout << "  complete <id>       - Mark task as completed\n";
-    std::cout << "  delete <id>         - Delete task\n";
-    std::cout << "  help                - Show this help\n";
-    std::cout << "  quit / q            - Exit\n\n";
+    out_.write("Commands:\n");
+    out_.write("  add \"description\"  - Add a new task\n");
+    out_.write("  list [page|all]     - List all tasks (page: one screen at a time, all: include archive)\n");
+    out_.write("  complete <id>       - Mark task as completed\n");
+    out_.write("  reopen <id>         - Mark a completed task as pending again\n");
+    out_.write("  delete <id>         - Delete task\n");
+    out_.write("  priority <id> <0-9> - Set task priority\n");
+    out_.write("  due <id> <date>     - Set due date (YYYY-MM-DD or 'none')\n");
+    out_.write("  tag <id> <tag>      - Add a tag to a task\n");
+    out_.write("  untag <id> <tag>    - Remove a tag from a task\n");
+    out_.write("  depend <id> <id>    - Make the first task wait until the second is completed\n");
+    out_.write("  undepend <id> <id>  - Stop the first task waiting for the second\n");
+    out_.write("  next [n]            - Tasks ready to start, most urgent first (default 10)\n");
+    out_.write("  upcoming [n]        - Next n pending tasks by due date (default 10)\n");
+    out_.write("  tagged <tag>        - List tasks with a tag\n");
+    out_.write("  search <text>       - Find tasks whose description contains text\n");
+    out_.write("  find <text>         - Like search, but also looks through the archive\n");
+    out_.write("  archive [days]      - Archive tasks completed more than days ago (default 30)\n");
+    out_.write("  dedupe [merge]      - Find duplicate and near-duplicate tasks (merge: keep the oldest of each)\n");
+    out_.write("  stats               - Show operation counts, latencies and memory use\n");
+    out_.write("  trace on|off|<file> - Record trace spans / write them as Chrome trace JSON\n");
+    out_.write("  help                - Show this help\n");
+    out_.write("  quit / q            - Exit\n\n");
 }
 
 std::string CLI::getCommand() {
     std::string input;
-    Utils::printColored("> ", Utils::BLUE);
-    std::getline(std::cin, input);
+    out_.write("> ", Utils::BLUE);
+    out_.flush();
+    if (!std::getline(std::cin, input)) {
+        input = "quit";  // End of input (piped/batch mode) ends the session
+    }
     return input;
 }
 
-void CLI::parseCommand(const std::string& input) {
-    std::istringstream iss(input);
-    std::string cmd;
-    iss >> cmd;
+bool CLI::parseCommand(std::string_view input) {
+    TRACE_SCOPE("CLI::parseCommand");
+    Command cmd;
+    {
+        Metrics::ScopedTimer timer(Metrics::Op::Parse);
+        cmd = CommandParser::parse(input);
+    }
+    return runCommand(cmd);
+}
+
+size_t CLI::runPipelined(size_t maxInFlight) {
+    TRACE_SCOPE("CLI::runPipelined");
+    Async::Executor executor;
+    Async::GroupCommit commit(executor, [this] { return storage_.saveJob(); });
+    storage_.setAutoSave(false);
+    out_.setHeld(true);
+    size_t waiting = 0;  // Commands whose reply waits for a write
+    bool reading = true;
+    std::string line;
+    while (reading) {
+        // Completions are only collected when input runs dry or too many
+        // commands wait, so the next write covers everything run until then.
+        // Never block on stdin with a write in flight: an interactive sender
+        // may be waiting for the replies it releases.
+        if (waiting >= maxInFlight || (executor.inFlight() > 0 && std::cin.rdbuf()->in_avail() <= 0)) {
+            executor.wait();
+            out_.flush();
+            continue;
+        }
+        if (!std::getline(std::cin, line)) break;
+        pipelineCommand(std::move(line), commit, waiting, reading);
+    }
+    executor.drain();
+    out_.setHeld(false);
+    storage_.setAutoSave(true);
+    return commit.writes();
+}
 
+// Runs until the command's change (and every earlier one) is written, then
+// releases its reply
+Async::Job CLI::pipelineCommand(std::string line, Async::GroupCommit& commit, size_t& waiting, bool& reading) {
+    TRACE_SCOPE("CLI::pipelineCommand");
+    Command cmd;
+    {
+        Metrics::ScopedTimer timer(Metrics::Op::Parse);
+        cmd = CommandParser::parse(line);
+    }
+    if (!runCommand(cmd)) reading = false;
+    if (mutates(cmd) && !storage_.isReplica()) commit.markDirty();
+    const size_t reply = out_.mark();
+    ++waiting;
     try {
-        if (cmd == "add") {
-            std::string desc;
-            std::getline(iss, desc);
-            if (!desc.empty() && desc[0] == ' ') desc.erase(0, 1);
-            handleAdd(desc);
-        } else if (cmd == "list") {
-            handleList();
-        } else if (cmd == "complete") {
-            int id;
-            iss >> id;
-            handleComplete(id);
-        } else if (cmd == "delete") {
-            int id;
-            iss >> id;
-            handleDelete(id);
-        } else if (cmd == "help") {
-            showHelp();
-        } else {
-            Utils::printColored("Unknown command. Type 'help'.\n", Utils::RED);
+        co_await commit.durable();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: change not saved: " << e.what() << "\n";
+    }
+    --waiting;
+    out_.release(reply);
+}
+
+bool CLI::runCommand(const Command& cmd) {
+    if (cmd.id == CommandId::Quit) {
+        out_.write("Goodbye!\n", Utils::YELLOW);
+        return false;
+    }
+    try {
+        if (cmd.error) {
+            throw std::invalid_argument(cmd.error);
         }
+        // A replica answers from the primary's latest committed changes
+        storage_.catchUp();
+        execute(cmd);
     } catch (const std::exception& e) {
-        Utils::printColored("Error: " + std::string(e.what()) + "\n", Utils::RED);
+        out_.write("Error: " + std::string(e.what()) + "\n", Utils::RED);
+    }
+    return true;
+}
+
+void CLI::execute(const Command& cmd) {
+    switch (cmd.id) {
+        case CommandId::Empty:
+            break;
+        case CommandId::Add:
+            handleAdd(std::string(cmd.text));
+            break;
+        case CommandId::List:
+            if (!cmd.text.empty() && cmd.text != "page" && cmd.text != "all") {
+                throw std::invalid_argument("Usage: list [page|all]");
+            }
+            handleList(cmd.text == "page", cmd.text == "all");
+            break;
+        case CommandId::Complete:
+            handleComplete(cmd.taskId);
+            break;
+        case CommandId::Reopen:
+            handleReopen(cmd.taskId);
+            break;
+        case CommandId::Delete:
+            handleDelete(cmd.taskId);
+            break;
+        case CommandId::Priority:
+            handlePriority(cmd.taskId, cmd.number);
+            break;
+        case CommandId::Due:
+            handleDue(cmd.taskId, cmd.text);
+            break;
+        case CommandId::Tag:
+        case CommandId::Untag:
+            handleTag(cmd.taskId, cmd.text, cmd.id == CommandId::Tag);
+            break;
+        case CommandId::Depend:
+        case CommandId::Undepend:
+            handleDepend(cmd.taskId, cmd.number, cmd.id == CommandId::Depend);
+            break;
+        case CommandId::Next:
+            handleNext(static_cast<size_t>(cmd.number));
+            break;
+        case CommandId::Upcoming:
+            handleUpcoming(static_cast<size_t>(cmd.number));
+            break;
+        case CommandId::Tagged:
+            handleTagged(cmd.text);
+            break;
+        case CommandId::Search:
+            handleSearch(cmd.text);
+            break;
+        case CommandId::Find:
+            handleFind(cmd.text);
+            break;
+        case CommandId::Archive:
+            handleArchive(cmd.number);
+            break;
+        case CommandId::Dedupe:
+            if (!cmd.text.empty() && cmd.text != "merge") {
+                throw std::invalid_argument("Usage: dedupe [merge]");
+            }
+            handleDedupe(cmd.text == "merge");
+            break;
+        case CommandId::Stats:
+            handleStats();
+            break;
+        case CommandId::Trace:
+            handleTrace(cmd.text);
+            break;
+        case CommandId::Help:
+            showHelp();
+            break;
+        case CommandId::Quit:
+        case CommandId::Unknown:
+            out_.write("Unknown command. Type 'help'.\n", Utils::RED);
+            break;
     }
 }
 
-void CLI::handleAdd(const std::string& desc) {
+void CLI::handleAdd(std::string desc) {
     if (desc.empty()) {
         throw std::invalid_argument("Description required");
     }
-    storage_.addTask(desc);
-    Utils::printColored("Task added successfully.\n", Utils::GREEN);
+    bool archived = storage_.isArchivedDescription(desc);
+    storage_.addTask(std::move(desc));
+    out_.write("Task added successfully.\n", Utils::GREEN);
+    if (archived) {
+        out_.write("Note: an archived task has the same description ('find' shows it).\n", Utils::YELLOW);
+    }
 }
 
-void CLI::handleList() {
-    auto tasks = storage_.getAllTasks();
-    if (tasks.empty()) {
-        Utils::printColored("No tasks yet.\n", Utils::YELLOW);
+void CLI::handleList(bool paginate, bool includeArchive) {
+    if (!includeArchive) {
+        const auto& tasks = storage_.getAllTasks();
+        if (tasks.empty()) {
+            out_.write("No tasks yet.\n", Utils::YELLOW);
+            return;
+        }
+        printTasks(tasks, "TASKS", paginate);
         return;
     }
-    
-    const int width = 70;
-    std::string border(width, '=');
-    std::string sep(width, '-');
-    
-    std::cout << border << "\n";
-    std::cout << "| " << std::setw(width-4) << std::left << "TASKS" << " |\n";
-    std::cout << sep << "\n";
-    
-    for (const auto& task : tasks) {
-        std::string status = task.isCompleted() ? "[C]" : "[P]";
-        std::stringstream line;
-        line << "| #" << std::setw(3) << std::right << task.getId() << " " << status << " " << std::left << task.getDescription();
-        std::string output = line.str();
-        if ((int)output.size() > width - 1) {
-            output = output.substr(0, width - 4) + "... |";
-        } else {
-            output += std::string(width - 1 - output.size(), ' ') + "|";
-        }
-        std::cout << output << "\n";
+    auto tasks = mergeById(storage_.getAllTasks(), storage_.getArchivedTasks());
+    if (tasks.empty()) {
+        out_.write("No tasks yet.\n", Utils::YELLOW);
+        return;
     }
-    
-    std::cout << sep << "\n";
-    std::string legend = "| [P]=Pending [C]=Completed";
-    legend += std::string(width - legend.size() - 1, ' ') + "|";
-    std::cout << legend << "\n";
-    std::cout << border << "\n";
+    printTasks(tasks, "TASKS (WITH ARCHIVE)");
 }
 
+void CLI::printTasks(const std::vector<Task>& tasks, std::string_view title, bool paginate) {
+    table_.render(tasks, title, paginate);
+}
+
+void CLI::printTasks(const std::vector<const Task*>& tasks, std::string_view title) { table_.render(tasks, title); }
+
 void CLI::handleComplete(int id) {
     storage_.completeTask(id);
-    Utils::printColored("Task " + std::to_string(id) + " completed.\n", Utils::GREEN);
+    out_.write("Task " + std::to_string(id) + " completed.\n", Utils::GREEN);
+}
+
+void CLI::handleReopen(int id) {
+    storage_.reopenTask(id);
+    out_.write("Task " + std::to_string(id) + " reopened.\n", Utils::GREEN);
 }
 
 void CLI::handleDelete(int id) {
     storage_.deleteTask(id);
-    Utils::printColored("Task " + std::to_string(id) + " deleted.\n", Utils::GREEN);
-}
\ No newline at end of file
+    out_.write("Task " + std::to_string(id) + " deleted.\n", Utils::GREEN);
+}
+
+void CLI::handlePriority(int id, int priority) {
+    storage_.setPriority(id, priority);
+    out_.write("Task " + std::to_string(id) + " priority set to " + std::to_string(priority) + ".\n", Utils::GREEN);
+}
+
+void CLI::handleDue(int id, std::string_view date) {
+    std::int64_t due = Task::NO_DUE;
+    if (date != "none" && !Utils::parseDate(date, due)) {
+        throw std::invalid_argument("Date must be YYYY-MM-DD or 'none'");
+    }
+    // The epoch itself is how every store format spells "no due date"
+    if (date != "none" && due == Task::NO_DUE) {
+        throw std::invalid_argument("Due dates start at 1970-01-02");
+    }
+    storage_.setDue(id, due);
+    out_.write("Task " + std::to_string(id) + " due date " +
+                        (due == Task::NO_DUE ? std::string("cleared") : "set to " + std::string(date)) + ".\n", Utils::GREEN);
+}
+
+void CLI::handleTag(int id, std::string_view tagName, bool add) {
+    if (tagName.empty()) {
+        throw std::invalid_argument("Tag required");
+    }
+    std::string tag(tagName);
+    if (add) {
+        storage_.addTag(id, tag);
+        out_.write("Task " + std::to_string(id) + " tagged '" + tag + "'.\n", Utils::GREEN);
+    } else {
+        storage_.removeTag(id, tag);
+        out_.write("Task " + std::to_string(id) + " untagged '" + tag + "'.\n", Utils::GREEN);
+    }
+}
+
+void CLI::handleDepend(int id, int blocker, bool add) {
+    if (add) {
+        storage_.addDependency(id, blocker);
+        out_.write("Task " + std::to_string(id) + " now waits for task " + std::to_string(blocker) + ".\n", Utils::GREEN);
+    } else {
+        storage_.removeDependency(id, blocker);
+        out_.write("Task " + std::to_string(id) + " no longer waits for task " + std::to_string(blocker) + ".\n",
+                   Utils::GREEN);
+    }
+}
+
+void CLI::handleNext(size_t limit) {
+    auto tasks = storage_.getReady(limit);
+    if (tasks.empty()) {
+        out_.write("No tasks ready to start.\n", Utils::YELLOW);
+        return;
+    }
+    printTasks(tasks, "NEXT");
+}
+
+void CLI::handleUpcoming(size_t limit) {
+    auto tasks = storage_.getUpcoming(limit);
+    if (tasks.empty()) {
+        out_.write("No pending tasks with a due date.\n", Utils::YELLOW);
+        return;
+    }
+    printTasks(tasks, "UPCOMING");
+}
+
+void CLI::handleTagged(std::string_view tagName) {
+    if (tagName.empty()) {
+        throw std::invalid_argument("Tag required");
+    }
+    std::string tag(tagName);
+    auto tasks = storage_.getTasksByTag(tag);
+    if (tasks.empty()) {
+        out_.write("No tasks tagged '" + tag + "'.\n", Utils::YELLOW);
+        return;
+    }
+    printTasks(tasks, "TAGGED: " + tag);
+}
+
+void CLI::handleSearch(std::string_view text) {
+    if (text.empty()) {
+        throw std::invalid_argument("Search text required");
+    }
+    auto matches = storage_.filter([text](const Task& task) { return Utils::containsIgnoreCase(task.getDescription(), text); });
+    if (matches.empty()) {
+        out_.write("No tasks match '" + std::string(text) + "'.\n", Utils::YELLOW);
+        return;
+    }
+    printTasks(matches, "SEARCH: " + std::string(text));
+}
+
+void CLI::handleFind(std::string_view text) {
+    if (text.empty()) {
+        throw std::invalid_argument("Search text required");
+    }
+    auto matches = [text](const Task& task) { return Utils::containsIgnoreCase(task.getDescription(), text); };
+    auto tasks = mergeById(storage_.filter(matches), storage_.searchArchive(matches));
+    if (tasks.empty()) {
+        out_.write("No tasks or archived tasks match '" + std::string(text) + "'.\n", Utils::YELLOW);
+        return;
+    }
+    printTasks(tasks, "FIND: " + std::string(text));
+}
+
+void CLI::handleArchive(int days) {
+    const std::int64_t cutoff = static_cast<std::int64_t>(std::time(nullptr)) - std::int64_t{days} * 86400;
+    size_t moved = storage_.archiveCompleted(cutoff);
+    if (moved == 0) {
+        out_.write("No tasks completed more than " + std::to_string(days) + " days ago.\n", Utils::YELLOW);
+        return;
+    }
+    out_.write("Archived " + std::to_string(moved) + " task(s) to " + storage_.archivePath().string() + ".\n",
+                        Utils::GREEN);
+}
+
+void CLI::handleDedupe(bool merge) {
+    auto groups = Dedupe::findGroups(storage_.getAllTasks());
+    if (groups.empty()) {
+        out_.write("No duplicate tasks found.\n", Utils::YELLOW);
+        return;
+    }
+    const size_t shown = 20;
+    size_t duplicates = 0;
+    size_t exactGroups = 0;
+    for (size_t i = 0; i < groups.size(); ++i) {
+        const auto& group = groups[i];
+        duplicates += group.ids.size() - 1;
+        if (group.exact) ++exactGroups;
+        if (i >= shown) continue;
+        std::string ids;
+        for (int id : group.ids) {
+            if (ids.size() > 24) {
+                ids += " ...";
+                break;
+            }
+            ids += (ids.empty() ? "#" : " #") + std::to_string(id);
+        }
+        std::string desc(storage_.findTaskById(group.ids.front()).getDescription());
+        if (desc.size() > 40) desc = desc.substr(0, 37) + "...";
+        out_.write("  ");
+        out_.write(group.exact ? "exact  " : "similar");
+        out_.write("  ");
+        out_.write(ids);
+        out_.fill(ids.size() < 28 ? 28 - ids.size() : 1, ' ');
+        out_.write(desc);
+        out_.write('\n');
+    }
+    if (groups.size() > shown) {
+        out_.write("  ... and " + std::to_string(groups.size() - shown) + " more groups\n");
+    }
+    out_.write(std::to_string(groups.size()) + " groups (" + std::to_string(exactGroups) + " exact, " +
+               std::to_string(groups.size() - exactGroups) + " similar), " + std::to_string(duplicates) +
+               " duplicate tasks.\n");
+    if (!merge) {
+        out_.write("Run 'dedupe merge' to merge each group into its oldest task.\n");
+        return;
+    }
+    if (!Utils::confirm("Merge " + std::to_string(duplicates) + " duplicate tasks into " + std::to_string(groups.size()) +
+                        " tasks?")) {
+        return;
+    }
+    std::vector<std::vector<int>> ids;
+    ids.reserve(groups.size());
+    for (auto& group : groups) ids.push_back(std::move(group.ids));
+    size_t removed = storage_.mergeTasks(ids);
+    out_.write("Merged " + std::to_string(removed) + " duplicate tasks.\n", Utils::GREEN);
+}
+
+void CLI::handleStats() const {
+    if (!Metrics::enabled()) {
+        out_.write("Metrics are disabled (TM_METRICS=0).\n", Utils::YELLOW);
+    } else {
+        out_.write(Metrics::summary());
+    }
+    const auto usage = storage_.memoryUsage();
+    const size_t budget = storage_.memoryBudget();
+    const std::pair<const char*, std::string> rows[] = {
+        {"tasks", Utils::formatBytes(usage.tasks)},     {"strings", Utils::formatBytes(usage.strings)},
+        {"indexes", Utils::formatBytes(usage.indexes)}, {"caches", Utils::formatBytes(usage.caches)},
+        {"total", Utils::formatBytes(usage.total())},   {"budget", budget ? Utils::formatBytes(budget) : "none"},
+    };
+    char line[64];
+    std::snprintf(line, sizeof(line), "\n%-10s %12s\n", "Memory", "Heap");
+    out_.write(line);
+    for (const auto& [name, value] : rows) {
+        std::snprintf(line, sizeof(line), "%-10s %12s\n", name, value.c_str());
+        out_.write(line);
+    }
+}
+
+void CLI::handleTrace(std::string_view action) {
+    if (action.empty()) {
+        throw std::invalid_argument("Usage: trace on|off|<file>");
+    }
+    if (action == "on" || action == "off") {
+        Trace::setEnabled(action == "on");
+        out_.write(std::string("Tracing ") + (action == "on" ? "enabled" : "disabled") + ".\n", Utils::GREEN);
+        return;
+    }
+    size_t spans = Trace::eventCount();
+    Trace::writeChromeJson(std::string(action));
+    out_.write("Wrote " + std::to_string(spans) + " spans to " + std::string(action) + ".\n", Utils::GREEN);
+}
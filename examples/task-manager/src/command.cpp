@@ -0,0 +1,112 @@
+#include "command.h"
+#include <charconv>
+
+namespace CommandParser {
+
+static constexpr std::string_view WHITESPACE = " \t\r\n";
+
+static std::string_view trimLeft(std::string_view s) noexcept {
+    size_t first = s.find_first_not_of(WHITESPACE);
+    return first == std::string_view::npos ? std::string_view{} : s.substr(first);
+}
+
+static std::string_view trimRight(std::string_view s) noexcept {
+    size_t last = s.find_last_not_of(WHITESPACE);
+    return last == std::string_view::npos ? std::string_view{} : s.substr(0, last + 1);
+}
+
+std::string_view nextToken(std::string_view& rest) noexcept {
+    rest = trimLeft(rest);
+    size_t end = rest.find_first_of(WHITESPACE);
+    std::string_view token = rest.substr(0, end);
+    rest = end == std::string_view::npos ? std::string_view{} : rest.substr(end);
+    return token;
+}
+
+static bool parseInt(std::string_view token, int& value) noexcept {
+    if (token.empty()) return false;
+    auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+    return ec == std::errc() && ptr == token.data() + token.size();
+}
+
+Command parse(std::string_view input) noexcept {
+    Command cmd;
+    std::string_view rest = input;
+    std::string_view word = nextToken(rest);
+    if (word.empty()) return cmd;
+
+    cmd.id = lookup(word);
+    switch (cmd.id) {
+        case CommandId::Add:
+        case CommandId::Search:
+        case CommandId::Find:
+            cmd.text = trimRight(trimLeft(rest));
+            break;
+
+        case CommandId::Complete:
+        case CommandId::Reopen:
+        case CommandId::Delete:
+            if (!parseInt(nextToken(rest), cmd.taskId)) cmd.error = "Task ID must be a number";
+            break;
+
+        case CommandId::Priority:
+            if (!parseInt(nextToken(rest), cmd.taskId)) {
+                cmd.error = "Task ID must be a number";
+            } else if (!parseInt(nextToken(rest), cmd.number)) {
+                cmd.error = "Priority must be a number";
+            }
+            break;
+
+        case CommandId::Depend:
+        case CommandId::Undepend:
+            if (!parseInt(nextToken(rest), cmd.taskId)) {
+                cmd.error = "Task ID must be a number";
+            } else if (!parseInt(nextToken(rest), cmd.number)) {
+                cmd.error = "Blocker must be a task ID";
+            }
+            break;
+
+        case CommandId::Due:
+        case CommandId::Tag:
+        case CommandId::Untag:
+            if (!parseInt(nextToken(rest), cmd.taskId)) cmd.error = "Task ID must be a number";
+            cmd.text = nextToken(rest);
+            break;
+
+        case CommandId::Upcoming:
+        case CommandId::Next: {
+            std::string_view limit = nextToken(rest);
+            cmd.number = 10;
+            if (!limit.empty() && (!parseInt(limit, cmd.number) || cmd.number < 0)) {
+                cmd.error = "Limit must be a non-negative number";
+            }
+            break;
+        }
+
+        case CommandId::Archive: {
+            std::string_view days = nextToken(rest);
+            cmd.number = 30;
+            if (!days.empty() && (!parseInt(days, cmd.number) || cmd.number < 0)) {
+                cmd.error = "Age must be a non-negative number of days";
+            }
+            break;
+        }
+
+        case CommandId::List:
+        case CommandId::Dedupe:
+        case CommandId::Tagged:
+        case CommandId::Trace:
+            cmd.text = nextToken(rest);
+            break;
+
+        case CommandId::Empty:
+        case CommandId::Unknown:
+        case CommandId::Stats:
+        case CommandId::Help:
+        case CommandId::Quit:
+            break;
+    }
+    return cmd;
+}
+
+}  // namespace CommandParser
@@ -0,0 +1,145 @@
+#include "completion_bits.h"
+#include "footprint.h"
+#include <thread>
+
+namespace {
+
+constexpr std::uint64_t LIVE = 1;
+constexpr std::uint64_t COMPLETED = 2;
+
+unsigned shiftOf(int id) noexcept { return static_cast<unsigned>(id % 32) * 2; }
+
+CompletionBits::State decode(std::uint64_t word, int id) noexcept {
+    const std::uint64_t bits = word >> shiftOf(id);
+    if (!(bits & LIVE)) return CompletionBits::State::Missing;
+    return bits & COMPLETED ? CompletionBits::State::Completed : CompletionBits::State::Pending;
+}
+
+}  // namespace
+
+CompletionBits::~CompletionBits() {
+    for (auto& slot : top_) {
+        Middle* middle = slot.load(std::memory_order_relaxed);
+        if (!middle) continue;
+        for (auto& segment : middle->segments) delete segment.load(std::memory_order_relaxed);
+        delete middle;
+    }
+}
+
+CompletionBits::Segment* CompletionBits::findSegment(size_t segment) const noexcept {
+    const Middle* middle = top_[segment >> MIDDLE_SHIFT].load(std::memory_order_acquire);
+    return middle ? middle->segments[segment & (MIDDLE_SIZE - 1)].load(std::memory_order_acquire) : nullptr;
+}
+
+CompletionBits::Segment& CompletionBits::makeSegment(size_t segment) {
+    auto& middleSlot = top_[segment >> MIDDLE_SHIFT];
+    Middle* middle = middleSlot.load(std::memory_order_relaxed);
+    if (!middle) {
+        middle = new Middle{};
+        middleSlot.store(middle, std::memory_order_release);
+        ++middles_;
+    }
+    auto& segmentSlot = middle->segments[segment & (MIDDLE_SIZE - 1)];
+    Segment* words = segmentSlot.load(std::memory_order_relaxed);
+    if (!words) {
+        words = new Segment{};
+        segmentSlot.store(words, std::memory_order_release);
+        ++segments_;
+    }
+    return *words;
+}
+
+std::atomic<std::uint64_t>* CompletionBits::findWord(int id) const noexcept {
+    if (id < 0) return nullptr;
+    const auto index = static_cast<size_t>(id);
+    Segment* segment = findSegment(index >> SEGMENT_SHIFT);
+    return segment ? &segment->words[(index & (SEGMENT_IDS - 1)) / IDS_PER_WORD] : nullptr;
+}
+
+CompletionBits::State CompletionBits::state(int id) const noexcept {
+    const auto* word = findWord(id);
+    return word ? decode(word->load(std::memory_order_acquire), id) : State::Missing;
+}
+
+void CompletionBits::snapshot(std::span<const int> ids, std::vector<State>& out) const {
+    out.resize(ids.size());
+    while (true) {
+        const std::uint64_t before = sequence_.load(std::memory_order_acquire);
+        if (!(before & 1)) {
+            for (size_t i = 0; i < ids.size(); ++i) {
+                const auto* word = findWord(ids[i]);
+                out[i] = word ? decode(word->load(std::memory_order_relaxed), ids[i]) : State::Missing;
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence_.load(std::memory_order_relaxed) == before) return;
+        }
+        // The writer may need this core to finish
+        std::this_thread::yield();
+    }
+}
+
+void CompletionBits::beginWrite() noexcept {
+    sequence_.store(sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void CompletionBits::endWrite() noexcept {
+    sequence_.store(sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void CompletionBits::set(int id, bool completed) {
+    const auto index = static_cast<size_t>(id);
+    auto& target = makeSegment(index >> SEGMENT_SHIFT).words[(index & (SEGMENT_IDS - 1)) / IDS_PER_WORD];
+    const unsigned shift = shiftOf(id);
+    const std::uint64_t bits = (LIVE | (completed ? COMPLETED : 0)) << shift;
+    beginWrite();
+    target.store((target.load(std::memory_order_relaxed) & ~(std::uint64_t{3} << shift)) | bits,
+                 std::memory_order_relaxed);
+    endWrite();
+}
+
+void CompletionBits::clear(int id) {
+    auto* target = findWord(id);
+    if (!target) return;
+    beginWrite();
+    target->store(target->load(std::memory_order_relaxed) & ~(std::uint64_t{3} << shiftOf(id)), std::memory_order_relaxed);
+    endWrite();
+}
+
+void CompletionBits::assign(const std::vector<Task>& tasks) {
+    constexpr size_t MIDDLE_IDS = SEGMENT_IDS << MIDDLE_SHIFT;
+    auto idAt = [&](size_t i) { return static_cast<size_t>(tasks[i].getId()); };
+    size_t next = 0;
+    while (next < tasks.size() && tasks[next].getId() < 0) ++next;
+    beginWrite();
+    // Every allocated segment (to clear what is gone) and every one a task needs
+    for (size_t t = 0; t < TOP_SIZE; ++t) {
+        const bool tasksHere = next < tasks.size() && idAt(next) < (t + 1) * MIDDLE_IDS;
+        if (!tasksHere && !top_[t].load(std::memory_order_relaxed)) continue;
+        for (size_t m = 0; m < MIDDLE_SIZE; ++m) {
+            const size_t index = (t << MIDDLE_SHIFT) + m;
+            const size_t first = index * SEGMENT_IDS;
+            Segment* segment = findSegment(index);
+            if (!segment) {
+                if (next == tasks.size() || idAt(next) >= first + SEGMENT_IDS) continue;
+                segment = &makeSegment(index);
+            }
+            for (size_t w = 0; w < SEGMENT_WORDS; ++w) {
+                const size_t end = first + (w + 1) * IDS_PER_WORD;
+                std::uint64_t value = 0;
+                for (; next < tasks.size() && idAt(next) < end; ++next) {
+                    const int id = tasks[next].getId();
+                    value |= (LIVE | (tasks[next].isCompleted() ? COMPLETED : 0)) << shiftOf(id);
+                }
+                auto& target = segment->words[w];
+                if (target.load(std::memory_order_relaxed) != value) target.store(value, std::memory_order_relaxed);
+            }
+        }
+    }
+    endWrite();
+}
+
+size_t CompletionBits::memoryBytes() const {
+    return Footprint::block(sizeof(CompletionBits)) + middles_ * Footprint::block(sizeof(Middle)) +
+           segments_ * Footprint::block(sizeof(Segment));
+}
@@ -0,0 +1,328 @@
+#include "dedupe.h"
+#include "parallel.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <utility>
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#  define TM_DEDUPE_AVX2 1
+#endif
+
+namespace Dedupe {
+
+namespace {
+
+// 16 bands of 6 rows: texts with Jaccard similarity s share a bucket in at
+// least one band with probability 1 - (1 - s^6)^16, about 0.99 at s = 0.8 and
+// 0.01 at s = 0.3. Candidates are verified exactly, so extra bands only cost time.
+constexpr size_t BANDS = 16;
+constexpr size_t ROWS = 6;
+constexpr size_t SIGNATURE = BANDS * ROWS;
+
+// splitmix64 finalizer
+std::uint64_t mix(std::uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+std::uint64_t hashBytes(std::string_view bytes) {
+    std::uint64_t h = 0xCBF29CE484222325ull;
+    for (char c : bytes) h = (h ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+    return mix(h);
+}
+
+// Room needed for the shingles of a text of the given length
+size_t shingleBound(size_t length, size_t k) { return length > k ? length - k + 1 : 1; }
+
+// Write the sorted, unique 32-bit hashes of the k-character shingles of a
+// normalized text to out (shingleBound() entries) and return their number.
+// Texts shorter than one shingle are a single shingle.
+size_t shingles(std::string_view text, size_t k, std::uint32_t* out) {
+    if (text.size() <= k) {
+        out[0] = static_cast<std::uint32_t>(hashBytes(text));
+        return 1;
+    }
+    size_t count = text.size() - k + 1;
+    for (size_t i = 0; i < count; ++i) out[i] = static_cast<std::uint32_t>(hashBytes(text.substr(i, k)));
+    std::sort(out, out + count);
+    return static_cast<size_t>(std::unique(out, out + count) - out);
+}
+
+double jaccard(std::span<const std::uint32_t> a, std::span<const std::uint32_t> b) {
+    size_t common = 0;
+    for (size_t i = 0, j = 0; i < a.size() && j < b.size();) {
+        if (a[i] < b[j]) {
+            ++i;
+        } else if (b[j] < a[i]) {
+            ++j;
+        } else {
+            ++common;
+            ++i;
+            ++j;
+        }
+    }
+    size_t total = a.size() + b.size() - common;
+    return total ? static_cast<double>(common) / static_cast<double>(total) : 1.0;
+}
+
+// jaccard(a, b) >= threshold, without finishing the merge once the shingles
+// left cannot bring the overlap up to it (most LSH candidates are far below).
+// The merge steps without branches on the comparisons.
+bool similarEnough(std::span<const std::uint32_t> a, std::span<const std::uint32_t> b, double threshold) {
+    const size_t total = a.size() + b.size();
+    auto enough = [&](size_t common) {
+        return static_cast<double>(common) >= threshold * static_cast<double>(total - common);
+    };
+    // Fewest shared shingles that reach the threshold; the ratio rises with common
+    size_t need = 0;
+    while (need <= std::min(a.size(), b.size()) && !enough(need)) ++need;
+    if (need > std::min(a.size(), b.size())) return false;
+    size_t common = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (common + std::min(a.size() - i, b.size() - j) < need) return false;
+        const std::uint32_t x = a[i];
+        const std::uint32_t y = b[j];
+        common += x == y;
+        i += x <= y;
+        j += y <= x;
+    }
+    return common >= need;
+}
+
+// MinHash signature: row g is the minimum of h1 + g * h2 (32-bit) over the
+// shingles, where h1 and h2 are the halves of a remix of the shingle hash.
+// Written without a loop-carried dependency so the row loop vectorizes.
+__attribute__((always_inline)) inline void signatureRows(std::span<const std::uint32_t> shingleHashes,
+                                                         std::uint32_t* mins) {
+    std::fill(mins, mins + SIGNATURE, ~std::uint32_t{0});
+    for (std::uint32_t shingle : shingleHashes) {
+        std::uint64_t h = mix(shingle);
+        auto h1 = static_cast<std::uint32_t>(h);
+        auto h2 = static_cast<std::uint32_t>(h >> 32) | 1u;
+        for (std::uint32_t g = 0; g < SIGNATURE; ++g) mins[g] = std::min(mins[g], h1 + g * h2);
+    }
+}
+
+#ifdef TM_DEDUPE_AVX2
+// Eight rows per instruction (vpmulld / vpminud); SSE2 has neither
+__attribute__((target("avx2"))) void signatureAvx2(std::span<const std::uint32_t> shingleHashes, std::uint32_t* mins) {
+    signatureRows(shingleHashes, mins);
+}
+#endif
+
+void signature(std::span<const std::uint32_t> shingleHashes, std::uint32_t* mins) {
+#ifdef TM_DEDUPE_AVX2
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2) {
+        signatureAvx2(shingleHashes, mins);
+        return;
+    }
+#endif
+    signatureRows(shingleHashes, mins);
+}
+
+// Bucket key of one band: its ROWS signature values folded together. Keys are
+// 32 bits to halve memory; chance collisions fail verification.
+std::uint32_t bandKey(const std::uint32_t* mins, size_t band) {
+    std::uint64_t key = mix(band + 1);
+    for (size_t r = 0; r < ROWS; ++r) key = mix(key ^ mins[band * ROWS + r]);
+    return static_cast<std::uint32_t>(key);
+}
+
+// Stable LSD radix sort on the high 32 bits, 8 bits per pass
+void sortByHigh32(std::vector<std::uint64_t>& values, std::vector<std::uint64_t>& scratch) {
+    scratch.resize(values.size());
+    for (unsigned shift = 32; shift < 64; shift += 8) {
+        size_t counts[257] = {};
+        for (std::uint64_t v : values) ++counts[((v >> shift) & 0xFF) + 1];
+        for (size_t b = 1; b < 257; ++b) counts[b] += counts[b - 1];
+        for (std::uint64_t v : values) scratch[counts[(v >> shift) & 0xFF]++] = v;
+        values.swap(scratch);
+    }
+}
+
+class UnionFind {
+public:
+    explicit UnionFind(size_t n) : parent_(n) { std::iota(parent_.begin(), parent_.end(), std::uint32_t{0}); }
+
+    std::uint32_t find(std::uint32_t x) {
+        while (parent_[x] != x) {
+            parent_[x] = parent_[parent_[x]];  // Path halving
+            x = parent_[x];
+        }
+        return x;
+    }
+
+    // The smaller root wins, so a set's root is its lowest member
+    void unite(std::uint32_t a, std::uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return;
+        if (b < a) std::swap(a, b);
+        parent_[b] = a;
+    }
+
+private:
+    std::vector<std::uint32_t> parent_;
+};
+
+}  // namespace
+
+std::string normalize(std::string_view text) {
+    std::string out;
+    out.reserve(text.size());
+    bool space = false;
+    for (char c : text) {
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            space = !out.empty();
+            continue;
+        }
+        if (space) out += ' ';
+        space = false;
+        out += (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+    return out;
+}
+
+double similarity(std::string_view a, std::string_view b, size_t shingle) {
+    const size_t k = std::max<size_t>(shingle, 1);
+    std::string na = normalize(a);
+    std::string nb = normalize(b);
+    std::vector<std::uint32_t> sa(shingleBound(na.size(), k));
+    std::vector<std::uint32_t> sb(shingleBound(nb.size(), k));
+    sa.resize(shingles(na, k, sa.data()));
+    sb.resize(shingles(nb, k, sb.data()));
+    return jaccard(sa, sb);
+}
+
+std::vector<Group> findGroups(const std::vector<Task>& tasks, const Options& options) {
+    TRACE_SCOPE("Dedupe::findGroups");
+    const size_t n = tasks.size();
+    const size_t k = std::max<size_t>(options.shingle, 1);
+
+    // Exact duplicates: sort (hash, task index) so equal texts are adjacent;
+    // hash ties fall back to comparing the text, then the ID, so each run of
+    // one text starts with its oldest task
+    std::vector<std::string> texts(n);
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> order(n);
+    Parallel::forRange(n, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            texts[i] = normalize(tasks[i].getDescription());
+            order[i] = {hashBytes(texts[i]), static_cast<std::uint32_t>(i)};
+        }
+    });
+    std::sort(order.begin(), order.end(), [&](const auto& a, const auto& b) {
+        if (a.first != b.first) return a.first < b.first;
+        if (int c = texts[a.second].compare(texts[b.second]); c != 0) return c < 0;
+        return tasks[a.second].getId() < tasks[b.second].getId();
+    });
+    std::vector<std::uint32_t> distinct;   // Task index of each distinct text's oldest task
+    std::vector<std::uint32_t> textOf(n);  // Task index -> distinct text
+    for (size_t i = 0; i < n; ++i) {
+        std::uint32_t t = order[i].second;
+        if (i == 0 || order[i].first != order[i - 1].first || texts[t] != texts[order[i - 1].second]) {
+            distinct.push_back(t);
+        }
+        textOf[t] = static_cast<std::uint32_t>(distinct.size() - 1);
+    }
+    order = {};
+
+    UnionFind sets(distinct.size());
+    if (options.nearDuplicates && distinct.size() > 1) {
+        // Near duplicates: LSH over the distinct texts. Each text is shingled
+        // once into a flat array (kept for verification) and reduced to one
+        // signature, from which the keys of all bands are taken. Each band is
+        // then bucketed as its own chunk of work; within a bucket every member
+        // is verified against the first, and other bands plus union-find
+        // close the remaining gaps.
+        const size_t m = distinct.size();
+        std::vector<size_t> offsets(m + 1, 0);
+        for (size_t d = 0; d < m; ++d) offsets[d + 1] = offsets[d] + shingleBound(texts[distinct[d]].size(), k);
+        std::vector<std::uint32_t> flat(offsets[m]);
+        std::vector<std::uint32_t> counts(m);
+        std::vector<std::uint32_t> keys(m * BANDS);
+        Parallel::forRange(m, [&](size_t begin, size_t end) {
+            std::uint32_t mins[SIGNATURE];
+            for (size_t d = begin; d < end; ++d) {
+                size_t count = shingles(texts[distinct[d]], k, flat.data() + offsets[d]);
+                counts[d] = static_cast<std::uint32_t>(count);
+                signature({flat.data() + offsets[d], count}, mins);
+                for (size_t band = 0; band < BANDS; ++band) keys[d * BANDS + band] = bandKey(mins, band);
+            }
+        });
+        auto shinglesOf = [&](size_t d) { return std::span<const std::uint32_t>(flat.data() + offsets[d], counts[d]); };
+
+        std::vector<std::vector<std::pair<std::uint32_t, std::uint32_t>>> matches(BANDS);
+        Parallel::runChunks(BANDS, [&](size_t band) {
+            TRACE_SCOPE("Dedupe band");
+            // (key << 32 | text) sorted by key, texts ascending within a bucket
+            std::vector<std::uint64_t> buckets(m);
+            std::vector<std::uint64_t> scratch;
+            for (size_t d = 0; d < m; ++d) buckets[d] = std::uint64_t{keys[d * BANDS + band]} << 32 | d;
+            sortByHigh32(buckets, scratch);
+            for (size_t begin = 0; begin < m;) {
+                size_t end = begin + 1;
+                while (end < m && (buckets[end] >> 32) == (buckets[begin] >> 32)) ++end;
+                auto leader = static_cast<std::uint32_t>(buckets[begin]);
+                for (size_t i = begin + 1; i < end; ++i) {
+                    // Members are scattered over the shingle array: fetch ahead
+                    if (i + 8 < end) {
+                        const auto ahead = static_cast<std::uint32_t>(buckets[i + 8]);
+                        __builtin_prefetch(&offsets[ahead]);
+                        __builtin_prefetch(&counts[ahead]);
+                    }
+                    if (i + 4 < end) {
+                        const std::uint32_t* ahead = flat.data() + offsets[static_cast<std::uint32_t>(buckets[i + 4])];
+                        __builtin_prefetch(ahead);
+                        __builtin_prefetch(ahead + 16);
+                    }
+                    auto other = static_cast<std::uint32_t>(buckets[i]);
+                    // Jaccard similarity can be no higher than the ratio of the set sizes
+                    auto [low, high] = std::minmax(counts[leader], counts[other]);
+                    if (static_cast<double>(low) < options.threshold * static_cast<double>(high)) continue;
+                    if (similarEnough(shinglesOf(leader), shinglesOf(other), options.threshold)) {
+                        matches[band].emplace_back(leader, other);
+                    }
+                }
+                begin = end;
+            }
+        });
+        for (const auto& pairs : matches) {
+            for (auto [a, b] : pairs) sets.unite(a, b);
+        }
+    }
+
+    // Collect the tasks of every set with two or more members. A set is
+    // identified by its root, the lowest-numbered distinct text in it.
+    std::vector<std::uint32_t> sizes(distinct.size(), 0);
+    std::vector<std::uint32_t> rootOf(n);
+    for (size_t i = 0; i < n; ++i) {
+        rootOf[i] = sets.find(textOf[i]);
+        ++sizes[rootOf[i]];
+    }
+    constexpr std::uint32_t NO_GROUP = ~std::uint32_t{0};
+    std::vector<std::uint32_t> groupOf(distinct.size(), NO_GROUP);
+    std::vector<Group> groups;
+    for (size_t i = 0; i < n; ++i) {
+        std::uint32_t root = rootOf[i];
+        if (sizes[root] < 2) continue;
+        if (groupOf[root] == NO_GROUP) {
+            groupOf[root] = static_cast<std::uint32_t>(groups.size());
+            groups.push_back({{}, true});
+            groups.back().ids.reserve(sizes[root]);
+        }
+        Group& group = groups[groupOf[root]];
+        group.ids.push_back(tasks[i].getId());
+        if (textOf[i] != root) group.exact = false;
+    }
+    for (auto& group : groups) std::sort(group.ids.begin(), group.ids.end());
+    std::sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) { return a.ids.front() < b.ids.front(); });
+    return groups;
+}
+
+}  // namespace Dedupe
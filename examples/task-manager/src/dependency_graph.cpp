@@ -0,0 +1,545 @@
+#include "dependency_graph.h"
+#include "footprint.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+
+namespace {
+
+// Side-table edges and holes tolerated before the rows are rebuilt, at least
+constexpr size_t MIN_PENDING_CHANGES = 4096;
+
+// Holes sort after every ID
+bool rowLess(int a, int b) noexcept { return static_cast<unsigned>(a) < static_cast<unsigned>(b); }
+
+template <typename T>
+void put(std::string& out, T value) {
+    if constexpr (std::endian::native == std::endian::big) value = std::byteswap(value);
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+template <typename T>
+T get(const char* at) {
+    T value;
+    std::memcpy(&value, at, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big) value = std::byteswap(value);
+    return value;
+}
+
+size_t index(int id) noexcept { return static_cast<size_t>(id); }
+
+void checkEdge(int blocker, int blocked) {
+    if (blocker < 0 || blocked < 0) throw std::invalid_argument("Invalid task ID");
+    if (blocker == blocked) throw std::invalid_argument("A task cannot wait for itself");
+}
+
+}  // namespace
+
+template <typename Fn>
+void DependencyGraph::forEachDependent(int blocker, Fn fn) const {
+    const size_t b = index(blocker);
+    if (b + 1 < offsets_.size()) {
+        for (size_t i = offsets_[b]; i < offsets_[b + 1] && targets_[i] != HOLE; ++i) fn(targets_[i]);
+    }
+    if (added_.empty()) return;
+    if (auto it = added_.find(blocker); it != added_.end()) {
+        for (int dependent : it->second) fn(dependent);
+    }
+}
+
+bool DependencyGraph::hasEdge(int blocker, int blocked) const {
+    if (blocker < 0) return false;
+    const size_t b = index(blocker);
+    if (b + 1 < offsets_.size()) {
+        const auto first = targets_.begin() + offsets_[b];
+        const auto last = targets_.begin() + offsets_[b + 1];
+        const auto it = std::lower_bound(first, last, blocked, rowLess);
+        if (it != last && *it == blocked) return true;
+    }
+    if (auto it = added_.find(blocker); it != added_.end()) {
+        return std::find(it->second.begin(), it->second.end(), blocked) != it->second.end();
+    }
+    return false;
+}
+
+bool DependencyGraph::addEdge(int blocker, int blocked) {
+    checkEdge(blocker, blocked);
+    if (hasEdge(blocker, blocked)) return false;
+    grow(index(std::max(blocker, blocked)) + 1);
+    if (!reorder(blocker, blocked)) {
+        throw std::runtime_error("Task " + std::to_string(blocker) + " already waits for task " +
+                                 std::to_string(blocked) + ", directly or through other tasks");
+    }
+    added_[blocker].push_back(blocked);
+    ++addedCount_;
+    ++edges_;
+    if (status_[index(blocker)] == PENDING) adjustWaiting(blocked, +1);
+    maybeCompact();
+    return true;
+}
+
+// Without task states no task is known to be deleted, so every edge takes
+// part in the cycle check
+size_t DependencyGraph::addEdges(const std::vector<Edge>& edges) { return addEdges(edges, !tracking()); }
+
+size_t DependencyGraph::addEdges(const std::vector<Edge>& edges, bool everyEdge) {
+    int maxId = -1;
+    for (const auto& [blocker, blocked] : edges) {
+        checkEdge(blocker, blocked);
+        maxId = std::max({maxId, blocker, blocked});
+    }
+    if (edges.empty()) return 0;
+    grow(index(maxId) + 1);
+    // Build the new rows aside, rank them, and only then let go of the old ones
+    const size_t before = edges_;
+    std::vector<std::uint32_t> offsets;
+    std::vector<int> targets;
+    rebuild(edges, false, offsets, targets);
+    std::swap(offsets, offsets_);
+    std::swap(targets, targets_);
+    auto added = std::move(added_);
+    added_.clear();
+    if (!rankAll(everyEdge)) {
+        offsets_ = std::move(offsets);
+        targets_ = std::move(targets);
+        added_ = std::move(added);
+        throw std::runtime_error("These dependencies would form a cycle");
+    }
+    addedCount_ = 0;
+    holes_ = 0;
+    edges_ = targets_.size();
+    recount();
+    return edges_ - before;
+}
+
+bool DependencyGraph::removeEdge(int blocker, int blocked) {
+    if (blocker < 0 || blocked < 0) return false;
+    bool found = false;
+    if (auto it = added_.find(blocker); it != added_.end()) {
+        auto& list = it->second;
+        if (auto at = std::find(list.begin(), list.end(), blocked); at != list.end()) {
+            list.erase(at);
+            if (list.empty()) added_.erase(it);
+            --addedCount_;
+            found = true;
+        }
+    }
+    const size_t b = index(blocker);
+    if (!found && b + 1 < offsets_.size()) {
+        const auto first = targets_.begin() + offsets_[b];
+        const auto last = targets_.begin() + offsets_[b + 1];
+        const auto at = std::lower_bound(first, last, blocked, rowLess);
+        if (at != last && *at == blocked) {
+            // Keep the row sorted: close the gap and leave the hole at its end
+            std::move(at + 1, last, at);
+            *(last - 1) = HOLE;
+            ++holes_;
+            found = true;
+        }
+    }
+    if (!found) return false;
+    --edges_;
+    if (live(blocker) && status_[b] == PENDING) adjustWaiting(blocked, -1);
+    maybeCompact();
+    return true;
+}
+
+void DependencyGraph::clear() {
+    offsets_ = {};
+    targets_ = {};
+    added_ = {};
+    addedCount_ = 0;
+    holes_ = 0;
+    edges_ = 0;
+    recount();
+}
+
+std::vector<int> DependencyGraph::dependents(int blocker) const {
+    std::vector<int> result;
+    if (blocker < 0) return result;
+    forEachDependent(blocker, [&](int dependent) { result.push_back(dependent); });
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<DependencyGraph::Edge> DependencyGraph::edges() const {
+    std::vector<Edge> result;
+    result.reserve(edges_);
+    for (size_t b = 0; b + 1 < offsets_.size(); ++b) {
+        if (!live(static_cast<int>(b))) continue;
+        for (size_t i = offsets_[b]; i < offsets_[b + 1] && targets_[i] != HOLE; ++i) {
+            if (live(targets_[i])) result.emplace_back(static_cast<int>(b), targets_[i]);
+        }
+    }
+    if (!added_.empty()) {
+        for (const auto& [blocker, list] : added_) {
+            if (!live(blocker)) continue;
+            for (int blocked : list) {
+                if (live(blocked)) result.emplace_back(blocker, blocked);
+            }
+        }
+        std::sort(result.begin(), result.end());
+    }
+    return result;
+}
+
+void DependencyGraph::grow(size_t nodes) {
+    if (nodes <= nodeCount()) return;
+    status_.resize(nodes, MISSING);
+    level_.resize(nodes, 0);
+    waiting_.resize(nodes, 0);
+    rank_.resize(nodes, 0);
+    for (auto& bits : ready_) bits.resize((nodes + 63) / 64, 0);
+}
+
+// Tasks reachable from blocked are raised above the blocker, each to one more
+// than the highest raised task it waits for. Taking them in order of their old
+// ranks visits every task after all raised tasks it waits for, and only
+// tasks ranked no higher than the blocker plus those pushed past them.
+bool DependencyGraph::reorder(int blocker, int blocked) {
+    const int limit = rank_[index(blocker)];
+    if (rank_[index(blocked)] > limit) return true;
+    using Entry = std::pair<int, int>;  // (old rank, id)
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<>> queue;
+    std::unordered_map<int, int> target;  // Queued id -> rank it must reach
+    std::vector<Entry> undo;              // (id, old rank)
+    target.emplace(blocked, limit + 1);
+    queue.emplace(rank_[index(blocked)], blocked);
+    bool cycle = false;
+    while (!queue.empty() && !cycle) {
+        const int id = queue.top().second;
+        queue.pop();
+        const int raised = target[id];
+        undo.emplace_back(id, rank_[index(id)]);
+        rank_[index(id)] = raised;
+        forEachDependent(id, [&](int dependent) {
+            if (!counts(dependent) || rank_[index(dependent)] > raised) return;
+            if (dependent == blocker) cycle = true;
+            auto [it, fresh] = target.try_emplace(dependent, raised + 1);
+            if (fresh) {
+                queue.emplace(rank_[index(dependent)], dependent);
+            } else {
+                it->second = std::max(it->second, raised + 1);
+            }
+        });
+    }
+    if (!cycle) return true;
+    for (auto it = undo.rbegin(); it != undo.rend(); ++it) rank_[index(it->first)] = it->second;
+    return false;
+}
+
+bool DependencyGraph::rankAll(bool everyEdge) {
+    const size_t nodes = nodeCount();
+    auto counts = [&](int id) { return everyEdge || this->counts(id); };
+    std::vector<int> indegree(nodes, 0);
+    for (size_t b = 0; b + 1 < offsets_.size(); ++b) {
+        if (!counts(static_cast<int>(b))) continue;
+        for (size_t i = offsets_[b]; i < offsets_[b + 1] && targets_[i] != HOLE; ++i) {
+            if (counts(targets_[i])) ++indegree[index(targets_[i])];
+        }
+    }
+    for (const auto& [blocker, list] : added_) {
+        if (!counts(blocker)) continue;
+        for (int blocked : list) {
+            if (counts(blocked)) ++indegree[index(blocked)];
+        }
+    }
+    std::vector<int> ranks(nodes, 0);
+    std::vector<int> queue;
+    queue.reserve(nodes);
+    for (size_t id = 0; id < nodes; ++id) {
+        if (indegree[id] == 0) queue.push_back(static_cast<int>(id));
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+        const int id = queue[head];
+        if (!counts(id)) continue;
+        const int next = ranks[index(id)] + 1;
+        forEachDependent(id, [&](int dependent) {
+            if (!counts(dependent)) return;
+            ranks[index(dependent)] = std::max(ranks[index(dependent)], next);
+            if (--indegree[index(dependent)] == 0) queue.push_back(dependent);
+        });
+    }
+    // Tasks on a cycle never run out of blockers
+    if (queue.size() != nodes) return false;
+    rank_ = std::move(ranks);
+    return true;
+}
+
+void DependencyGraph::rebuild(const std::vector<Edge>& extra, bool dropMissing, std::vector<std::uint32_t>& offsets,
+                              std::vector<int>& targets) const {
+    const size_t nodes = nodeCount();
+    auto keep = [&](int blocker, int blocked) { return !dropMissing || (live(blocker) && live(blocked)); };
+    auto each = [&](auto&& fn) {
+        for (size_t b = 0; b + 1 < offsets_.size(); ++b) {
+            for (size_t i = offsets_[b]; i < offsets_[b + 1] && targets_[i] != HOLE; ++i) fn(static_cast<int>(b), targets_[i]);
+        }
+        for (const auto& [blocker, list] : added_) {
+            for (int blocked : list) fn(blocker, blocked);
+        }
+        for (const auto& [blocker, blocked] : extra) fn(blocker, blocked);
+    };
+    // Counting sort by blocker
+    offsets.assign(nodes + 1, 0);
+    size_t total = 0;
+    each([&](int blocker, int blocked) {
+        if (keep(blocker, blocked)) ++offsets[index(blocker) + 1], ++total;
+    });
+    if (total > std::numeric_limits<std::uint32_t>::max()) throw std::length_error("Too many dependencies");
+    for (size_t b = 0; b < nodes; ++b) offsets[b + 1] += offsets[b];
+    targets.assign(total, 0);
+    {
+        std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        each([&](int blocker, int blocked) {
+            if (keep(blocker, blocked)) targets[fill[index(blocker)]++] = blocked;
+        });
+    }
+    // Sort each row and squeeze out duplicates
+    std::uint32_t out = 0;
+    for (size_t b = 0; b < nodes; ++b) {
+        const auto first = targets.begin() + offsets[b];
+        const auto last = targets.begin() + offsets[b + 1];
+        std::sort(first, last);
+        offsets[b] = out;
+        for (auto it = first; it != last; ++it) {
+            if (it == first || *it != *(it - 1)) targets[out++] = *it;
+        }
+    }
+    offsets[nodes] = out;
+    targets.resize(out);
+    if (targets.capacity() - out > out / 8) targets.shrink_to_fit();
+}
+
+void DependencyGraph::compact() {
+    std::vector<std::uint32_t> offsets;
+    std::vector<int> targets;
+    rebuild({}, true, offsets, targets);
+    offsets_ = std::move(offsets);
+    targets_ = std::move(targets);
+    added_ = {};
+    addedCount_ = 0;
+    holes_ = 0;
+    edges_ = targets_.size();
+}
+
+void DependencyGraph::maybeCompact() {
+    if (addedCount_ + holes_ > std::max(MIN_PENDING_CHANGES, edges_ / 8)) compact();
+}
+
+void DependencyGraph::reset(const std::vector<Task>& tasks) {
+    if (edges_ > 0) {
+        track(tasks);
+        return;
+    }
+    offsets_ = {};
+    targets_ = {};
+    holes_ = 0;
+    status_ = {};
+    level_ = {};
+    waiting_ = {};
+    rank_ = {};
+    for (auto& bits : ready_) bits = {};
+    for (size_t& count : readyAt_) count = 0;
+}
+
+void DependencyGraph::track(const std::vector<Task>& tasks) {
+    grow(tasks.empty() ? 1 : index(std::max(tasks.back().getId(), 0)) + 1);
+    std::fill(status_.begin(), status_.end(), MISSING);
+    for (const Task& task : tasks) {
+        if (task.getId() < 0) continue;
+        const size_t id = index(task.getId());
+        status_[id] = task.isCompleted() ? COMPLETED : PENDING;
+        level_[id] = static_cast<std::uint8_t>(task.getPriority() - Task::MIN_PRIORITY);
+    }
+    if (edges_ > 0) {
+        // Edges of tasks deleted or archived without removed() go now
+        compact();
+        // Ranks over the edges left: part of an acyclic graph, so this cannot fail
+        rankAll();
+    }
+    recount();
+}
+
+void DependencyGraph::recount() {
+    std::fill(waiting_.begin(), waiting_.end(), 0);
+    for (size_t b = 0; b + 1 < offsets_.size(); ++b) {
+        if (status_[b] != PENDING) continue;
+        for (size_t i = offsets_[b]; i < offsets_[b + 1] && targets_[i] != HOLE; ++i) ++waiting_[index(targets_[i])];
+    }
+    for (const auto& [blocker, list] : added_) {
+        if (!live(blocker) || status_[index(blocker)] != PENDING) continue;
+        for (int blocked : list) ++waiting_[index(blocked)];
+    }
+    for (int level = 0; level < LEVELS; ++level) {
+        std::fill(ready_[level].begin(), ready_[level].end(), 0);
+        readyAt_[level] = 0;
+    }
+    for (size_t id = 0; id < nodeCount(); ++id) {
+        if (status_[id] == PENDING && waiting_[id] == 0) setReady(static_cast<int>(id), true);
+    }
+}
+
+void DependencyGraph::setReady(int id, bool ready) noexcept {
+    const size_t i = index(id);
+    const int level = level_[i];
+    std::uint64_t& word = ready_[level][i / 64];
+    const std::uint64_t bit = std::uint64_t{1} << (i % 64);
+    if (static_cast<bool>(word & bit) == ready) return;
+    word ^= bit;
+    if (ready) {
+        ++readyAt_[level];
+    } else {
+        --readyAt_[level];
+    }
+}
+
+void DependencyGraph::adjustWaiting(int dependent, int delta) noexcept {
+    int& count = waiting_[index(dependent)];
+    const bool wasFree = count == 0;
+    count += delta;
+    if (status_[index(dependent)] == PENDING && wasFree != (count == 0)) setReady(dependent, count == 0);
+}
+
+void DependencyGraph::added(const Task& task) {
+    if (task.getId() < 0 || !tracking()) return;
+    const size_t id = index(task.getId());
+    grow(id + 1);
+    // Replaced: its edges stay, only its state is new
+    if (status_[id] != MISSING) {
+        completed(task.getId());
+        status_[id] = MISSING;
+    }
+    level_[id] = static_cast<std::uint8_t>(task.getPriority() - Task::MIN_PRIORITY);
+    if (task.isCompleted()) {
+        status_[id] = COMPLETED;
+        return;
+    }
+    status_[id] = PENDING;
+    forEachDependent(task.getId(), [&](int dependent) { adjustWaiting(dependent, +1); });
+    if (waiting_[id] == 0) setReady(task.getId(), true);
+}
+
+void DependencyGraph::completed(int id) {
+    if (!live(id) || status_[index(id)] != PENDING) return;
+    setReady(id, false);
+    status_[index(id)] = COMPLETED;
+    forEachDependent(id, [&](int dependent) { adjustWaiting(dependent, -1); });
+}
+
+void DependencyGraph::reopened(int id) {
+    if (!live(id) || status_[index(id)] != COMPLETED) return;
+    status_[index(id)] = PENDING;
+    forEachDependent(id, [&](int dependent) { adjustWaiting(dependent, +1); });
+    if (waiting_[index(id)] == 0) setReady(id, true);
+}
+
+bool DependencyGraph::removed(int id) {
+    if (!live(id)) return false;
+    // Done first, so dropping the edges below adjusts no ready bits
+    completed(id);
+    const size_t before = edges_;
+    for (int dependent : dependents(id)) removeEdge(id, dependent);
+    // No reverse index: one lookup per row, and a pass over the side table
+    std::vector<int> blockers;
+    for (size_t b = 0; b + 1 < offsets_.size(); ++b) {
+        const auto first = targets_.begin() + offsets_[b];
+        const auto last = targets_.begin() + offsets_[b + 1];
+        const auto at = std::lower_bound(first, last, id, rowLess);
+        if (at != last && *at == id) blockers.push_back(static_cast<int>(b));
+    }
+    for (const auto& [blocker, list] : added_) {
+        if (std::find(list.begin(), list.end(), id) != list.end()) blockers.push_back(blocker);
+    }
+    for (int blocker : blockers) removeEdge(blocker, id);
+    status_[index(id)] = MISSING;
+    return edges_ != before;
+}
+
+void DependencyGraph::priorityChanged(int id, int priority) {
+    if (!live(id)) return;
+    const bool ready = isReady(id);
+    if (ready) setReady(id, false);
+    level_[index(id)] = static_cast<std::uint8_t>(priority - Task::MIN_PRIORITY);
+    if (ready) setReady(id, true);
+}
+
+std::vector<int> DependencyGraph::ready(size_t limit) const {
+    std::vector<int> result;
+    result.reserve(std::min(limit, readyCount()));
+    for (int level = LEVELS - 1; level >= 0 && result.size() < limit; --level) {
+        if (readyAt_[level] == 0) continue;
+        const auto& words = ready_[level];
+        for (size_t w = 0; w < words.size() && result.size() < limit; ++w) {
+            for (std::uint64_t word = words[w]; word && result.size() < limit; word &= word - 1) {
+                result.push_back(static_cast<int>(w * 64 + static_cast<size_t>(std::countr_zero(word))));
+            }
+        }
+    }
+    return result;
+}
+
+size_t DependencyGraph::readyCount() const noexcept {
+    size_t count = 0;
+    for (size_t n : readyAt_) count += n;
+    return count;
+}
+
+bool DependencyGraph::isReady(int id) const noexcept {
+    if (!live(id)) return false;
+    const size_t i = index(id);
+    return (ready_[level_[i]][i / 64] >> (i % 64)) & 1;
+}
+
+int DependencyGraph::waitingFor(int id) const noexcept {
+    return id >= 0 && index(id) < nodeCount() ? waiting_[index(id)] : 0;
+}
+
+void DependencyGraph::write(std::string& out) const {
+    const auto all = edges();
+    out.reserve(out.size() + 8 + all.size() * 8);
+    put<std::uint64_t>(out, all.size());
+    for (const auto& [blocker, blocked] : all) {
+        put(out, static_cast<std::uint32_t>(blocker));
+        put(out, static_cast<std::uint32_t>(blocked));
+    }
+}
+
+std::optional<size_t> DependencyGraph::read(std::string_view in, int idLimit) {
+    clear();
+    if (in.size() < 8) return std::nullopt;
+    const auto count = get<std::uint64_t>(in.data());
+    if (count != (in.size() - 8) / 8 || (in.size() - 8) % 8 != 0) return std::nullopt;
+    std::vector<Edge> edges;
+    edges.reserve(static_cast<size_t>(count));
+    // Checked before anything is sized by them: one stray ID must not
+    // allocate per-task arrays for billions of tasks
+    const auto limit = static_cast<std::uint32_t>(std::max(idLimit, 0));
+    const char* at = in.data() + 8;
+    for (std::uint64_t i = 0; i < count; ++i, at += 8) {
+        const auto blocker = get<std::uint32_t>(at);
+        const auto blocked = get<std::uint32_t>(at + 4);
+        if (blocker < limit && blocked < limit) edges.emplace_back(static_cast<int>(blocker), static_cast<int>(blocked));
+    }
+    // Task states are not tracked yet, so every edge read must be acyclic
+    try {
+        addEdges(edges, true);
+    } catch (const std::exception&) {
+        clear();
+        return std::nullopt;
+    }
+    return static_cast<size_t>(count) - edges.size();
+}
+
+size_t DependencyGraph::memoryBytes() const {
+    size_t bytes = Footprint::of(offsets_) + Footprint::of(targets_) + Footprint::of(added_) + Footprint::of(status_) +
+                   Footprint::of(level_) + Footprint::of(waiting_) + Footprint::of(rank_);
+    for (const auto& [blocker, list] : added_) bytes += Footprint::of(list);
+    for (const auto& bits : ready_) bytes += Footprint::of(bits);
+    return bytes;
+}
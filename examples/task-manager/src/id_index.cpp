@@ -0,0 +1,91 @@
+#include "id_index.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+namespace {
+
+// Interpolation rounds before bisecting what is left; evenly spread IDs need
+// one or two even at millions of tasks
+constexpr int MAX_PROBES = 4;
+// Ranges this short are counted through instead: a compare-and-add per ID
+// vectorizes, where every bisection step waits on the load before it. The
+// window is always this wide, so the loop has no trip count to mispredict.
+constexpr size_t SCAN_RANGE = 64;
+
+// First position in [lo, hi) whose ID is >= id, or hi; the loop compiles to
+// conditional moves, so there are no mispredicted branches to pay for
+size_t bisect(const int* ids, size_t lo, size_t hi, int id) noexcept {
+    if (lo == hi) return hi;
+    const int* base = ids + lo;
+    size_t len = hi - lo;
+    while (len > 1) {
+        const size_t half = len / 2;
+        base += static_cast<size_t>(base[half - 1] < id) * half;
+        len -= half;
+    }
+    return static_cast<size_t>(base - ids) + (*base < id ? 1 : 0);
+}
+
+// Number of IDs in [first, first + len) below id
+size_t countBelow(const int* first, size_t len, int id) noexcept {
+    size_t count = 0;
+    for (size_t i = 0; i < len; ++i) count += static_cast<size_t>(first[i] < id);
+    return count;
+}
+
+}  // namespace
+
+size_t IdIndex::find(int id) const noexcept {
+    const size_t pos = lowerBound(id);
+    return pos < ids_.size() && ids_[pos] == id ? pos : npos;
+}
+
+size_t IdIndex::lowerBound(int id) const noexcept {
+    const int* ids = ids_.data();
+    const size_t n = ids_.size();
+    if (n == 0 || id <= ids[0]) return 0;
+    if (id > ids[n - 1]) return n;
+    // ids[lo] < id <= ids[hi], so the answer is in (lo, hi]
+    size_t lo = 0;
+    size_t hi = n - 1;
+    // Narrow the range by the ID at pos. IDs are distinct integers, so it also
+    // bounds the answer to within |id - value| of pos. Selects rather than
+    // branches: which side the ID falls on is a coin flip.
+    auto narrow = [&](size_t pos, int value) {
+        const auto distance = static_cast<size_t>(std::abs(static_cast<std::int64_t>(id) - value));
+        const bool below = value < id;
+        const size_t newLo = below ? pos : std::max(lo, pos > distance ? pos - distance - 1 : 0);
+        const size_t newHi = below ? std::min(hi, pos + distance) : pos;
+        lo = newLo;
+        hi = newHi;
+    };
+    for (int probe = 0; probe < MAX_PROBES && hi - lo > SCAN_RANGE; ++probe) {
+        // Interpolate between the bounds, not over the whole array: once the
+        // range is inside a cluster of IDs, the guess follows its spacing
+        const double fraction = (static_cast<double>(id) - ids[lo]) / (static_cast<double>(ids[hi]) - ids[lo]);
+        const size_t pos = std::min(lo + 1 + static_cast<size_t>(fraction * static_cast<double>(hi - lo - 1)), hi - 1);
+        const size_t range = hi - lo;
+        if (ids[pos] == id) return pos;
+        narrow(pos, ids[pos]);
+        // Unevenly spread IDs: a guess that did not halve the range is
+        // followed by a bisection step, so no round does worse than halving
+        if (hi - lo > range / 2 && hi - lo > SCAN_RANGE) {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (ids[mid] == id) return mid;
+            narrow(mid, ids[mid]);
+        }
+    }
+    if (hi - lo > SCAN_RANGE) return bisect(ids, lo + 1, hi, id);
+    if (n < SCAN_RANGE) return countBelow(ids, n, id);
+    // A window of SCAN_RANGE IDs covering (lo, hi]; the IDs it holds before
+    // lo + 1 are all below id
+    const size_t start = std::min(lo + 1, n - SCAN_RANGE);
+    return start + countBelow(ids + start, SCAN_RANGE, id);
+}
+
+size_t IdIndex::binaryLowerBound(int id) const noexcept { return bisect(ids_.data(), 0, ids_.size(), id); }
+
+void IdIndex::insert(size_t pos, int id) { ids_.insert(ids_.begin() + static_cast<std::ptrdiff_t>(pos), id); }
+
+void IdIndex::erase(size_t pos) { ids_.erase(ids_.begin() + static_cast<std::ptrdiff_t>(pos)); }
@@ -1,20 +1,150 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
 #include "cli.h"
+#include "metrics.h"
+#include "output.h"
+#include "startup.h"
 #include "storage.h"
+#include "trace.h"
+#include "utils.h"
 
-int main() {
-    // Initialize storage (auto-detects path for executable directory)
-    // Falls back to current directory or ~/.taskmanager if write permission denied
-    Storage storage;
+int main(int argc, char* argv[]) {
+    // --store-dir DIR keeps tasks.json in DIR, overriding TM_STORE_DIR.
+    // --batch runs stdin as a script: no prompt, writes overlapped and grouped.
+    // --follow serves reads from a replica that tails the store's change log.
+    // --profile-startup[=csv] times startup up to the welcome screen, prints
+    // the phase breakdown to stderr and exits.
+    std::string storeDir;
+    bool batch = false;
+    bool follow = false;
+    bool profile = false;
+    bool profileCsv = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--store-dir") == 0 && i + 1 < argc && *argv[i + 1]) {
+            storeDir = argv[++i];
+        } else if (std::strcmp(argv[i], "--batch") == 0) {
+            batch = true;
+        } else if (std::strcmp(argv[i], "--follow") == 0) {
+            follow = true;
+        } else if (std::strcmp(argv[i], "--profile-startup") == 0 || std::strcmp(argv[i], "--profile-startup=csv") == 0) {
+            profile = true;
+            profileCsv = argv[i][std::strlen("--profile-startup")] == '=';
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--store-dir DIR] [--batch] [--follow] [--profile-startup[=csv]]\n";
+            return 2;
+        }
+    }
+    if (profile) Startup::start();
+
+    // Latency metrics are on unless TM_METRICS=0; TM_METRICS_FILE additionally
+    // dumps them in Prometheus text format every TM_METRICS_INTERVAL_MS (default 10s)
+    const char* metricsFlag = std::getenv("TM_METRICS");
+    Metrics::setEnabled(!metricsFlag || std::strcmp(metricsFlag, "0") != 0);
+    std::unique_ptr<Metrics::PeriodicDumper> dumper;
+    if (const char* metricsFile = std::getenv("TM_METRICS_FILE"); metricsFile && *metricsFile && Metrics::enabled()) {
+        long intervalMs = 10000;
+        if (const char* interval = std::getenv("TM_METRICS_INTERVAL_MS")) {
+            intervalMs = std::max(100L, std::strtol(interval, nullptr, 10));
+        }
+        dumper = std::make_unique<Metrics::PeriodicDumper>(metricsFile, std::chrono::milliseconds(intervalMs));
+    }
+
+    // TM_TRACE=<file> records trace spans for the whole session and writes them on exit
+    const char* tracePath = std::getenv("TM_TRACE");
+    if (tracePath && *tracePath) Trace::setEnabled(true);
+
+    // Initialize storage: tasks.json in --store-dir, $TM_STORE_DIR or the
+    // executable's directory. Nothing is written until the first change.
+    const auto storePath = (storeDir.empty() ? Storage::defaultDirectory() : std::filesystem::path(storeDir)) / "tasks.json";
+    // TM_MEMORY_BUDGET=<bytes>[K|M|G] caps the store's memory (see Storage::setMemoryBudget)
+    size_t memoryBudget = 0;
+    if (const char* budget = std::getenv("TM_MEMORY_BUDGET"); budget && *budget && !Utils::parseBytes(budget, memoryBudget)) {
+        std::cerr << "Ignoring TM_MEMORY_BUDGET=" << budget << " (expected e.g. 512M)\n";
+    }
+    // A replica builds everything from the primary's change log
+    std::optional<Storage> opened;
+    try {
+        opened.emplace(follow ? Storage::replica(storePath.string()) : Storage(storePath.string(), memoryBudget));
+        if (follow && memoryBudget) opened->setMemoryBudget(memoryBudget);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    Storage& storage = *opened;
+    if (follow && !std::filesystem::exists(storage.changeLogPath())) {
+        std::cerr << "No change log at " << storage.changeLogPath() << " yet (start the primary with TM_CHANGE_LOG=1)\n";
+    }
+    // TM_COMPACT_JSON=1 writes minified task files (about half the size)
+    if (const char* compact = std::getenv("TM_COMPACT_JSON"); compact && std::strcmp(compact, "1") == 0) {
+        storage.setJsonStyle(TaskJson::Style::Compact);
+    }
+    // TM_CHANGE_LOG=1 keeps a change log for `tm --follow` replicas
+    if (const char* changeLog = std::getenv("TM_CHANGE_LOG"); !follow && changeLog && std::strcmp(changeLog, "1") == 0) {
+        try {
+            storage.enableChangeLog();
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+        }
+    }
+    // TM_ARCHIVE_DAYS=<n> moves tasks completed more than n days ago to the archive on startup
+    if (const char* archiveDays = std::getenv("TM_ARCHIVE_DAYS"); !follow && archiveDays && *archiveDays) {
+        char* end = nullptr;
+        long days = std::strtol(archiveDays, &end, 10);
+        if (*end == '\0' && days >= 0) {
+            try {
+                storage.archiveCompleted(static_cast<std::int64_t>(std::time(nullptr)) - std::int64_t{days} * 86400);
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << "\n";
+            }
+        }
+    }
 
     // Initialize CLI
     CLI cli(storage);
 
-    // Show welcome message
-    cli.showWelcome();
+    if (profile) {
+        // The welcome screen reaching the terminal is the first paint
+        {
+            Startup::Scope scope(Startup::Phase::FirstPaint);
+            cli.showWelcome();
+            OutputSink::console().flush();
+        }
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(storePath, ec);
+        const std::uint64_t bytes = ec ? 0 : size;
+        std::cerr << (profileCsv ? Startup::csv(storage.getTaskCount(), bytes, true)
+                                 : Startup::report(storePath.string(), storage.getTaskCount(), bytes));
+    } else if (batch) {
+        // Own stdin buffer, so the pipeline can tell buffered input from a
+        // read that would block
+        std::ios::sync_with_stdio(false);
+        cli.runPipelined();
+    } else {
+        // Show welcome message
+        cli.showWelcome();
+
+        // Main loop
+        cli.run();
+    }
 
-    // Main loop
-    cli.run();
+    if (tracePath && *tracePath) {
+        // Spans from here on (the console flushing at exit) would not be written
+        Trace::setEnabled(false);
+        try {
+            Trace::writeChromeJson(tracePath);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,209 @@
+#include "metrics.h"
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace Metrics {
+
+namespace detail {
+std::atomic<bool> enabled{false};
+}
+
+static constexpr const char* OP_NAMES[OP_COUNT] = {"add", "complete", "delete", "save", "load", "parse"};
+
+// Prometheus bucket boundaries: 2^10 ns (~1us) up to 2^34 ns (~17s)
+static constexpr unsigned PROM_FIRST_EXP = 10;
+static constexpr unsigned PROM_LAST_EXP = 34;
+
+static std::array<Histogram, OP_COUNT>& histograms() {
+    static std::array<Histogram, OP_COUNT> all;
+    return all;
+}
+
+const char* opName(Op op) { return OP_NAMES[static_cast<size_t>(op)]; }
+
+size_t Histogram::bucketIndex(std::uint64_t ns) noexcept {
+    if (ns < SUB_COUNT) return static_cast<size_t>(ns);
+    unsigned shift = static_cast<unsigned>(std::bit_width(ns)) - 1 - SUB_BITS;
+    size_t sub = static_cast<size_t>(ns >> shift) & (SUB_COUNT - 1);
+    return (shift + 1) * SUB_COUNT + sub;
+}
+
+std::uint64_t Histogram::bucketUpperBound(size_t index) noexcept {
+    if (index < SUB_COUNT) return index;
+    unsigned shift = static_cast<unsigned>(index / SUB_COUNT - 1);
+    std::uint64_t lower = static_cast<std::uint64_t>(SUB_COUNT + index % SUB_COUNT) << shift;
+    return lower + ((std::uint64_t{1} << shift) - 1);
+}
+
+void Histogram::record(std::uint64_t ns) noexcept {
+    buckets_[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(ns, std::memory_order_relaxed);
+    std::uint64_t seen = max_.load(std::memory_order_relaxed);
+    while (ns > seen && !max_.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+    }
+}
+
+void Histogram::reset() noexcept {
+    for (auto& bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t Histogram::count() const noexcept { return count_.load(std::memory_order_relaxed); }
+std::uint64_t Histogram::sum() const noexcept { return sum_.load(std::memory_order_relaxed); }
+std::uint64_t Histogram::max() const noexcept { return max_.load(std::memory_order_relaxed); }
+
+std::uint64_t Histogram::percentile(double p) const noexcept {
+    std::uint64_t total = 0;
+    for (const auto& bucket : buckets_) total += bucket.load(std::memory_order_relaxed);
+    if (total == 0) return 0;
+    auto rank = static_cast<std::uint64_t>(std::ceil(p / 100.0 * static_cast<double>(total)));
+    if (rank == 0) rank = 1;
+    std::uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return std::min(bucketUpperBound(i), max());
+    }
+    return max();
+}
+
+std::uint64_t Histogram::countAtOrBelow(std::uint64_t ns) const noexcept {
+    std::uint64_t total = 0;
+    for (size_t i = 0; i < BUCKETS && bucketUpperBound(i) <= ns; ++i) {
+        total += buckets_[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void setEnabled(bool on) { detail::enabled.store(on, std::memory_order_relaxed); }
+
+void record(Op op, std::uint64_t ns) noexcept { histograms()[static_cast<size_t>(op)].record(ns); }
+
+const Histogram& histogram(Op op) { return histograms()[static_cast<size_t>(op)]; }
+
+void reset() {
+    for (auto& h : histograms()) h.reset();
+}
+
+// 1234 -> "1.2us"
+static std::string formatDuration(std::uint64_t ns) {
+    char buf[32];
+    auto value = static_cast<double>(ns);
+    if (ns < 1000) {
+        std::snprintf(buf, sizeof(buf), "%lluns", static_cast<unsigned long long>(ns));
+    } else if (ns < 1000000) {
+        std::snprintf(buf, sizeof(buf), "%.1fus", value / 1e3);
+    } else if (ns < 1000000000) {
+        std::snprintf(buf, sizeof(buf), "%.1fms", value / 1e6);
+    } else {
+        std::snprintf(buf, sizeof(buf), "%.2fs", value / 1e9);
+    }
+    return buf;
+}
+
+std::string summary() {
+    std::string out;
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-10s %10s %10s %10s %10s %10s %10s\n", "Operation", "Count", "Mean", "p50",
+                  "p90", "p99", "Max");
+    out += line;
+    for (size_t i = 0; i < OP_COUNT; ++i) {
+        const Histogram& h = histograms()[i];
+        std::uint64_t n = h.count();
+        if (n == 0) {
+            std::snprintf(line, sizeof(line), "%-10s %10d %10s %10s %10s %10s %10s\n", OP_NAMES[i], 0, "-", "-", "-",
+                          "-", "-");
+        } else {
+            std::snprintf(line, sizeof(line), "%-10s %10llu %10s %10s %10s %10s %10s\n", OP_NAMES[i],
+                          static_cast<unsigned long long>(n), formatDuration(h.sum() / n).c_str(),
+                          formatDuration(h.percentile(50)).c_str(), formatDuration(h.percentile(90)).c_str(),
+                          formatDuration(h.percentile(99)).c_str(), formatDuration(h.max()).c_str());
+        }
+        out += line;
+    }
+    return out;
+}
+
+std::string toPrometheus() {
+    std::string out;
+    char line[160];
+    out += "# HELP tm_op_duration_seconds Latency of task-manager operations.\n";
+    out += "# TYPE tm_op_duration_seconds histogram\n";
+    for (size_t i = 0; i < OP_COUNT; ++i) {
+        const Histogram& h = histograms()[i];
+        for (unsigned e = PROM_FIRST_EXP; e <= PROM_LAST_EXP; ++e) {
+            // Buckets split exactly at powers of two, so "< 2^e ns" needs no interpolation
+            std::uint64_t limit = std::uint64_t{1} << e;
+            std::snprintf(line, sizeof(line), "tm_op_duration_seconds_bucket{op=\"%s\",le=\"%.9g\"} %llu\n",
+                          OP_NAMES[i], static_cast<double>(limit) / 1e9,
+                          static_cast<unsigned long long>(h.countAtOrBelow(limit - 1)));
+            out += line;
+        }
+        auto total = static_cast<unsigned long long>(h.countAtOrBelow(UINT64_MAX));
+        std::snprintf(line, sizeof(line), "tm_op_duration_seconds_bucket{op=\"%s\",le=\"+Inf\"} %llu\n", OP_NAMES[i],
+                      total);
+        out += line;
+        std::snprintf(line, sizeof(line), "tm_op_duration_seconds_sum{op=\"%s\"} %.9g\n", OP_NAMES[i],
+                      static_cast<double>(h.sum()) / 1e9);
+        out += line;
+        std::snprintf(line, sizeof(line), "tm_op_duration_seconds_count{op=\"%s\"} %llu\n", OP_NAMES[i], total);
+        out += line;
+    }
+    out += "# HELP tm_op_duration_max_seconds Slowest observed operation.\n";
+    out += "# TYPE tm_op_duration_max_seconds gauge\n";
+    for (size_t i = 0; i < OP_COUNT; ++i) {
+        std::snprintf(line, sizeof(line), "tm_op_duration_max_seconds{op=\"%s\"} %.9g\n", OP_NAMES[i],
+                      static_cast<double>(histograms()[i].max()) / 1e9);
+        out += line;
+    }
+    return out;
+}
+
+void writePrometheus(const std::filesystem::path& path) {
+    std::filesystem::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        if (!ofs) throw std::runtime_error("Cannot write metrics file: " + tmp.string());
+        ofs << toPrometheus();
+        if (!ofs) throw std::runtime_error("Cannot write metrics file: " + tmp.string());
+    }
+    std::filesystem::rename(tmp, path);
+}
+
+PeriodicDumper::PeriodicDumper(std::filesystem::path path, std::chrono::milliseconds interval)
+    : path_(std::move(path)), interval_(interval), thread_([this] { loop(); }) {}
+
+PeriodicDumper::~PeriodicDumper() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+    try {
+        writePrometheus(path_);
+    } catch (const std::exception&) {
+        // Nothing sensible to do at shutdown
+    }
+}
+
+void PeriodicDumper::loop() {
+    std::unique_lock lock(mutex_);
+    while (!wake_.wait_for(lock, interval_, [this] { return stop_; })) {
+        lock.unlock();
+        try {
+            writePrometheus(path_);
+        } catch (const std::exception&) {
+            // Keep the last good snapshot; try again next interval
+        }
+        lock.lock();
+    }
+}
+
+}  // namespace Metrics
@@ -0,0 +1,122 @@
+#include "output.h"
+#include "trace.h"
+#include "utils.h"
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#ifdef _WIN32
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+
+// Escape codes only make sense on a terminal; the Windows console build never
+// used them
+static bool wantsColor(int fd) {
+#ifdef _WIN32
+    (void)fd;
+    return false;
+#else
+    const char* noColor = std::getenv("NO_COLOR");
+    return ::isatty(fd) && !(noColor && *noColor);
+#endif
+}
+
+OutputSink::OutputSink(int fd) : fd_(fd), color_(wantsColor(fd)), writeCalls_(0) {
+    buffer_.reserve(CHUNK_SIZE + 1024);
+}
+
+OutputSink::~OutputSink() { flush(); }
+
+OutputSink& OutputSink::console() {
+    static OutputSink sink(1);
+    return sink;
+}
+
+void OutputSink::write(std::string_view text, std::string_view color) {
+    if (text.empty()) return;
+    switchColor(color);
+    buffer_ += text;
+    flushIfFull();
+}
+
+void OutputSink::write(char c) {
+    switchColor({});
+    buffer_ += c;
+}
+
+void OutputSink::fill(size_t count, char c) {
+    switchColor({});
+    buffer_.append(count, c);
+}
+
+// A new color replaces the open one directly; only plain text needs a reset
+void OutputSink::switchColor(std::string_view color) {
+    if (!color_ || color == active_) return;
+    if (color.empty()) buffer_ += Utils::RESET;
+    else buffer_ += color;
+    active_ = color;
+}
+
+void OutputSink::flush() {
+    TRACE_SCOPE("OutputSink::flush");
+    // A reset appended while held would land after unreleased text
+    if (!held_) switchColor({});
+    drain();
+}
+
+int OutputSink::fd() const { return fd_; }
+
+bool OutputSink::colorEnabled() const { return color_; }
+
+void OutputSink::setColorEnabled(bool enabled) {
+    switchColor({});
+    color_ = enabled;
+}
+
+size_t OutputSink::writeCalls() const { return writeCalls_; }
+
+void OutputSink::setHeld(bool held) {
+    held_ = held;
+    if (!held) flush();
+}
+
+size_t OutputSink::mark() const { return base_ + buffer_.size(); }
+
+void OutputSink::release(size_t mark) {
+    if (mark > released_) released_ = mark;
+}
+
+size_t OutputSink::writable() const {
+    if (!held_) return buffer_.size();
+    return released_ > base_ ? released_ - base_ : 0;
+}
+
+void OutputSink::flushIfFull() {
+    if (writable() >= CHUNK_SIZE) drain();
+}
+
+void OutputSink::drain() {
+    // Anything already sent through std::cout must reach the fd first
+    std::cout.flush();
+    const size_t count = writable();
+    const char* data = buffer_.data();
+    size_t left = count;
+    while (left > 0) {
+#ifdef _WIN32
+        int n = _write(fd_, data, static_cast<unsigned>(left));
+#else
+        ssize_t n = ::write(fd_, data, left);
+#endif
+        ++writeCalls_;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;  // Reader went away (closed pipe); drop the rest
+        }
+        data += n;
+        left -= static_cast<size_t>(n);
+    }
+    if (count == buffer_.size()) buffer_.clear();
+    else buffer_.erase(0, count);
+    base_ += count;
+}
@@ -0,0 +1,133 @@
+#include "parallel.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Parallel {
+
+namespace {
+
+thread_local bool insideParallelRegion = false;
+
+class Pool {
+public:
+    explicit Pool(unsigned threads) {
+        // The calling thread is the last worker
+        for (unsigned i = 1; i < threads; ++i) {
+            workers_.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~Pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+
+    unsigned size() const { return static_cast<unsigned>(workers_.size() + 1); }
+
+    void run(size_t chunks, const std::function<void(size_t)>& fn) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &fn;
+            chunks_ = chunks;
+            next_.store(0, std::memory_order_relaxed);
+            active_ = workers_.size();
+            error_ = nullptr;
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        drain(fn, chunks);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        finished_.wait(lock, [this] { return active_ == 0; });
+        job_ = nullptr;
+        if (error_) std::rethrow_exception(error_);
+    }
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable finished_;
+    const std::function<void(size_t)>* job_ = nullptr;
+    size_t chunks_ = 0;
+    size_t active_ = 0;
+    std::uint64_t generation_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+    std::atomic<size_t> next_{0};
+
+    void drain(const std::function<void(size_t)>& fn, size_t chunks) {
+        insideParallelRegion = true;
+        for (size_t c = next_.fetch_add(1, std::memory_order_relaxed); c < chunks;
+             c = next_.fetch_add(1, std::memory_order_relaxed)) {
+            try {
+                fn(c);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) error_ = std::current_exception();
+            }
+        }
+        insideParallelRegion = false;
+    }
+
+    void workerLoop() {
+        std::uint64_t seen = 0;
+        while (true) {
+            const std::function<void(size_t)>* job;
+            size_t chunks;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+                job = job_;
+                chunks = chunks_;
+            }
+            drain(*job, chunks);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--active_ == 0) finished_.notify_one();
+            }
+        }
+    }
+};
+
+std::atomic<unsigned> requestedThreads{0};
+std::mutex poolMutex;  // One parallel region at a time; also guards pool
+std::unique_ptr<Pool> pool;
+
+}  // namespace
+
+void setThreadCount(unsigned count) { requestedThreads.store(count, std::memory_order_relaxed); }
+
+unsigned threadCount() {
+    unsigned count = requestedThreads.load(std::memory_order_relaxed);
+    if (count == 0) count = std::max(1u, std::thread::hardware_concurrency());
+    return count;
+}
+
+void runChunks(size_t chunks, const std::function<void(size_t)>& fn) {
+    unsigned threads = threadCount();
+    if (insideParallelRegion || threads <= 1 || chunks <= 1) {
+        for (size_t c = 0; c < chunks; ++c) fn(c);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(poolMutex);
+    if (!pool || pool->size() != threads) {
+        pool.reset();
+        pool = std::make_unique<Pool>(threads);
+    }
+    pool->run(chunks, fn);
+}
+
+}  // namespace Parallel
@@ -0,0 +1,92 @@
+#include "startup.h"
+#include "utils.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+
+namespace Startup {
+
+namespace detail {
+std::atomic<bool> enabled{false};
+}
+
+static constexpr const char* PHASE_NAMES[PHASE_COUNT] = {"exe path", "store path", "stat",       "read",
+                                                         "parse",    "build",      "first paint"};
+static constexpr const char* CSV_COLUMNS[PHASE_COUNT] = {"exe_path_ns", "store_path_ns", "stat_ns",       "read_ns",
+                                                         "parse_ns",    "build_ns",      "first_paint_ns"};
+
+static std::array<std::atomic<std::uint64_t>, PHASE_COUNT>& phases() {
+    static std::array<std::atomic<std::uint64_t>, PHASE_COUNT> all{};
+    return all;
+}
+
+static std::chrono::steady_clock::time_point& startTime() {
+    static std::chrono::steady_clock::time_point time;
+    return time;
+}
+
+const char* phaseName(Phase phase) { return PHASE_NAMES[static_cast<size_t>(phase)]; }
+
+void start() {
+    for (auto& phase : phases()) phase.store(0, std::memory_order_relaxed);
+    startTime() = std::chrono::steady_clock::now();
+    detail::enabled.store(true, std::memory_order_relaxed);
+}
+
+void record(Phase phase, std::uint64_t ns) noexcept {
+    phases()[static_cast<size_t>(phase)].fetch_add(ns, std::memory_order_relaxed);
+}
+
+std::uint64_t elapsed(Phase phase) noexcept { return phases()[static_cast<size_t>(phase)].load(std::memory_order_relaxed); }
+
+std::uint64_t total() noexcept {
+    auto elapsed = std::chrono::steady_clock::now() - startTime();
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+// Phases in order, then "other" (never negative) and the total
+static std::array<std::uint64_t, PHASE_COUNT + 2> breakdown() {
+    std::array<std::uint64_t, PHASE_COUNT + 2> ns{};
+    std::uint64_t covered = 0;
+    for (size_t i = 0; i < PHASE_COUNT; ++i) covered += ns[i] = elapsed(static_cast<Phase>(i));
+    ns[PHASE_COUNT + 1] = std::max(total(), covered);
+    ns[PHASE_COUNT] = ns[PHASE_COUNT + 1] - covered;
+    return ns;
+}
+
+std::string report(const std::string& store, size_t tasks, std::uint64_t bytes) {
+    const auto ns = breakdown();
+    const std::uint64_t sum = ns[PHASE_COUNT + 1];
+    std::string out = "Startup profile: " + store + " (" + std::to_string(tasks) + " tasks, " + Utils::formatBytes(bytes) + ")\n";
+    char line[96];
+    std::snprintf(line, sizeof(line), "  %-12s %15s %7s\n", "phase", "ns", "share");
+    out += line;
+    for (size_t i = 0; i < ns.size(); ++i) {
+        const char* name = i < PHASE_COUNT ? PHASE_NAMES[i] : i == PHASE_COUNT ? "other" : "total";
+        const double share = sum ? 100.0 * static_cast<double>(ns[i]) / static_cast<double>(sum) : 0.0;
+        std::snprintf(line, sizeof(line), "  %-12s %15llu %6.1f%%\n", name, static_cast<unsigned long long>(ns[i]), share);
+        out += line;
+    }
+    return out;
+}
+
+std::string csv(size_t tasks, std::uint64_t bytes, bool header) {
+    std::string out;
+    if (header) {
+        out = "tasks,bytes";
+        for (const char* column : CSV_COLUMNS) {
+            out += ',';
+            out += column;
+        }
+        out += ",other_ns,total_ns\n";
+    }
+    out += std::to_string(tasks) + "," + std::to_string(bytes);
+    for (std::uint64_t ns : breakdown()) {
+        out += ',';
+        out += std::to_string(ns);
+    }
+    out += "\n";
+    return out;
+}
+
+}  // namespace Startup
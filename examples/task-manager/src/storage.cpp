@@ -1,8 +1,16 @@
 #include "storage.h"
+#include "footprint.h"
+#include "metrics.h"
+#include "startup.h"
+#include "trace.h"
+#include "utils.h"
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
-#include <iomanip>
+#include <algorithm>
 #include <vector>
 #ifdef _WIN32
 #  include <windows.h>
@@ -17,146 +25,1051 @@
 using json = nlohmann::json;
 namespace fs = std::filesystem;
 
-Storage::Storage() : nextId_(1) {
-    // Auto-detect executable directory (Windows/Linux/macOS)
-    auto exeDir = fs::path();
+namespace {
+
+constexpr char FILTER_MAGIC[8] = {'T', 'M', 'B', 'L', 'O', 'O', 'M', '1'};
+constexpr char DEPENDENCY_MAGIC[8] = {'T', 'M', 'D', 'E', 'P', 'S', '0', '1'};
+constexpr double ARCHIVE_FILTER_FP_RATE = 0.01;
+// Filters are sized for twice the archived tasks (at least this many) and
+// rebuilt once they fill up, so appends rarely pay for a rebuild
+constexpr size_t MIN_ARCHIVE_FILTER_CAPACITY = 1024;
+
+std::uint64_t archiveFileSize(const fs::path& path) {
+    std::error_code ec;
+    auto size = fs::file_size(path, ec);
+    return ec ? 0 : size;
+}
+
+// Directory of the running executable (Windows/Linux/macOS), resolved once
+// per process; the current directory if it cannot be determined
+const fs::path& executableDirectory() {
+    static const fs::path dir = [] {
+        auto exeDir = fs::path();
 #ifdef _WIN32
-    char buf[MAX_PATH];
-    DWORD len = GetModuleFileNameA(NULL, buf, MAX_PATH);
-    if (len != 0) {
-        exeDir = fs::path(std::string(buf, static_cast<size_t>(len))).parent_path();
-    } else {
-        exeDir = fs::current_path();
-    }
+        char buf[MAX_PATH];
+        DWORD len = GetModuleFileNameA(NULL, buf, MAX_PATH);
+        if (len != 0) {
+            exeDir = fs::path(std::string(buf, static_cast<size_t>(len))).parent_path();
+        } else {
+            exeDir = fs::current_path();
+        }
 #else
 #if defined(__APPLE__)
-    uint32_t size = 0;
-    _NSGetExecutablePath(NULL, &size);
-    if (size > 0) {
-        std::vector<char> buf(size);
-        if (_NSGetExecutablePath(buf.data(), &size) == 0) {
-            exeDir = fs::path(std::string(buf.data())).parent_path();
+        uint32_t size = 0;
+        _NSGetExecutablePath(NULL, &size);
+        if (size > 0) {
+            std::vector<char> buf(size);
+            if (_NSGetExecutablePath(buf.data(), &size) == 0) {
+                exeDir = fs::path(std::string(buf.data())).parent_path();
+            } else {
+                exeDir = fs::current_path();
+            }
         } else {
             exeDir = fs::current_path();
         }
-    } else {
-        exeDir = fs::current_path();
-    }
 #else
-    char buf[PATH_MAX];
-    ssize_t len = ::readlink("/proc/self/exe", buf, sizeof(buf) - 1);
-    if (len != -1) {
-        buf[len] = '\0';
-        exeDir = fs::path(std::string(buf)).parent_path();
-    } else {
-        exeDir = fs::current_path();
-    }
+        char buf[PATH_MAX];
+        ssize_t len = ::readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+        if (len != -1) {
+            buf[len] = '\0';
+            exeDir = fs::path(std::string(buf)).parent_path();
+        } else {
+            exeDir = fs::current_path();
+        }
 #endif
 #endif
-    filePath_ = exeDir / "tasks.json";
+        return exeDir;
+    }();
+    return dir;
+}
+
+// Replace the file's contents; the caller has already serialized them, so a
+// failure to serialize never truncates the old file
+void writeFile(const fs::path& path, const std::string& data) {
+    std::ofstream ofs(path);
+    if (!ofs) {
+        throw std::runtime_error("Cannot open file for writing: " + path.string());
+    }
+    TRACE_SCOPE("Storage::save write");
+    ofs.write(data.data(), static_cast<std::streamsize>(data.size()));
+    ofs.flush();
+    if (!ofs) {
+        throw std::runtime_error("Cannot write file: " + path.string());
+    }
+}
+
+}  // namespace
+
+Storage::Storage() : nextId_(1) {
+    filePath_ = defaultDirectory() / "tasks.json";
     initialize();
 }
 
-Storage::Storage(const std::string& filename) : nextId_(1) {
-    filePath_ = fs::current_path() / filename;
+Storage::Storage(const std::string& filename, size_t memoryBudget, bool quiet)
+    : nextId_(1), quiet_(quiet), memoryBudget_(memoryBudget) {
+    {
+        Startup::Scope scope(Startup::Phase::StorePath);
+        filePath_ = fs::current_path() / filename;
+    }
     initialize();
 }
 
+Storage::Storage(fs::path path, ReplicaTag) : filePath_(std::move(path)), nextId_(1) {
+    follower_ = std::make_unique<ChangeLogReader>(changeLogPath());
+    // The tasks first: they bound the IDs the edges may name
+    catchUp();
+    loadDependencies();
+    dependencies_.reset(tasks_);
+}
+
+Storage Storage::replica(const std::string& filename) {
+    fs::path path;
+    {
+        Startup::Scope scope(Startup::Phase::StorePath);
+        path = fs::current_path() / filename;
+    }
+    return Storage(std::move(path), ReplicaTag{});
+}
+
+fs::path Storage::defaultDirectory() {
+    Startup::Scope scope(Startup::Phase::ExePath);
+    if (const char* dir = std::getenv("TM_STORE_DIR"); dir && *dir) return dir;
+    return executableDirectory();
+}
+
 void Storage::initialize() {
-    if (!fs::exists(filePath_)) {
-        save();
-        std::cout << "Created new tasks file: " << filePath_ << std::endl;
-    } else {
-        load();
+    // A missing store is created by the first save, so a fresh start writes nothing
+    {
+        Startup::Scope scope(Startup::Phase::Stat);
+        std::error_code ec;
+        if (!fs::exists(filePath_, ec)) return;
+        onDisk_ = true;
+        if (BinaryStore::handles(filePath_)) {
+            binary_ = std::make_unique<BinaryStore>(filePath_);
+        }
     }
+    load();
 }
 
-void Storage::addTask(const std::string& description) {
+int Storage::addTask(std::string description) {
+    Metrics::ScopedTimer timer(Metrics::Op::Add);
+    requireWritable();
     if (description.empty()) {
         throw std::invalid_argument("Description cannot be empty");
     }
-    Task task(nextId_++, description);
-    tasks_.push_back(task);
-    save();
+    if (memoryBudget_) reserveMemory(description.size());
+    const Task& task = tasks_.emplace_back(nextId_++, std::move(description));
+    idIndex_.push_back(task.getId());
+    indexTask(task);
+    completion_->set(task.getId(), false);
+    dependencies_.added(task);
+    int id = task.getId();
+    markDirty(id, BinaryStore::ADDED);
+    persist();
+    return id;
 }
 
-std::vector<Task> Storage::getAllTasks() const { return tasks_; }
+const std::vector<Task>& Storage::getAllTasks() const { return tasks_; }
 
 void Storage::completeTask(int id) {
-    for (auto& task : tasks_) {
-        if (task.getId() == id) {
-            task.setCompleted(true);
-            save();
-            return;
-        }
+    Metrics::ScopedTimer timer(Metrics::Op::Complete);
+    requireWritable();
+    Task& task = getTaskRef(id);
+    unindexTask(task);
+    task.setCompleted(true);
+    task.setCompletedAt(std::time(nullptr));
+    indexTask(task);
+    completion_->set(id, true);
+    dependencies_.completed(id);
+    markDirty(id, BinaryStore::FIELDS);
+    persist();
+}
+
+void Storage::reopenTask(int id) {
+    requireWritable();
+    Task& task = getTaskRef(id);
+    if (!task.isCompleted()) {
+        throw std::runtime_error("Task is not completed");
     }
-    throw std::runtime_error("Task ID not found");
+    task.setCompleted(false);
+    task.setCompletedAt(0);
+    indexTask(task);
+    completion_->set(id, false);
+    dependencies_.reopened(id);
+    markDirty(id, BinaryStore::FIELDS);
+    persist();
 }
 
 void Storage::deleteTask(int id) {
-    auto it = std::remove_if(tasks_.begin(), tasks_.end(),
-                             [id](const Task& t) { return t.getId() == id; });
-    if (it == tasks_.end()) {
-        throw std::runtime_error("Task ID not found");
+    Metrics::ScopedTimer timer(Metrics::Op::Delete);
+    requireWritable();
+    const size_t pos = idIndex_.find(id);
+    if (pos == IdIndex::npos) {
+        throwNotFound(id);
     }
-    tasks_.erase(it, tasks_.end());
-    save();
+    removeAt(pos);
+    markDirty(id, BinaryStore::DELETED);
+    persist();
+}
+
+void Storage::removeAt(size_t index) {
+    const Task& task = tasks_[index];
+    unindexTask(task);
+    for (const auto& tag : task.getTags()) removePosting(tag, task.getId());
+    completion_->clear(task.getId());
+    if (dependencies_.removed(task.getId())) dependenciesDirty_ = true;
+    idIndex_.erase(index);
+    tasks_.erase(tasks_.begin() + static_cast<std::ptrdiff_t>(index));
+}
+
+void Storage::setPriority(int id, int priority) {
+    requireWritable();
+    getTaskRef(id).setPriority(priority);
+    dependencies_.priorityChanged(id, priority);
+    markDirty(id, BinaryStore::FIELDS);
+    persist();
+}
+
+void Storage::setDue(int id, std::int64_t due) {
+    requireWritable();
+    Task& task = getTaskRef(id);
+    unindexTask(task);
+    task.setDue(due);
+    indexTask(task);
+    markDirty(id, BinaryStore::FIELDS);
+    persist();
+}
+
+void Storage::addTag(int id, const std::string& tag) {
+    requireWritable();
+    Task& task = getTaskRef(id);
+    if (!task.addTag(tag)) {
+        throw std::runtime_error("Task already has tag '" + tag + "'");
+    }
+    addPosting(tag, id);
+    markDirty(id, BinaryStore::STRINGS);
+    persist();
+}
+
+void Storage::removeTag(int id, const std::string& tag) {
+    requireWritable();
+    Task& task = getTaskRef(id);
+    if (!task.removeTag(tag)) {
+        throw std::runtime_error("Task does not have tag '" + tag + "'");
+    }
+    removePosting(tag, id);
+    markDirty(id, BinaryStore::STRINGS);
+    persist();
+}
+
+size_t Storage::mergeTasks(const std::vector<std::vector<int>>& groups) {
+    requireWritable();
+    // Resolve every ID before changing anything
+    for (const auto& group : groups) {
+        for (int id : group) getTaskRef(id);
+    }
+    std::vector<char> drop(tasks_.size(), 0);
+    size_t removed = 0;
+    for (const auto& group : groups) {
+        if (group.size() < 2) continue;
+        const size_t keeperPos = idIndex_.find(group.front());
+        if (drop[keeperPos]) continue;
+        Task& keeper = tasks_[keeperPos];
+        for (size_t i = 1; i < group.size(); ++i) {
+            const size_t pos = idIndex_.find(group[i]);
+            if (pos == keeperPos || drop[pos]) continue;
+            const Task& other = tasks_[pos];
+            for (const auto& tag : other.getTags()) keeper.addTag(tag);
+            keeper.setPriority(std::max(keeper.getPriority(), other.getPriority()));
+            if (other.hasDue() && (!keeper.hasDue() || other.getDue() < keeper.getDue())) keeper.setDue(other.getDue());
+            drop[pos] = 1;
+            markDirty(other.getId(), BinaryStore::DELETED);
+            ++removed;
+        }
+        markDirty(keeper.getId(), BinaryStore::FIELDS | BinaryStore::STRINGS);
+    }
+    if (removed == 0) return 0;
+
+    size_t kept = 0;
+    for (size_t i = 0; i < tasks_.size(); ++i) {
+        if (drop[i]) continue;
+        if (kept != i) tasks_[kept] = std::move(tasks_[i]);
+        ++kept;
+    }
+    tasks_.resize(kept);
+    rebuildIndexes();
+    persist();
+    return removed;
+}
+
+std::vector<const Task*> Storage::getUpcoming(size_t limit) const {
+    std::vector<const Task*> result;
+    result.reserve(std::min(limit, dueIndex_.size()));
+    for (auto it = dueIndex_.begin(); it != dueIndex_.end() && result.size() < limit; ++it) {
+        result.push_back(&tasks_[idIndex_.find(it->second)]);
+    }
+    return result;
+}
+
+fs::path Storage::dependencyPath() const {
+    fs::path path = filePath_;
+    return path.replace_extension(".deps");
+}
+
+void Storage::addDependency(int id, int blocker) {
+    requireWritable();
+    findTaskById(id);
+    findTaskById(blocker);
+    if (!dependencies_.tracking()) dependencies_.track(tasks_);
+    if (!dependencies_.addEdge(blocker, id)) {
+        throw std::runtime_error("Task already waits for task " + std::to_string(blocker));
+    }
+    dependenciesDirty_ = true;
+    if (autoSave_) saveDependencies();
+}
+
+size_t Storage::addDependencies(const std::vector<DependencyGraph::Edge>& edges) {
+    TRACE_SCOPE("Storage::addDependencies");
+    requireWritable();
+    for (const auto& [blocker, blocked] : edges) {
+        findTaskById(blocker);
+        findTaskById(blocked);
+    }
+    if (!dependencies_.tracking()) dependencies_.track(tasks_);
+    const size_t added = dependencies_.addEdges(edges);
+    if (added == 0) return 0;
+    dependenciesDirty_ = true;
+    if (autoSave_) saveDependencies();
+    return added;
+}
+
+void Storage::removeDependency(int id, int blocker) {
+    requireWritable();
+    findTaskById(id);
+    findTaskById(blocker);
+    if (!dependencies_.removeEdge(blocker, id)) {
+        throw std::runtime_error("Task does not wait for task " + std::to_string(blocker));
+    }
+    dependenciesDirty_ = true;
+    if (autoSave_) saveDependencies();
+}
+
+std::vector<Task> Storage::getReady(size_t limit) const {
+    std::vector<Task> result;
+    if (!dependencies_.tracking()) {
+        // No dependencies: every pending task is ready
+        std::vector<const Task*> pending;
+        for (const Task& task : tasks_) {
+            if (!task.isCompleted()) pending.push_back(&task);
+        }
+        const auto end = pending.begin() + static_cast<std::ptrdiff_t>(std::min(limit, pending.size()));
+        std::partial_sort(pending.begin(), end, pending.end(), [](const Task* a, const Task* b) {
+            return a->getPriority() != b->getPriority() ? a->getPriority() > b->getPriority() : a->getId() < b->getId();
+        });
+        for (auto it = pending.begin(); it != end; ++it) result.push_back(**it);
+        return result;
+    }
+    for (int id : dependencies_.ready(limit)) result.push_back(tasks_[idIndex_.find(id)]);
+    return result;
+}
+
+void Storage::loadDependencies() {
+    dependencies_.clear();
+    dependenciesDirty_ = false;
+    std::string data;
+    {
+        Startup::Scope scope(Startup::Phase::Read);
+        std::ifstream ifs(dependencyPath(), std::ios::binary | std::ios::ate);
+        if (!ifs) return;
+        data.resize(static_cast<size_t>(ifs.tellg()));
+        ifs.seekg(0);
+        ifs.read(data.data(), static_cast<std::streamsize>(data.size()));
+        data.resize(static_cast<size_t>(ifs.gcount()));
+    }
+    Startup::Scope scope(Startup::Phase::Parse);
+    const std::string_view in = data;
+    std::optional<size_t> dropped;
+    if (in.size() < sizeof(DEPENDENCY_MAGIC) || std::memcmp(in.data(), DEPENDENCY_MAGIC, sizeof(DEPENDENCY_MAGIC)) != 0 ||
+        !(dropped = dependencies_.read(in.substr(sizeof(DEPENDENCY_MAGIC)), nextId_))) {
+        if (!quiet_) std::cerr << "Ignoring malformed dependency file " << dependencyPath() << std::endl;
+        return;
+    }
+    // Edges of tasks that never existed: the next save leaves them out
+    if (*dropped > 0) dependenciesDirty_ = true;
+}
+
+// Written aside and renamed over the old file, so a crash leaves one or the other
+void Storage::saveDependencies() const {
+    if (follower_) return;
+    TRACE_SCOPE("Storage::saveDependencies");
+    const fs::path path = dependencyPath();
+    if (dependencies_.edgeCount() == 0) {
+        std::error_code ec;
+        fs::remove(path, ec);
+        dependenciesDirty_ = false;
+        return;
+    }
+    if (!onDisk_ && filePath_.has_parent_path()) {
+        fs::create_directories(filePath_.parent_path());
+    }
+    std::string data(DEPENDENCY_MAGIC, sizeof(DEPENDENCY_MAGIC));
+    dependencies_.write(data);
+    fs::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        ofs.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!ofs.flush()) throw std::runtime_error("Cannot write file: " + tmp.string());
+    }
+    fs::rename(tmp, path);
+    dependenciesDirty_ = false;
+}
+
+std::vector<const Task*> Storage::getTasksByTag(const std::string& tag) const {
+    std::vector<const Task*> result;
+    auto it = tagIndex_.find(tag);
+    if (it == tagIndex_.end()) return result;
+    result.reserve(it->second.size());
+    for (int id : it->second) {
+        result.push_back(&tasks_[idIndex_.find(id)]);
+    }
+    return result;
 }
 
 void Storage::save() const {
-    std::ofstream ofs(filePath_);
-    if (!ofs) {
-        throw std::runtime_error("Cannot open file for writing: " + filePath_.string());
+    Metrics::ScopedTimer timer(Metrics::Op::Save);
+    TRACE_SCOPE("Storage::save");
+    requireWritable();
+    if (!onDisk_ && filePath_.has_parent_path()) {
+        fs::create_directories(filePath_.parent_path());
+    }
+    if (!binary_ && BinaryStore::handles(filePath_)) {
+        binary_ = std::make_unique<BinaryStore>(filePath_);
+    }
+    if (binary_) {
+        binary_->rewrite(tasks_, nextId_);
+        noteCreated();
+        shipChanges();
+        if (dependenciesDirty_) saveDependencies();
+        return;
+    }
+    {
+        // Serialize before opening: a failure must not truncate the old file
+        TRACE_SCOPE("TaskJson::write");
+        TaskJson::write(saveBuffer_, tasks_, nextId_, jsonStyle_);
+    }
+    writeFile(filePath_, saveBuffer_);
+    noteCreated();
+    shipChanges();
+    if (dependenciesDirty_) saveDependencies();
+}
+
+std::function<void()> Storage::saveJob() const {
+    TRACE_SCOPE("Storage::saveJob");
+    requireWritable();
+    if (binary_ || BinaryStore::handles(filePath_)) {
+        // Record writes are small and in place: do them now
+        if (!binary_ || binary_->needsCompaction()) {
+            save();
+        } else {
+            binary_->flush([this](int id) { return findTask(id); }, nextId_);
+            shipChanges();
+            if (dependenciesDirty_) saveDependencies();
+        }
+        return {};
+    }
+    if (!onDisk_ && filePath_.has_parent_path()) {
+        fs::create_directories(filePath_.parent_path());
     }
-    ofs << std::setw(4) << toJson() << std::endl;  // Pretty print
+    std::string data;
+    {
+        Metrics::ScopedTimer timer(Metrics::Op::Save);
+        TRACE_SCOPE("TaskJson::write");
+        TaskJson::write(data, tasks_, nextId_, jsonStyle_);
+    }
+    // Announced when the write is queued: the job may run on another thread
+    noteCreated();
+    // Edges change one command at a time and are small next to the tasks
+    if (dependenciesDirty_) saveDependencies();
+    // The change set is staged now and committed by the job once the file
+    // holds it: a replica must not see a change that a failed write lost.
+    // The next job waits for this one, so nothing else touches the log.
+    ChangeLog* log = stageChanges() ? changeLog_.get() : nullptr;
+    std::optional<std::vector<Task>> snapshot;
+    if (log && log->needsRewrite()) snapshot = tasks_;
+    return [path = filePath_, data = std::move(data), log, snapshot = std::move(snapshot), nextId = nextId_] {
+        writeFile(path, data);
+        if (!log) return;
+        log->commit(nextId);
+        if (snapshot) log->reset(*snapshot, nextId);
+    };
+}
+
+void Storage::noteCreated() const {
+    if (onDisk_) return;
+    onDisk_ = true;
+    if (!quiet_) std::cout << "Created new tasks file: " << filePath_ << std::endl;
 }
 
 void Storage::load() {
-    std::ifstream ifs(filePath_);
-    if (!ifs) {
-        throw std::runtime_error("Cannot open file for reading: " + filePath_.string());
+    Metrics::ScopedTimer timer(Metrics::Op::Load);
+    TRACE_SCOPE("Storage::load");
+    // The dependencies go between the tasks, which bound the IDs the edges may
+    // name, and the task indexes, which include the schedule
+    if (binary_) {
+        binary_->load(tasks_, nextId_);
+        loadDependencies();
+        Startup::Scope scope(Startup::Phase::Build);
+        rebuildIndexes();
+        admitLoaded();
+        return;
     }
-    json j;
-    ifs >> j;
-    fromJson(j);
+    std::string text;
+    {
+        TRACE_SCOPE("Storage::load read");
+        Startup::Scope scope(Startup::Phase::Read);
+        std::ifstream ifs(filePath_, std::ios::ate);
+        if (!ifs) {
+            throw std::runtime_error("Cannot open file for reading: " + filePath_.string());
+        }
+        text.resize(static_cast<size_t>(ifs.tellg()));
+        ifs.seekg(0);
+        ifs.read(text.data(), static_cast<std::streamsize>(text.size()));
+        text.resize(static_cast<size_t>(ifs.gcount()));
+    }
+    std::vector<Task> tasks;
+    int nextId = 1;
+    bool fast;
+    {
+        TRACE_SCOPE("TaskJson::read");
+        Startup::Scope scope(Startup::Phase::Parse);
+        fast = TaskJson::read(text, tasks, nextId);
+    }
+    if (!fast) {
+        // Anything the schema-aware reader does not handle, including malformed files
+        TRACE_SCOPE("nlohmann::json::parse");
+        Startup::Scope scope(Startup::Phase::Parse);
+        json j = json::parse(text);
+        TaskJson::fromDom(j, tasks, nextId);
+    }
+    tasks_ = std::move(tasks);
+    nextId_ = nextId;
+    loadDependencies();
+    Startup::Scope scope(Startup::Phase::Build);
+    rebuildIndexes();
+    admitLoaded();
+}
+
+fs::path Storage::archivePath() const {
+    fs::path path = filePath_;
+    return path.replace_extension(".archive.jsonl");
+}
+
+size_t Storage::archiveCompleted(std::int64_t completedBefore) {
+    TRACE_SCOPE("Storage::archiveCompleted");
+    requireWritable();
+    auto expired = [completedBefore](const Task& task) {
+        return task.isCompleted() && task.getCompletedAt() <= completedBefore;
+    };
+    std::string lines;
+    for (const Task& task : tasks_) {
+        if (expired(task)) TaskJson::writeLine(lines, task);
+    }
+    if (lines.empty()) return 0;
+
+    // Append before dropping the tasks from the store: a crash in between
+    // leaves them in both tiers (list all prefers the active copy), never in neither
+    fs::path path = archivePath();
+    loadArchiveFilters();
+    {
+        std::ifstream tail(path, std::ios::binary | std::ios::ate);
+        if (tail && tail.tellg() > 0) {
+            // Terminate a torn last line so it cannot swallow the first new record
+            tail.seekg(-1, std::ios::end);
+            if (tail.get() != '\n') lines.insert(lines.begin(), '\n');
+        }
+    }
+    std::ofstream ofs(path, std::ios::binary | std::ios::app);
+    if (!ofs) {
+        throw std::runtime_error("Cannot open file for writing: " + path.string());
+    }
+    ofs.write(lines.data(), static_cast<std::streamsize>(lines.size()));
+    ofs.flush();
+    if (!ofs) {
+        throw std::runtime_error("Cannot write file: " + path.string());
+    }
+
+    ofs.close();
+
+    size_t moved = 0;
+    for (const Task& task : tasks_) {
+        if (!expired(task)) continue;
+        markDirty(task.getId(), BinaryStore::DELETED);
+        ++moved;
+    }
+    if (archiveIds_.size() + moved > archiveIds_.capacity()) {
+        rebuildArchiveFilters();
+    } else {
+        for (const Task& task : tasks_) {
+            if (!expired(task)) continue;
+            archiveIds_.add(BloomFilter::hash(std::int64_t{task.getId()}));
+            archiveDescriptions_.add(BloomFilter::hash(task.getDescription()));
+        }
+        saveArchiveFilters(archiveFileSize(path));
+    }
+    std::erase_if(tasks_, expired);
+    rebuildIndexes();
+    persist();
+    return moved;
+}
+
+void Storage::forEachArchived(const std::function<bool(Task&)>& fn) const {
+    std::ifstream ifs(archivePath(), std::ios::binary);
+    if (!ifs) return;  // Nothing archived yet
+    std::vector<Task> parsed;
+    std::string line;
+    while (std::getline(ifs, line)) {
+        parsed.clear();
+        if (!TaskJson::readLine(line, parsed)) {
+            try {
+                TaskJson::readLineDom(line, parsed);
+            } catch (const std::exception&) {
+                continue;
+            }
+        }
+        for (Task& task : parsed) {
+            if (!fn(task)) return;
+        }
+    }
+}
+
+std::vector<Task> Storage::searchArchive(const std::function<bool(const Task&)>& pred) const {
+    TRACE_SCOPE("Storage::searchArchive");
+    std::vector<Task> matches;
+    forEachArchived([&](Task& task) {
+        if (pred(task)) matches.push_back(std::move(task));
+        return true;
+    });
+    return matches;
+}
+
+std::vector<Task> Storage::getArchivedTasks() const {
+    return searchArchive([](const Task&) { return true; });
+}
+
+std::optional<Task> Storage::findArchived(int id) const {
+    loadArchiveFilters();
+    if (!archiveIds_.mightContain(BloomFilter::hash(std::int64_t{id}))) return std::nullopt;
+    TRACE_SCOPE("Storage::findArchived scan");
+    std::optional<Task> found;
+    forEachArchived([&](Task& task) {
+        if (task.getId() != id) return true;
+        found = std::move(task);
+        return false;
+    });
+    return found;
+}
+
+bool Storage::isArchivedDescription(std::string_view description) const {
+    loadArchiveFilters();
+    if (!archiveDescriptions_.mightContain(BloomFilter::hash(description))) return false;
+    TRACE_SCOPE("Storage::isArchivedDescription scan");
+    bool found = false;
+    forEachArchived([&](Task& task) {
+        found = task.getDescription() == description;
+        return !found;
+    });
+    return found;
+}
+
+fs::path Storage::archiveFilterPath() const {
+    fs::path path = archivePath();
+    return path += ".bloom";
+}
+
+void Storage::loadArchiveFilters() const {
+    if (archiveFiltersReady_) return;
+    const std::uint64_t archiveBytes = archiveFileSize(archivePath());
+    if (archiveBytes == 0) {
+        // Nothing archived: empty filters reject everything, and there is nothing to persist
+        archiveIds_ = BloomFilter();
+        archiveDescriptions_ = BloomFilter();
+        archiveFiltersReady_ = true;
+        return;
+    }
+    std::string data;
+    {
+        std::ifstream ifs(archiveFilterPath(), std::ios::binary | std::ios::ate);
+        if (ifs) {
+            data.resize(static_cast<size_t>(ifs.tellg()));
+            ifs.seekg(0);
+            ifs.read(data.data(), static_cast<std::streamsize>(data.size()));
+            data.resize(static_cast<size_t>(ifs.gcount()));
+        }
+    }
+    std::string_view in = data;
+    if (in.size() >= 16 && std::memcmp(in.data(), FILTER_MAGIC, sizeof(FILTER_MAGIC)) == 0) {
+        std::uint64_t covered = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            covered |= std::uint64_t{static_cast<unsigned char>(in[8 + i])} << (8 * i);
+        }
+        in.remove_prefix(16);
+        // Filters written for a different archive size are stale (an append
+        // interrupted before they were saved, or the archive replaced by hand)
+        if (covered == archiveBytes && archiveIds_.read(in) && archiveDescriptions_.read(in)) {
+            archiveFiltersReady_ = true;
+            return;
+        }
+    }
+    rebuildArchiveFilters();
+}
+
+void Storage::rebuildArchiveFilters() const {
+    TRACE_SCOPE("Storage::rebuildArchiveFilters");
+    const std::uint64_t archiveBytes = archiveFileSize(archivePath());
+    std::vector<std::uint64_t> ids;
+    std::vector<std::uint64_t> descriptions;
+    forEachArchived([&](Task& task) {
+        ids.push_back(BloomFilter::hash(std::int64_t{task.getId()}));
+        descriptions.push_back(BloomFilter::hash(task.getDescription()));
+        return true;
+    });
+    const size_t capacity = std::max(ids.size() * 2, MIN_ARCHIVE_FILTER_CAPACITY);
+    archiveIds_ = BloomFilter(capacity, ARCHIVE_FILTER_FP_RATE);
+    archiveDescriptions_ = BloomFilter(capacity, ARCHIVE_FILTER_FP_RATE);
+    for (auto key : ids) archiveIds_.add(key);
+    for (auto key : descriptions) archiveDescriptions_.add(key);
+    archiveFiltersReady_ = true;
+    saveArchiveFilters(archiveBytes);
+}
+
+void Storage::saveArchiveFilters(std::uint64_t archiveBytes) const {
+    if (follower_) return;  // Replicas never write; the primary keeps the file current
+    std::string data(FILTER_MAGIC, sizeof(FILTER_MAGIC));
+    for (size_t i = 0; i < 8; ++i) data += static_cast<char>(archiveBytes >> (8 * i));
+    archiveIds_.write(data);
+    archiveDescriptions_.write(data);
+    // The filter file is only a cache: if it cannot be written, the next run rebuilds it
+    fs::path path = archiveFilterPath();
+    fs::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        if (!ofs) return;
+        ofs.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!ofs.flush()) return;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+}
+
+void Storage::setAutoSave(bool enabled) { autoSave_ = enabled; }
+
+void Storage::setJsonStyle(TaskJson::Style style) { jsonStyle_ = style; }
+
+void Storage::setQuiet(bool quiet) { quiet_ = quiet; }
+
+void Storage::persist() {
+    if (!autoSave_) return;
+    if (!binary_ || binary_->needsCompaction()) {
+        save();
+        return;
+    }
+    binary_->flush([this](int id) { return findTask(id); }, nextId_);
+    shipChanges();
+    if (dependenciesDirty_) saveDependencies();
+}
+
+void Storage::markDirty(int id, unsigned change) {
+    if (binary_) binary_->markDirty(id, change);
+    if (changeLog_) logPending_.push_back(id);
+}
+
+void Storage::markAllDirty() {
+    if (binary_) binary_->markAllDirty();
+    if (changeLog_) {
+        for (const Task& task : tasks_) logPending_.push_back(task.getId());
+    }
+}
+
+Storage::MemoryUsage Storage::memoryUsage() const {
+    MemoryUsage usage;
+    usage.tasks = Footprint::of(tasks_);
+    for (const Task& task : tasks_) usage.strings += task.heapBytes();
+    usage.indexes = Footprint::of(idIndex_.ids()) + Footprint::of(dueIndex_) + Footprint::of(tagIndex_) +
+                    completion_->memoryBytes() + dependencies_.memoryBytes();
+    for (const auto& [tag, postings] : tagIndex_) usage.indexes += Footprint::of(tag) + Footprint::of(postings);
+    usage.caches = Footprint::of(saveBuffer_) + Footprint::of(logPending_) + Footprint::block(archiveIds_.bitCount() / 8) +
+                   Footprint::block(archiveDescriptions_.bitCount() / 8);
+    if (binary_) usage.caches += binary_->memoryBytes();
+    if (changeLog_) usage.caches += changeLog_->memoryBytes();
+    return usage;
+}
+
+void Storage::setMemoryBudget(size_t bytes) {
+    const size_t previous = memoryBudget_;
+    memoryBudget_ = bytes;
+    if (bytes == 0 || fitMemoryBudget(0)) return;
+    memoryBudget_ = previous;
+    throw std::runtime_error("The store uses " + Utils::formatBytes(measuredUsage_) + ", over a memory budget of " +
+                             Utils::formatBytes(bytes) + " even without completed tasks");
+}
+
+// Measure, and archive completed tasks if usage plus `incoming` bytes about
+// to be allocated exceeds the budget; false if it still does
+bool Storage::fitMemoryBudget(size_t incoming) {
+    measuredUsage_ = memoryUsage().total();
+    unmeasured_ = 0;
+    if (measuredUsage_ + incoming <= memoryBudget_) return true;
+    // The save buffer is only kept to spare the next save an allocation
+    saveBuffer_ = std::string();
+    measuredUsage_ = memoryUsage().total();
+    if (measuredUsage_ + incoming <= memoryBudget_) return true;
+    if (follower_) return false;  // Replicas cannot archive
+    // Down to 7/8 of the budget if possible, so the adds that follow do not
+    // evict one task at a time
+    const size_t over = measuredUsage_ + incoming - memoryBudget_;
+    if (!evictCompleted(over + memoryBudget_ / 8) && !evictCompleted(over)) return false;
+    saveBuffer_ = std::string();  // Regrown by the save that dropped the archived tasks
+    measuredUsage_ = memoryUsage().total();
+    return measuredUsage_ + incoming <= memoryBudget_;
+}
+
+// Archive the oldest completed tasks holding at least `bytes`
+bool Storage::evictCompleted(size_t bytes) {
+    TRACE_SCOPE("Storage::evictCompleted");
+    std::vector<std::pair<std::int64_t, size_t>> completed;  // (completed at, bytes held)
+    for (const Task& task : tasks_) {
+        if (!task.isCompleted()) continue;
+        // The slots in tasks_ and the ID index come back too
+        completed.emplace_back(task.getCompletedAt(), sizeof(Task) + task.heapBytes() + sizeof(int));
+    }
+    // Archiving everything would not be enough: leave the store (and its file) alone
+    size_t freeable = 0;
+    for (const auto& entry : completed) freeable += entry.second;
+    if (freeable < bytes) return false;
+    std::sort(completed.begin(), completed.end());
+    std::int64_t cutoff = 0;
+    size_t freed = 0;
+    for (const auto& [completedAt, held] : completed) {
+        cutoff = completedAt;
+        freed += held;
+        if (freed >= bytes) break;
+    }
+    archiveCompleted(cutoff);
+    // Hand the freed capacity back to the allocator
+    tasks_.shrink_to_fit();
+    idIndex_.shrinkToFit();
+    return true;
+}
+
+void Storage::admitLoaded() {
+    if (memoryBudget_ == 0 || fitMemoryBudget(0)) return;
+    const size_t needed = measuredUsage_;
+    tasks_ = {};
+    rebuildIndexes();
+    idIndex_.shrinkToFit();
+    throw std::runtime_error("Refusing to load " + filePath_.string() + ": it needs " + Utils::formatBytes(needed) +
+                             ", over the memory budget of " + Utils::formatBytes(memoryBudget_));
+}
+
+// Keep an add within the budget. Between measurements usage is tracked as an
+// upper bound: each add may allocate its description, a due-index node and,
+// when the task vector or the ID index is full, its next buffer.
+void Storage::reserveMemory(size_t descriptionBytes) {
+    size_t incoming = Footprint::block(descriptionBytes + 1) + Footprint::block(4 * sizeof(void*) + 16);
+    if (tasks_.size() == tasks_.capacity()) incoming += Footprint::block(std::max<size_t>(1, 2 * tasks_.capacity()) * sizeof(Task));
+    if (idIndex_.full()) incoming += Footprint::block(std::max<size_t>(1, 2 * idIndex_.size()) * sizeof(int));
+    if (measuredUsage_ + unmeasured_ + incoming > memoryBudget_ && !fitMemoryBudget(incoming)) {
+        throw std::runtime_error("Memory budget of " + Utils::formatBytes(memoryBudget_) + " reached (the store uses " +
+                                 Utils::formatBytes(measuredUsage_) + ")");
+    }
+    unmeasured_ += incoming;
+}
+
+void Storage::requireWritable() const {
+    if (follower_) {
+        throw std::runtime_error("Read-only replica: make changes through the primary");
+    }
+}
+
+fs::path Storage::changeLogPath() const {
+    fs::path path = filePath_;
+    return path.replace_extension(".changes.log");
+}
+
+void Storage::enableChangeLog() {
+    requireWritable();
+    if (changeLog_) return;
+    if (filePath_.has_parent_path()) {
+        fs::create_directories(filePath_.parent_path());
+    }
+    auto log = std::make_unique<ChangeLog>(changeLogPath());
+    log->reset(tasks_, nextId_);
+    changeLog_ = std::move(log);
+}
+
+bool Storage::stageChanges() const {
+    if (!changeLog_) return false;
+    if (logPending_.empty()) return changeLog_->hasPending();
+    TRACE_SCOPE("Storage::stageChanges");
+    std::sort(logPending_.begin(), logPending_.end());
+    logPending_.erase(std::unique(logPending_.begin(), logPending_.end()), logPending_.end());
+    for (int id : logPending_) {
+        if (const Task* task = findTask(id)) changeLog_->put(*task);
+        else changeLog_->remove(id);
+    }
+    logPending_.clear();
+    return true;
+}
+
+// Callers write the store first: a set is only committed once it is durable
+void Storage::shipChanges() const {
+    if (!stageChanges()) return;
+    changeLog_->commit(nextId_);
+    if (changeLog_->needsRewrite()) changeLog_->reset(tasks_, nextId_);
+}
+
+std::uint64_t Storage::changeLsn() const {
+    if (follower_) return follower_->lsn();
+    return changeLog_ ? changeLog_->lsn() : 0;
+}
+
+size_t Storage::catchUp() {
+    if (!follower_) return 0;
+    TRACE_SCOPE("Storage::catchUp");
+    auto update = follower_->read();
+    size_t first = 0;
+    if (update.restarted) {
+        // A snapshot replaces everything in one go
+        tasks_.clear();
+        if (!update.sets.empty()) {
+            tasks_ = std::move(update.sets.front().puts);
+            nextId_ = update.sets.front().nextId;
+            first = 1;
+        }
+        rebuildIndexes();
+        archiveFiltersReady_ = false;
+    }
+    for (size_t i = first; i < update.sets.size(); ++i) {
+        auto& set = update.sets[i];
+        for (int id : set.deletes) {
+            if (const size_t pos = idIndex_.find(id); pos != IdIndex::npos) removeAt(pos);
+        }
+        // Deletes include archived tasks: the filters must catch up with the archive
+        if (!set.deletes.empty()) archiveFiltersReady_ = false;
+        for (Task& task : set.puts) upsert(std::move(task));
+        nextId_ = set.nextId;
+    }
+    return update.sets.size();
+}
+
+void Storage::upsert(Task task) {
+    const size_t pos = idIndex_.lowerBound(task.getId());
+    if (pos == idIndex_.size() || idIndex_.ids()[pos] != task.getId()) {
+        // New IDs come from the primary's counter, so this is nearly always an append
+        idIndex_.insert(pos, task.getId());
+        const Task& added = *tasks_.insert(tasks_.begin() + static_cast<std::ptrdiff_t>(pos), std::move(task));
+        indexTask(added);
+        for (const auto& tag : added.getTags()) addPosting(tag, added.getId());
+        completion_->set(added.getId(), added.isCompleted());
+        dependencies_.added(added);
+        return;
+    }
+    Task& current = tasks_[pos];
+    unindexTask(current);
+    for (const auto& tag : current.getTags()) removePosting(tag, current.getId());
+    current = std::move(task);
+    indexTask(current);
+    for (const auto& tag : current.getTags()) addPosting(tag, current.getId());
+    completion_->set(current.getId(), current.isCompleted());
+    dependencies_.added(current);
 }
 
 bool Storage::exists() const { return fs::exists(filePath_); }
 
 size_t Storage::getTaskCount() const { return tasks_.size(); }
 
-Task Storage::findTaskById(int id) const {
-    for (const auto& task : tasks_) {
-        if (task.getId() == id) return task;
+const Task& Storage::findTaskById(int id) const {
+    const Task* task = findTask(id);
+    if (!task) throwNotFound(id);
+    return *task;
+}
+
+const Task* Storage::findTask(int id) const {
+    const size_t pos = idIndex_.find(id);
+    return pos == IdIndex::npos ? nullptr : &tasks_[pos];
+}
+
+Task& Storage::getTaskRef(int id) {
+    const size_t pos = idIndex_.find(id);
+    if (pos == IdIndex::npos) {
+        throwNotFound(id);
     }
-    throw std::runtime_error("Task ID not found");
+    return tasks_[pos];
 }
 
-json Storage::toJson() const {
-    json j = json::array();
-    for (const auto& task : tasks_) {
-        j.push_back({
-            {"id", task.getId()},
-            {"description", task.getDescription()},
-            {"completed", task.isCompleted()}
-        });
+void Storage::throwNotFound(int id) const {
+    throw std::runtime_error(findArchived(id) ? "Task ID is archived" : "Task ID not found");
+}
+
+void Storage::indexTask(const Task& task) {
+    if (task.hasDue() && !task.isCompleted()) {
+        dueIndex_.emplace(task.getDue(), task.getId());
     }
-    return {{"tasks", j}, {"nextId", nextId_}};  // Save nextId for persistence
 }
 
-void Storage::fromJson(const json& j) {
-    tasks_.clear();
-    if (j.contains("tasks") && j["tasks"].is_array()) {
-        for (const auto& item : j["tasks"]) {
-            Task t(
-                item["id"].get<int>(),
-                item["description"].get<std::string>(),
-                item["completed"].get<bool>()
-            );
-            if (t.validate()) {
-                tasks_.push_back(t);
-            }
+void Storage::unindexTask(const Task& task) {
+    dueIndex_.erase({task.getDue(), task.getId()});
+}
+
+void Storage::addPosting(const std::string& tag, int id) {
+    auto& postings = tagIndex_[tag];
+    postings.insert(std::lower_bound(postings.begin(), postings.end(), id), id);
+}
+
+void Storage::removePosting(const std::string& tag, int id) {
+    auto it = tagIndex_.find(tag);
+    if (it == tagIndex_.end()) return;
+    auto& postings = it->second;
+    auto p = std::lower_bound(postings.begin(), postings.end(), id);
+    if (p != postings.end() && *p == id) postings.erase(p);
+    if (postings.empty()) tagIndex_.erase(it);
+}
+
+void Storage::rebuildIndexes() {
+    // Files written by this store are in ID order already; imported or
+    // hand-edited ones may not be
+    auto byId = [](const Task& a, const Task& b) { return a.getId() < b.getId(); };
+    if (!std::is_sorted(tasks_.begin(), tasks_.end(), byId)) {
+        std::stable_sort(tasks_.begin(), tasks_.end(), byId);
+    }
+    // The ID index needs distinct IDs. Of tasks sharing one, which only a
+    // hand-edited file has, keep the last: lookups always found that one.
+    auto sameId = [](const Task& a, const Task& b) { return a.getId() == b.getId(); };
+    if (auto dup = std::adjacent_find(tasks_.begin(), tasks_.end(), sameId); dup != tasks_.end()) {
+        if (!quiet_) std::cerr << "Dropping tasks with duplicate IDs from " << filePath_ << std::endl;
+        tasks_.erase(tasks_.begin(), std::unique(tasks_.rbegin(), tasks_.rend(), sameId).base());
+    }
+    // New IDs must sort last
+    if (!tasks_.empty()) nextId_ = std::max(nextId_, tasks_.back().getId() + 1);
+    idIndex_.clear();
+    dueIndex_.clear();
+    tagIndex_.clear();
+    idIndex_.reserve(tasks_.size());
+    for (const Task& task : tasks_) {
+        idIndex_.push_back(task.getId());
+        indexTask(task);
+        for (const auto& tag : task.getTags()) {
+            tagIndex_[tag].push_back(task.getId());
         }
     }
-    nextId_ = j.contains("nextId") ? j["nextId"].get<int>() : 1;
-}
\ No newline at end of file
+    for (auto& [tag, postings] : tagIndex_) {
+        std::sort(postings.begin(), postings.end());
+    }
+    completion_->assign(tasks_);
+    // Tasks gone since the edges were read take theirs with them
+    const size_t edges = dependencies_.edgeCount();
+    dependencies_.reset(tasks_);
+    if (dependencies_.edgeCount() != edges) dependenciesDirty_ = true;
+}
@@ -0,0 +1,207 @@
+#include "table.h"
+#include "utils.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#ifdef _WIN32
+#  include <io.h>
+#  include <windows.h>
+#else
+#  include <sys/ioctl.h>
+#  include <unistd.h>
+#endif
+
+// UTF-8 continuation bytes do not take a column
+static bool isContinuation(char c) { return (static_cast<unsigned char>(c) & 0xC0) == 0x80; }
+
+static size_t displayWidth(std::string_view s) {
+    return static_cast<size_t>(std::count_if(s.begin(), s.end(), [](char c) { return !isContinuation(c); }));
+}
+
+// Longest prefix of s that is at most `columns` characters wide
+static std::string_view prefixColumns(std::string_view s, size_t columns) {
+    size_t seen = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (isContinuation(s[i])) continue;
+        if (seen == columns) return s.substr(0, i);
+        ++seen;
+    }
+    return s;
+}
+
+static int envInt(const char* name) {
+    const char* value = std::getenv(name);
+    if (!value) return 0;
+    int out = 0;
+    std::from_chars(value, value + std::char_traits<char>::length(value), out);
+    return out;
+}
+
+TableRenderer::TableRenderer(OutputSink& out) : out_(out), width_(0) {}
+
+TableRenderer::TerminalSize TableRenderer::terminalSize(int fd) {
+    TerminalSize size{0, 0, false};
+#ifdef _WIN32
+    if (_isatty(fd)) {
+        CONSOLE_SCREEN_BUFFER_INFO info;
+        HANDLE handle = GetStdHandle(fd == 2 ? STD_ERROR_HANDLE : STD_OUTPUT_HANDLE);
+        if (GetConsoleScreenBufferInfo(handle, &info)) {
+            size.columns = info.srWindow.Right - info.srWindow.Left + 1;
+            size.rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+            size.isTerminal = true;
+        }
+    }
+#else
+    if (::isatty(fd)) {
+        struct winsize ws {};
+        if (::ioctl(fd, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) {
+            size.columns = ws.ws_col;
+            size.rows = ws.ws_row;
+        }
+        size.isTerminal = true;
+    }
+#endif
+    if (size.columns <= 0) size.columns = envInt("COLUMNS");
+    if (size.rows <= 0) size.rows = envInt("LINES");
+    if (size.columns <= 0) size.columns = DEFAULT_WIDTH;
+    if (size.rows <= 0) size.rows = 24;
+    return size;
+}
+
+void TableRenderer::setWidth(int width) { width_ = width; }
+
+namespace {
+
+const Task& deref(const Task& task) { return task; }
+const Task& deref(const Task* task) { return *task; }
+
+}  // namespace
+
+template <typename Tasks>
+TableRenderer::Layout TableRenderer::computeLayout(const Tasks& tasks, int width) const {
+    Layout layout{width, 1, false, false, 0};
+    int maxId = 0;
+    for (const auto& entry : tasks) {
+        const Task& task = deref(entry);
+        maxId = std::max(maxId, task.getId());
+        layout.showDue = layout.showDue || task.hasDue();
+        layout.showPriority = layout.showPriority || task.getPriority() != Task::MIN_PRIORITY;
+    }
+    for (int v = maxId; v >= 10; v /= 10) ++layout.idWidth;
+    layout.idWidth = std::max(layout.idWidth, 3);
+
+    // "| #" id " [P] " [due " "] [priority " "] desc " |"
+    int fixed = 3 + layout.idWidth + 5 + 2;
+    if (layout.showDue) fixed += 11;
+    if (layout.showPriority) fixed += 3;
+    // Drop optional columns before squeezing the description below 10 columns
+    if (width - fixed < 10 && layout.showPriority) { layout.showPriority = false; fixed -= 3; }
+    if (width - fixed < 10 && layout.showDue) { layout.showDue = false; fixed -= 11; }
+    layout.descWidth = std::max(width - fixed, 4);
+    layout.width = fixed + layout.descWidth;
+    return layout;
+}
+
+void TableRenderer::appendRule(char fill, int width) {
+    out_.fill(static_cast<size_t>(width), fill);
+    out_.write('\n');
+}
+
+void TableRenderer::appendTextRow(std::string_view text, int width) {
+    size_t inner = static_cast<size_t>(width - 4);
+    std::string_view shown = prefixColumns(text, inner);
+    out_.write("| ");
+    out_.write(shown);
+    out_.fill(inner - displayWidth(shown), ' ');
+    out_.write(" |\n");
+}
+
+void TableRenderer::appendTaskRow(const Task& task, const Layout& layout) {
+    char digits[16];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), task.getId());
+    (void)ec;
+    size_t idLen = static_cast<size_t>(end - digits);
+
+    out_.write("| #");
+    if (idLen < static_cast<size_t>(layout.idWidth)) out_.fill(static_cast<size_t>(layout.idWidth) - idLen, ' ');
+    out_.write(std::string_view(digits, idLen));
+    out_.write(task.isCompleted() ? " [C] " : " [P] ");
+
+    if (layout.showDue) {
+        if (task.hasDue()) out_.write(Utils::formatDate(task.getDue()));
+        else out_.fill(10, ' ');
+        out_.write(' ');
+    }
+    if (layout.showPriority) {
+        if (task.getPriority() != Task::MIN_PRIORITY) {
+            out_.write('!');
+            out_.write(static_cast<char>('0' + task.getPriority()));
+        } else {
+            out_.write("  ");
+        }
+        out_.write(' ');
+    }
+
+    auto desc = task.getDescription();
+    size_t field = static_cast<size_t>(layout.descWidth);
+    size_t descWidth = displayWidth(desc);
+    if (descWidth > field) {
+        std::string_view cut = prefixColumns(desc, field - 3);
+        out_.write(cut);
+        out_.write("...");
+        out_.fill(field - 3 - displayWidth(cut), ' ');
+    } else {
+        out_.write(desc);
+        out_.fill(field - descWidth, ' ');
+    }
+    out_.write(" |\n");
+}
+
+void TableRenderer::appendFooter(int width) {
+    appendRule('-', width);
+    appendTextRow("[P]=Pending [C]=Completed", width);
+    appendRule('=', width);
+}
+
+void TableRenderer::render(const std::vector<Task>& tasks, std::string_view title, bool paginate) {
+    renderAll(tasks, title, paginate);
+}
+
+void TableRenderer::render(const std::vector<const Task*>& tasks, std::string_view title, bool paginate) {
+    renderAll(tasks, title, paginate);
+}
+
+template <typename Tasks>
+void TableRenderer::renderAll(const Tasks& tasks, std::string_view title, bool paginate) {
+    TerminalSize term = terminalSize(out_.fd());
+    paginate = paginate && term.isTerminal;
+    int width = width_ > 0 ? width_ : (term.isTerminal ? term.columns : DEFAULT_WIDTH);
+    Layout layout = computeLayout(tasks, std::max(width, MIN_WIDTH));
+
+    appendRule('=', layout.width);
+    appendTextRow(title, layout.width);
+    appendRule('-', layout.width);
+
+    // Header + footer take 6 lines, the prompt one more
+    size_t pageRows = static_cast<size_t>(std::max(term.rows - 7, 1));
+    size_t onPage = 0;
+    for (const auto& task : tasks) {
+        appendTaskRow(deref(task), layout);
+        if (paginate && ++onPage == pageRows) {
+            onPage = 0;
+            if (!promptNextPage()) break;
+        }
+    }
+
+    appendFooter(layout.width);
+}
+
+bool TableRenderer::promptNextPage() {
+    out_.write("-- More -- (Enter: next page, q: stop) ");
+    out_.flush();
+    std::string answer;
+    if (!std::getline(std::cin, answer)) return false;
+    return answer.empty() || (answer[0] != 'q' && answer[0] != 'Q');
+}
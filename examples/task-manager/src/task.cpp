@@ -1,29 +1,116 @@
 #include "task.h"
+#include "footprint.h"
+#include <algorithm>
 #include <stdexcept>
+#include <utility>
 
-Task::Task() : id_(0), completed_(false) {}
+Task::Task() : id_(0), completed_(false), priority_(MIN_PRIORITY), due_(NO_DUE), completedAt_(UNKNOWN_TIME) {}
 
-Task::Task(int id, const std::string& desc, bool comp)
-    : id_(id), description_(desc), completed_(comp) {}
+Task::Task(int id, std::string desc, bool comp)
+    : id_(id),
+      description_(std::move(desc)),
+      completed_(comp),
+      priority_(MIN_PRIORITY),
+      due_(NO_DUE),
+      completedAt_(UNKNOWN_TIME) {}
 
 int Task::getId() const { return id_; }
 
-std::string Task::getDescription() const { return description_; }
+std::string_view Task::getDescription() const { return description_; }
 
 bool Task::isCompleted() const { return completed_; }
 
-void Task::setDescription(const std::string& desc) {
+int Task::getPriority() const { return priority_; }
+
+std::int64_t Task::getDue() const { return due_; }
+
+bool Task::hasDue() const { return due_ != NO_DUE; }
+
+std::int64_t Task::getCompletedAt() const { return completedAt_; }
+
+const std::vector<std::string>& Task::getTags() const { return tags_; }
+
+bool Task::hasTag(std::string_view tag) const {
+    return std::find(tags_.begin(), tags_.end(), tag) != tags_.end();
+}
+
+size_t Task::heapBytes() const {
+    size_t bytes = Footprint::of(description_) + Footprint::of(tags_);
+    for (const auto& tag : tags_) bytes += Footprint::of(tag);
+    return bytes;
+}
+
+void Task::setDescription(std::string desc) {
     if (desc.empty()) {
         throw std::invalid_argument("Description cannot be empty");
     }
-    description_ = desc;
+    description_ = std::move(desc);
 }
 
 void Task::setCompleted(bool comp) { completed_ = comp; }
 
+void Task::setPriority(int priority) {
+    if (priority < MIN_PRIORITY || priority > MAX_PRIORITY) {
+        throw std::invalid_argument("Priority must be between " + std::to_string(MIN_PRIORITY) +
+                                    " and " + std::to_string(MAX_PRIORITY));
+    }
+    priority_ = priority;
+}
+
+void Task::setDue(std::int64_t due) {
+    if (due < 0) {
+        throw std::invalid_argument("Due date cannot be before 1970-01-01");
+    }
+    due_ = due;
+}
+
+void Task::setCompletedAt(std::int64_t timestamp) {
+    if (timestamp < 0) {
+        throw std::invalid_argument("Completion time cannot be before 1970-01-01");
+    }
+    completedAt_ = timestamp;
+}
+
+bool Task::addTag(std::string tag) {
+    if (!isValidTag(tag)) {
+        throw std::invalid_argument("Invalid tag: '" + tag + "'");
+    }
+    if (hasTag(tag)) return false;
+    tags_.push_back(std::move(tag));
+    return true;
+}
+
+bool Task::removeTag(std::string_view tag) {
+    auto it = std::find(tags_.begin(), tags_.end(), tag);
+    if (it == tags_.end()) return false;
+    tags_.erase(it);
+    return true;
+}
+
 std::string Task::toString() const {
-    return "ID: " + std::to_string(id_) + " | Desc: " + description_ +
-           " | Completed: " + (completed_ ? "Yes" : "No");
+    std::string out = "ID: " + std::to_string(id_) + " | Desc: " + description_ +
+                      " | Completed: " + (completed_ ? "Yes" : "No") +
+                      " | Priority: " + std::to_string(priority_);
+    if (hasDue()) out += " | Due: " + std::to_string(due_);
+    if (!tags_.empty()) {
+        out += " | Tags:";
+        for (const auto& tag : tags_) out += " " + tag;
+    }
+    return out;
 }
 
-bool Task::validate() const { return !description_.empty(); }
\ No newline at end of file
+bool Task::validate() const {
+    if (description_.empty()) return false;
+    if (priority_ < MIN_PRIORITY || priority_ > MAX_PRIORITY) return false;
+    if (due_ < 0) return false;
+    if (completedAt_ < 0) return false;
+    return std::all_of(tags_.begin(), tags_.end(), isValidTag);
+}
+
+// Tags are single words so they survive the whitespace-separated CLI syntax
+bool Task::isValidTag(std::string_view tag) {
+    if (tag.empty() || tag.size() > 32) return false;
+    return std::none_of(tag.begin(), tag.end(), [](char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '"';
+    });
+}
@@ -0,0 +1,227 @@
+#include "task_json.h"
+#include "trace.h"
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+
+namespace TaskJson {
+
+namespace {
+
+enum : std::uint8_t { PLAIN = 0, ESCAPE = 1, MULTIBYTE = 2 };
+
+constexpr std::array<std::uint8_t, 256> makeByteClasses() {
+    std::array<std::uint8_t, 256> classes{};
+    for (int c = 0; c < 0x20; ++c) classes[static_cast<size_t>(c)] = ESCAPE;
+    classes['"'] = ESCAPE;
+    classes['\\'] = ESCAPE;
+    for (int c = 0x80; c < 0x100; ++c) classes[static_cast<size_t>(c)] = MULTIBYTE;
+    return classes;
+}
+
+constexpr auto BYTE_CLASSES = makeByteClasses();
+
+void appendEscape(std::string& out, unsigned char c) {
+    switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default: {
+            static constexpr char HEX[] = "0123456789abcdef";
+            char buf[6] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF]};
+            out.append(buf, sizeof(buf));
+            break;
+        }
+    }
+}
+
+template <typename Int>
+void appendInt(std::string& out, Int value) {
+    char buf[24];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, end);
+}
+
+void appendBool(std::string& out, bool value) { out += value ? "true" : "false"; }
+
+// Key/value separators and indentation for both styles, so write() has one code path
+struct Layout {
+    std::string_view colon;
+    std::string_view taskOpen;   // Newline + indent before each task object
+    std::string_view field;      // Newline + indent before each task field
+    std::string_view taskClose;  // Before a task's closing "}"
+    std::string_view tagOpen;    // Before each tag
+    std::string_view tagClose;   // Before the tag list's closing "]"
+    std::string_view topField;   // Before each top-level key
+    std::string_view listClose;  // Before the tasks array's closing "]"
+    std::string_view docClose;   // Before the document's closing "}"
+};
+
+constexpr Layout PRETTY{": ",
+                        "\n        ",
+                        "\n            ",
+                        "\n        ",
+                        "\n                ",
+                        "\n            ",
+                        "\n    ",
+                        "\n    ",
+                        "\n"};
+constexpr Layout COMPACT{":", "", "", "", "", "", "", "", ""};
+
+void appendKey(std::string& out, const Layout& layout, std::string_view indent, std::string_view quotedKey) {
+    out += indent;
+    out += quotedKey;
+    out += layout.colon;
+}
+
+void appendTask(std::string& out, const Layout& layout, const Task& task) {
+    out += '{';
+    appendKey(out, layout, layout.field, "\"completed\"");
+    appendBool(out, task.isCompleted());
+    out += ',';
+    appendKey(out, layout, layout.field, "\"completedAt\"");
+    appendInt(out, task.getCompletedAt());
+    out += ',';
+    appendKey(out, layout, layout.field, "\"description\"");
+    appendString(out, task.getDescription());
+    out += ',';
+    appendKey(out, layout, layout.field, "\"due\"");
+    appendInt(out, task.getDue());
+    out += ',';
+    appendKey(out, layout, layout.field, "\"id\"");
+    appendInt(out, task.getId());
+    out += ',';
+    appendKey(out, layout, layout.field, "\"priority\"");
+    appendInt(out, task.getPriority());
+    out += ',';
+    appendKey(out, layout, layout.field, "\"tags\"");
+    out += '[';
+    const auto& tags = task.getTags();
+    for (size_t t = 0; t < tags.size(); ++t) {
+        if (t) out += ',';
+        out += layout.tagOpen;
+        appendString(out, tags[t]);
+    }
+    if (!tags.empty()) out += layout.tagClose;
+    out += ']';
+    out += layout.taskClose;
+    out += '}';
+}
+
+}  // namespace
+
+namespace detail {
+
+size_t utf8SequenceLength(std::string_view s, size_t i) {
+    auto byte = [&](size_t k) { return i + k < s.size() ? static_cast<unsigned char>(s[i + k]) : 0u; };
+    auto cont = [&](size_t k, unsigned lo = 0x80, unsigned hi = 0xBF) { return byte(k) >= lo && byte(k) <= hi; };
+    unsigned lead = byte(0);
+    if (lead >= 0xC2 && lead <= 0xDF) return cont(1) ? 2 : 0;
+    if (lead == 0xE0) return cont(1, 0xA0) && cont(2) ? 3 : 0;
+    if (lead == 0xED) return cont(1, 0x80, 0x9F) && cont(2) ? 3 : 0;  // No surrogates
+    if (lead >= 0xE1 && lead <= 0xEF) return cont(1) && cont(2) ? 3 : 0;
+    if (lead == 0xF0) return cont(1, 0x90) && cont(2) && cont(3) ? 4 : 0;
+    if (lead == 0xF4) return cont(1, 0x80, 0x8F) && cont(2) && cont(3) ? 4 : 0;
+    if (lead >= 0xF1 && lead <= 0xF3) return cont(1) && cont(2) && cont(3) ? 4 : 0;
+    return 0;
+}
+
+}  // namespace detail
+
+void appendString(std::string& out, std::string_view text) {
+    out += '"';
+    size_t runStart = 0;
+    size_t i = 0;
+    while (i < text.size()) {
+        auto c = static_cast<unsigned char>(text[i]);
+        std::uint8_t cls = BYTE_CLASSES[c];
+        if (cls == PLAIN) {
+            ++i;
+            continue;
+        }
+        if (cls == MULTIBYTE) {
+            size_t len = detail::utf8SequenceLength(text, i);
+            if (len == 0) {
+                throw std::runtime_error("Invalid UTF-8 in task text at byte " + std::to_string(i));
+            }
+            i += len;
+            continue;
+        }
+        out.append(text.data() + runStart, i - runStart);
+        appendEscape(out, c);
+        runStart = ++i;
+    }
+    out.append(text.data() + runStart, text.size() - runStart);
+    out += '"';
+}
+
+void write(std::string& out, const std::vector<Task>& tasks, int nextId, Style style) {
+    const Layout& layout = style == Style::Pretty ? PRETTY : COMPACT;
+    out.clear();
+    size_t estimate = 32;
+    for (const auto& task : tasks) estimate += task.getDescription().size() + 180;
+    out.reserve(estimate);
+
+    // Keys appear in the order nlohmann::json's std::map would produce
+    out += '{';
+    appendKey(out, layout, layout.topField, "\"nextId\"");
+    appendInt(out, nextId);
+    out += ',';
+    appendKey(out, layout, layout.topField, "\"tasks\"");
+    out += '[';
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        if (i) out += ',';
+        out += layout.taskOpen;
+        appendTask(out, layout, tasks[i]);
+    }
+    if (!tasks.empty()) out += layout.listClose;
+    out += ']';
+    out += layout.docClose;
+    out += "}\n";
+}
+
+void writeLine(std::string& out, const Task& task) {
+    appendTask(out, COMPACT, task);
+    out += '\n';
+}
+
+void fromDom(nlohmann::json& doc, std::vector<Task>& tasks, int& nextId) {
+    TRACE_SCOPE("TaskJson::fromDom");
+    tasks.clear();
+    if (doc.contains("tasks") && doc["tasks"].is_array()) {
+        auto& items = doc["tasks"];
+        tasks.reserve(items.size());
+        for (auto& item : items) {
+            // Steal the parsed string instead of copying it out of the DOM
+            Task t(
+                item.at("id").get<int>(),
+                std::move(item.at("description").get_ref<std::string&>()),
+                item.at("completed").get<bool>()
+            );
+            // Fields added after the first file format are optional
+            try {
+                t.setPriority(item.value("priority", Task::MIN_PRIORITY));
+                t.setDue(item.value("due", Task::NO_DUE));
+                t.setCompletedAt(item.value("completedAt", Task::UNKNOWN_TIME));
+                if (item.contains("tags")) {
+                    for (auto& tag : item["tags"]) {
+                        t.addTag(std::move(tag.get_ref<std::string&>()));
+                    }
+                }
+            } catch (const std::invalid_argument&) {
+                continue;  // Out-of-range attributes: drop like any other invalid task
+            }
+            if (t.validate()) {
+                tasks.push_back(std::move(t));
+            }
+        }
+    }
+    nextId = doc.contains("nextId") ? doc["nextId"].get<int>() : 1;
+}
+
+}  // namespace TaskJson
@@ -0,0 +1,461 @@
+#include "task_json.h"
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#if defined(__x86_64__) || defined(_M_X64)
+#  define TM_JSON_X86 1
+#  include <immintrin.h>
+#  if defined(__GNUC__) || defined(__clang__)
+#    define TM_JSON_AVX2 1
+#  endif
+#endif
+
+namespace TaskJson {
+
+namespace {
+
+// Scanners for the two hot loops of a task file. scanString returns the index
+// of the first byte at or after i that a string cannot simply copy: a quote, a
+// backslash, a control character or a non-ASCII byte. skipSpace returns the
+// index of the first non-whitespace byte. Both return n when there is none.
+struct Scanners {
+    size_t (*scanString)(const char* p, size_t i, size_t n);
+    size_t (*skipSpace)(const char* p, size_t i, size_t n);
+};
+
+size_t scanStringScalar(const char* p, size_t i, size_t n) {
+    for (; i < n; ++i) {
+        auto c = static_cast<unsigned char>(p[i]);
+        if (c == '"' || c == '\\' || c < 0x20 || c >= 0x80) return i;
+    }
+    return n;
+}
+
+bool isSpace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+size_t skipSpaceScalar(const char* p, size_t i, size_t n) {
+    while (i < n && isSpace(p[i])) ++i;
+    return i;
+}
+
+#ifdef TM_JSON_X86
+size_t scanStringSse2(const char* p, size_t i, size_t n) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(0x20);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        // Signed compare: bytes >= 0x80 are negative, so one test catches controls and non-ASCII
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                       _mm_cmplt_epi8(v, space));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+        if (mask) return i + static_cast<size_t>(std::countr_zero(mask));
+    }
+    return scanStringScalar(p, i, n);
+}
+
+size_t skipSpaceSse2(const char* p, size_t i, size_t n) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i tab = _mm_set1_epi8('\t');
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, newline)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, tab)));
+        auto mask = ~static_cast<unsigned>(_mm_movemask_epi8(ws)) & 0xFFFFu;
+        if (mask) return i + static_cast<size_t>(std::countr_zero(mask));
+    }
+    return skipSpaceScalar(p, i, n);
+}
+#endif
+
+#ifdef TM_JSON_AVX2
+__attribute__((target("avx2"))) size_t scanStringAvx2(const char* p, size_t i, size_t n) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i space = _mm256_set1_epi8(0x20);
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        // AVX2 has only a signed greater-than: space > v catches controls and non-ASCII
+        __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                                          _mm256_cmpgt_epi8(space, v));
+        auto mask = static_cast<unsigned>(_mm256_movemask_epi8(special));
+        if (mask) return i + static_cast<size_t>(std::countr_zero(mask));
+    }
+    return scanStringSse2(p, i, n);
+}
+
+__attribute__((target("avx2"))) size_t skipSpaceAvx2(const char* p, size_t i, size_t n) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, newline)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, tab)));
+        auto mask = ~static_cast<unsigned>(_mm256_movemask_epi8(ws));
+        if (mask) return i + static_cast<size_t>(std::countr_zero(mask));
+    }
+    return skipSpaceSse2(p, i, n);
+}
+#endif
+
+Isa detectIsa() {
+#ifdef TM_JSON_AVX2
+    if (__builtin_cpu_supports("avx2")) return Isa::Avx2;
+#endif
+#ifdef TM_JSON_X86
+    return Isa::Sse2;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+std::atomic<Isa>& isaSetting() {
+    static std::atomic<Isa> isa{detectIsa()};
+    return isa;
+}
+
+Scanners scannersFor(Isa isa) {
+    switch (isa) {
+#ifdef TM_JSON_AVX2
+        case Isa::Avx2:
+            return {scanStringAvx2, skipSpaceAvx2};
+#endif
+#ifdef TM_JSON_X86
+        case Isa::Sse2:
+            return {scanStringSse2, skipSpaceSse2};
+#endif
+        default:
+            return {scanStringScalar, skipSpaceScalar};
+    }
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void appendUtf8(std::string& out, std::uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+enum Field : unsigned {
+    ID = 1u << 0,
+    DESCRIPTION = 1u << 1,
+    COMPLETED = 1u << 2,
+    PRIORITY = 1u << 3,
+    DUE = 1u << 4,
+    TAGS = 1u << 5,
+    COMPLETED_AT = 1u << 6,
+};
+
+bool fitsInt(std::int64_t value) {
+    return value >= std::numeric_limits<int>::min() && value <= std::numeric_limits<int>::max();
+}
+
+/// Recursive-descent parser for exactly the task-file schema. Every method
+/// returns false on anything it does not handle; nothing throws.
+class Reader {
+public:
+    Reader(std::string_view text, Scanners scan) : text_(text), p_(text.data()), n_(text.size()), scan_(scan) {}
+
+    bool document(std::vector<Task>& tasks, int& nextId) {
+        if (!consume('{')) return false;
+        bool seenTasks = false;
+        bool seenNextId = false;
+        if (!consume('}')) {
+            do {
+                if (!key()) return false;
+                if (key_ == "tasks" && !seenTasks) {
+                    seenTasks = true;
+                    if (!taskList(tasks)) return false;
+                } else if (key_ == "nextId" && !seenNextId) {
+                    seenNextId = true;
+                    std::int64_t value;
+                    if (!integer(value) || !fitsInt(value)) return false;
+                    nextId = static_cast<int>(value);
+                } else {
+                    return false;  // Unknown or duplicate key
+                }
+            } while (consume(','));
+            if (!consume('}')) return false;
+        }
+        skipSpace();
+        return pos_ == n_;
+    }
+
+    // A single task object, as written by writeLine()
+    bool line(std::vector<Task>& tasks) {
+        if (!task(tasks)) return false;
+        skipSpace();
+        return pos_ == n_;
+    }
+
+private:
+    std::string_view text_;
+    const char* p_;
+    size_t n_;
+    size_t pos_ = 0;
+    Scanners scan_;
+    std::string key_;
+    std::string scratch_;
+
+    void skipSpace() { pos_ = scan_.skipSpace(p_, pos_, n_); }
+
+    bool consume(char c) {
+        skipSpace();
+        if (pos_ < n_ && p_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    bool key() { return string(key_) && consume(':'); }
+
+    bool string(std::string& out) {
+        if (!consume('"')) return false;
+        out.clear();
+        for (;;) {
+            size_t stop = scan_.scanString(p_, pos_, n_);
+            out.append(p_ + pos_, stop - pos_);
+            pos_ = stop;
+            if (pos_ == n_) return false;
+            auto c = static_cast<unsigned char>(p_[pos_]);
+            if (c == '"') {
+                ++pos_;
+                return true;
+            }
+            if (c == '\\') {
+                if (!escape(out)) return false;
+            } else if (c >= 0x80) {
+                size_t len = detail::utf8SequenceLength(text_, pos_);
+                if (len == 0) return false;
+                out.append(p_ + pos_, len);
+                pos_ += len;
+            } else {
+                return false;  // Raw control character
+            }
+        }
+    }
+
+    bool hex4(std::uint32_t& value) {
+        if (n_ - pos_ < 4) return false;
+        value = 0;
+        for (int k = 0; k < 4; ++k) {
+            int digit = hexValue(p_[pos_++]);
+            if (digit < 0) return false;
+            value = value << 4 | static_cast<std::uint32_t>(digit);
+        }
+        return true;
+    }
+
+    bool escape(std::string& out) {
+        if (++pos_ == n_) return false;
+        char c = p_[pos_++];
+        switch (c) {
+            case '"': out += '"'; return true;
+            case '\\': out += '\\'; return true;
+            case '/': out += '/'; return true;
+            case 'b': out += '\b'; return true;
+            case 'f': out += '\f'; return true;
+            case 'n': out += '\n'; return true;
+            case 'r': out += '\r'; return true;
+            case 't': out += '\t'; return true;
+            case 'u': break;
+            default: return false;
+        }
+        std::uint32_t cp;
+        if (!hex4(cp)) return false;
+        if (cp >= 0xDC00 && cp <= 0xDFFF) return false;  // Lone low surrogate
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+            std::uint32_t low;
+            if (n_ - pos_ < 2 || p_[pos_] != '\\' || p_[pos_ + 1] != 'u') return false;
+            pos_ += 2;
+            if (!hex4(low) || low < 0xDC00 || low > 0xDFFF) return false;
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        }
+        appendUtf8(out, cp);
+        return true;
+    }
+
+    // JSON integers only: fractions, exponents and values beyond int64 are left to nlohmann
+    bool integer(std::int64_t& value) {
+        skipSpace();
+        size_t start = pos_;
+        if (pos_ < n_ && p_[pos_] == '-') ++pos_;
+        if (pos_ == n_ || p_[pos_] < '0' || p_[pos_] > '9') return false;
+        if (p_[pos_] == '0') {
+            ++pos_;
+        } else {
+            while (pos_ < n_ && p_[pos_] >= '0' && p_[pos_] <= '9') ++pos_;
+        }
+        if (pos_ < n_ && (p_[pos_] == '.' || p_[pos_] == 'e' || p_[pos_] == 'E' || (p_[pos_] >= '0' && p_[pos_] <= '9'))) {
+            return false;
+        }
+        auto [end, ec] = std::from_chars(p_ + start, p_ + pos_, value);
+        return ec == std::errc() && end == p_ + pos_;
+    }
+
+    bool literal(std::string_view word) {
+        if (text_.substr(pos_, word.size()) != word) return false;
+        pos_ += word.size();
+        return true;
+    }
+
+    bool boolean(bool& value) {
+        skipSpace();
+        if (literal("true")) {
+            value = true;
+            return true;
+        }
+        if (literal("false")) {
+            value = false;
+            return true;
+        }
+        return false;
+    }
+
+    bool taskList(std::vector<Task>& tasks) {
+        if (!consume('[')) return false;
+        if (consume(']')) return true;
+        tasks.reserve(n_ / 128);
+        do {
+            if (!task(tasks)) return false;
+        } while (consume(','));
+        return consume(']');
+    }
+
+    bool tagList(std::vector<std::string>& tags) {
+        if (!consume('[')) return false;
+        if (consume(']')) return true;
+        do {
+            if (!string(scratch_)) return false;
+            tags.push_back(std::move(scratch_));
+        } while (consume(','));
+        return consume(']');
+    }
+
+    bool task(std::vector<Task>& tasks) {
+        if (!consume('{')) return false;
+        unsigned seen = 0;
+        std::int64_t id = 0;
+        std::string description;
+        bool completed = false;
+        std::int64_t priority = Task::MIN_PRIORITY;
+        std::int64_t due = Task::NO_DUE;
+        std::int64_t completedAt = Task::UNKNOWN_TIME;
+        std::vector<std::string> tags;
+        if (!consume('}')) {
+            do {
+                if (!key()) return false;
+                Field field;
+                bool ok;
+                if (key_ == "id") {
+                    field = ID;
+                    ok = integer(id);
+                } else if (key_ == "description") {
+                    field = DESCRIPTION;
+                    ok = string(description);
+                } else if (key_ == "completed") {
+                    field = COMPLETED;
+                    ok = boolean(completed);
+                } else if (key_ == "completedAt") {
+                    field = COMPLETED_AT;
+                    ok = integer(completedAt);
+                } else if (key_ == "priority") {
+                    field = PRIORITY;
+                    ok = integer(priority);
+                } else if (key_ == "due") {
+                    field = DUE;
+                    ok = integer(due);
+                } else if (key_ == "tags") {
+                    field = TAGS;
+                    ok = tagList(tags);
+                } else {
+                    return false;
+                }
+                if (!ok || (seen & field)) return false;
+                seen |= field;
+            } while (consume(','));
+            if (!consume('}')) return false;
+        }
+        if ((seen & (ID | DESCRIPTION | COMPLETED)) != (ID | DESCRIPTION | COMPLETED)) return false;
+        if (!fitsInt(id) || !fitsInt(priority)) return false;
+
+        // Same acceptance rules as fromDom
+        Task t(static_cast<int>(id), std::move(description), completed);
+        try {
+            t.setPriority(static_cast<int>(priority));
+            t.setDue(due);
+            t.setCompletedAt(completedAt);
+            for (auto& tag : tags) t.addTag(std::move(tag));
+        } catch (const std::invalid_argument&) {
+            return true;  // Dropped, like any other invalid task
+        }
+        if (t.validate()) tasks.push_back(std::move(t));
+        return true;
+    }
+};
+
+}  // namespace
+
+Isa activeIsa() { return isaSetting().load(std::memory_order_relaxed); }
+
+Isa bestIsa() { return detectIsa(); }
+
+void setIsa(Isa isa) {
+    isaSetting().store(static_cast<int>(isa) <= static_cast<int>(bestIsa()) ? isa : bestIsa(),
+                       std::memory_order_relaxed);
+}
+
+bool read(std::string_view text, std::vector<Task>& tasks, int& nextId) {
+    std::vector<Task> parsed;
+    int parsedNextId = 1;
+    Reader reader(text, scannersFor(activeIsa()));
+    if (!reader.document(parsed, parsedNextId)) return false;
+    tasks = std::move(parsed);
+    nextId = parsedNextId;
+    return true;
+}
+
+bool readLine(std::string_view line, std::vector<Task>& tasks) {
+    size_t before = tasks.size();
+    Reader reader(line, scannersFor(activeIsa()));
+    if (reader.line(tasks)) return true;
+    tasks.erase(tasks.begin() + static_cast<std::ptrdiff_t>(before), tasks.end());
+    return false;
+}
+
+void readLineDom(std::string_view line, std::vector<Task>& tasks) {
+    nlohmann::json doc = {{"tasks", nlohmann::json::array({nlohmann::json::parse(line)})}};
+    std::vector<Task> parsed;
+    int nextId;
+    fromDom(doc, parsed, nextId);
+    for (auto& task : parsed) tasks.push_back(std::move(task));
+}
+
+}  // namespace TaskJson
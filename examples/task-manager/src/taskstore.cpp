@@ -0,0 +1,139 @@
+#include "taskstore.h"
+#include "storage.h"
+#include <new>
+#include <stdexcept>
+#include <string>
+
+struct ts_store {
+    // Quiet from the start: loading must not print into the host's streams
+    explicit ts_store(const std::string& path) : storage(path, 0, true) {}
+
+    Storage storage;
+    std::string error;  // Only written on failure, so successful calls never allocate
+};
+
+namespace {
+
+ts_status fail(ts_store* store, ts_status status, const char* what) {
+    if (store) store->error = what;
+    return status;
+}
+
+// Run a Storage call, turning its exceptions into status codes. Storage
+// reports file problems as std::runtime_error; IDs are checked beforehand.
+template <typename F>
+ts_status guarded(ts_store* store, F&& body) {
+    try {
+        body();
+    } catch (const std::invalid_argument& e) {
+        return fail(store, TS_INVALID_ARGUMENT, e.what());
+    } catch (const std::runtime_error& e) {
+        return fail(store, TS_IO_ERROR, e.what());
+    } catch (const std::bad_alloc&) {
+        return fail(store, TS_ERROR, "Out of memory");
+    } catch (const std::exception& e) {
+        return fail(store, TS_ERROR, e.what());
+    }
+    store->error.clear();
+    return TS_OK;
+}
+
+void fillTask(const Task& task, ts_task* out) {
+    auto description = task.getDescription();
+    out->id = task.getId();
+    out->completed = task.isCompleted() ? 1 : 0;
+    out->priority = task.getPriority();
+    out->due = task.getDue();
+    out->completed_at = task.getCompletedAt();
+    out->description = description.data();
+    out->description_len = description.size();
+}
+
+}  // namespace
+
+extern "C" {
+
+int ts_api_version(void) { return TS_API_VERSION; }
+
+const char* ts_status_string(ts_status status) {
+    switch (status) {
+        case TS_OK: return "ok";
+        case TS_NOT_FOUND: return "not found";
+        case TS_INVALID_ARGUMENT: return "invalid argument";
+        case TS_IO_ERROR: return "I/O error";
+        case TS_ERROR: return "error";
+    }
+    return "unknown status";
+}
+
+ts_status ts_open(const char* path, ts_store** store) {
+    if (!store) return TS_INVALID_ARGUMENT;
+    *store = nullptr;
+    if (!path || !*path) return TS_INVALID_ARGUMENT;
+    try {
+        *store = new ts_store(path);
+        return TS_OK;
+    } catch (const std::bad_alloc&) {
+        return TS_ERROR;
+    } catch (const std::exception&) {
+        return TS_IO_ERROR;
+    }
+}
+
+void ts_close(ts_store* store) { delete store; }
+
+const char* ts_last_error(const ts_store* store) { return store ? store->error.c_str() : "No store"; }
+
+ts_status ts_add(ts_store* store, const char* description, size_t len, int* id) {
+    if (!store) return TS_INVALID_ARGUMENT;
+    if (!description && len) return fail(store, TS_INVALID_ARGUMENT, "Description is null");
+    int added = 0;
+    ts_status status = guarded(store, [&] { added = store->storage.addTask(std::string(description ? description : "", len)); });
+    if (status == TS_OK && id) *id = added;
+    return status;
+}
+
+ts_status ts_complete(ts_store* store, int id) {
+    if (!store) return TS_INVALID_ARGUMENT;
+    if (!store->storage.findTask(id)) return fail(store, TS_NOT_FOUND, "Task ID not found");
+    return guarded(store, [&] { store->storage.completeTask(id); });
+}
+
+ts_status ts_delete(ts_store* store, int id) {
+    if (!store) return TS_INVALID_ARGUMENT;
+    if (!store->storage.findTask(id)) return fail(store, TS_NOT_FOUND, "Task ID not found");
+    return guarded(store, [&] { store->storage.deleteTask(id); });
+}
+
+ts_status ts_get(const ts_store* store, int id, ts_task* task) {
+    if (!store || !task) return TS_INVALID_ARGUMENT;
+    const Task* found = store->storage.findTask(id);
+    if (!found) return TS_NOT_FOUND;
+    fillTask(*found, task);
+    return TS_OK;
+}
+
+size_t ts_count(const ts_store* store) { return store ? store->storage.getTaskCount() : 0; }
+
+ts_status ts_iterate(const ts_store* store, ts_visit_fn visit, void* user) {
+    if (!store || !visit) return TS_INVALID_ARGUMENT;
+    ts_task view;
+    for (const auto& task : store->storage.getAllTasks()) {
+        fillTask(task, &view);
+        if (visit(&view, user)) break;
+    }
+    return TS_OK;
+}
+
+ts_status ts_set_autosave(ts_store* store, int enabled) {
+    if (!store) return TS_INVALID_ARGUMENT;
+    store->storage.setAutoSave(enabled != 0);
+    return TS_OK;
+}
+
+ts_status ts_save(ts_store* store) {
+    if (!store) return TS_INVALID_ARGUMENT;
+    return guarded(store, [&] { store->storage.save(); });
+}
+
+}  // extern "C"
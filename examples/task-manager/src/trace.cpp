@@ -0,0 +1,193 @@
+#include "trace.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace Trace {
+
+namespace detail {
+std::atomic<bool> enabled{false};
+}
+
+namespace {
+
+struct Slot {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<std::int64_t> start{0};
+    std::atomic<std::int64_t> end{0};
+};
+
+// Single-producer ring: only the owning thread advances head. Readers copy
+// slots and then discard any the producer may have overwritten meanwhile.
+struct Ring {
+    std::array<Slot, RING_CAPACITY> slots;
+    std::atomic<std::uint64_t> head{0};
+    std::atomic<std::uint64_t> floor{0};  // Spans before this were cleared
+    unsigned tid = 0;
+};
+
+struct Event {
+    const char* name;
+    std::int64_t start;
+    std::int64_t end;
+    unsigned tid;
+};
+
+std::mutex registryMutex;
+// Never destroyed: spans may still be recorded from static destructors (the
+// console sink flushes on exit), after a plain static would be gone
+std::vector<std::unique_ptr<Ring>>& rings() {
+    static auto* all = new std::vector<std::unique_ptr<Ring>>;
+    return *all;
+}
+// Rings of threads that have exited, for the next new thread to take over
+std::vector<Ring*>& freeRings() {
+    static auto* free = new std::vector<Ring*>;
+    return *free;
+}
+
+thread_local Ring* localRing = nullptr;
+thread_local bool exiting = false;
+
+// Hands the thread's ring back when the thread exits. The ring keeps its spans
+// (and tid) until a new thread records over them, so a pool rebuilt again and
+// again reuses the same few rings instead of growing the registry.
+struct RingLease {
+    ~RingLease() {
+        exiting = true;
+        if (!localRing) return;
+        std::lock_guard lock(registryMutex);
+        freeRings().push_back(localRing);
+        localRing = nullptr;
+    }
+};
+
+const auto epoch = std::chrono::steady_clock::now();
+
+Ring& ringForThisThread() {
+    if (!localRing) {
+        // Spans recorded by thread_local destructors after the lease has run
+        // keep the ring they take until the thread is gone
+        if (!exiting) {
+            static thread_local RingLease lease;
+            (void)lease;
+        }
+        std::lock_guard lock(registryMutex);
+        if (!freeRings().empty()) {
+            localRing = freeRings().back();
+            freeRings().pop_back();
+        } else {
+            auto ring = std::make_unique<Ring>();
+            ring->tid = static_cast<unsigned>(rings().size() + 1);
+            localRing = ring.get();
+            rings().push_back(std::move(ring));
+        }
+    }
+    return *localRing;
+}
+
+void snapshot(const Ring& ring, std::vector<Event>& out) {
+    std::uint64_t head = ring.head.load(std::memory_order_acquire);
+    std::uint64_t first = std::max(ring.floor.load(std::memory_order_relaxed),
+                                   head >= RING_CAPACITY ? head - (RING_CAPACITY - 1) : 0);
+    size_t mark = out.size();
+    for (std::uint64_t i = first; i < head; ++i) {
+        const Slot& slot = ring.slots[i % RING_CAPACITY];
+        out.push_back({slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed),
+                       slot.end.load(std::memory_order_relaxed), ring.tid});
+    }
+    // Slots the producer reached while we were copying may be torn
+    std::atomic_thread_fence(std::memory_order_acquire);
+    std::uint64_t now = ring.head.load(std::memory_order_relaxed);
+    if (now >= RING_CAPACITY && now - RING_CAPACITY >= first) {
+        size_t stale = static_cast<size_t>(std::min(now - RING_CAPACITY + 1 - first, head - first));
+        out.erase(out.begin() + static_cast<std::ptrdiff_t>(mark),
+                  out.begin() + static_cast<std::ptrdiff_t>(mark + stale));
+    }
+}
+
+std::vector<Event> collect() {
+    std::vector<Event> events;
+    std::lock_guard lock(registryMutex);
+    for (const auto& ring : rings()) snapshot(*ring, events);
+    return events;
+}
+
+void appendEscaped(std::string& out, const char* text) {
+    for (; *text; ++text) {
+        if (*text == '"' || *text == '\\') out += '\\';
+        out += *text;
+    }
+}
+
+}  // namespace
+
+namespace detail {
+
+std::int64_t nowNs() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void record(const char* name, std::int64_t startNs, std::int64_t endNs) noexcept {
+    Ring& ring = ringForThisThread();
+    std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+    Slot& slot = ring.slots[head % RING_CAPACITY];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(startNs, std::memory_order_relaxed);
+    slot.end.store(endNs, std::memory_order_relaxed);
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+}  // namespace detail
+
+void setEnabled(bool on) { detail::enabled.store(on, std::memory_order_relaxed); }
+
+size_t eventCount() { return collect().size(); }
+
+size_t ringCount() {
+    std::lock_guard lock(registryMutex);
+    return rings().size();
+}
+
+void clear() {
+    std::lock_guard lock(registryMutex);
+    for (auto& ring : rings()) ring->floor.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+std::string toChromeJson() {
+    auto events = collect();
+    std::string out;
+    out.reserve(64 + events.size() * 96);
+    out += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    char buf[96];
+    for (size_t i = 0; i < events.size(); ++i) {
+        const Event& e = events[i];
+        out += i ? ",\n" : "\n";
+        out += "{\"name\":\"";
+        appendEscaped(out, e.name);
+        // Complete ("X") events; timestamps are microseconds
+        std::snprintf(buf, sizeof(buf), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", e.tid,
+                      static_cast<double>(e.start) / 1e3, static_cast<double>(e.end - e.start) / 1e3);
+        out += buf;
+    }
+    out += "\n]}\n";
+    return out;
+}
+
+void writeChromeJson(const std::filesystem::path& path) {
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+        throw std::runtime_error("Cannot open trace file for writing: " + path.string());
+    }
+    ofs << toChromeJson();
+    if (!ofs) {
+        throw std::runtime_error("Cannot write trace file: " + path.string());
+    }
+}
+
+}  // namespace Trace
@@ -1,19 +1,13 @@
 #include "utils.h"
+#include "output.h"
 #include <iostream>
 #include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cstdio>
 
 namespace Utils {
 
-void printColored(const std::string& text, const std::string& color) {
-#ifdef _WIN32
-    (void)color;  // Silence unused parameter warning
-    std::cout << text;
-#else
-    std::cout << color << text << RESET;
-#endif
-}
-
 std::string trim(const std::string& str) {
     size_t first = str.find_first_not_of(" \t");
     if (first == std::string::npos) return "";
@@ -22,10 +16,91 @@ std::string trim(const std::string& str) {
 }
 
 bool confirm(const std::string& question) {
-    printColored(question + " (y/n): ", YELLOW);
+    auto& out = OutputSink::console();
+    out.write(question + " (y/n): ", YELLOW);
+    out.flush();
     std::string response;
     std::getline(std::cin, response);
     return !response.empty() && std::tolower(response[0]) == 'y';
 }
 
+bool containsIgnoreCase(std::string_view haystack, std::string_view needle) {
+    auto it = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(), [](char a, char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+    });
+    return it != haystack.end() || needle.empty();
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date (Howard Hinnant's algorithm)
+static std::int64_t daysFromCivil(std::int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const auto yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+bool parseDate(std::string_view text, std::int64_t& timestamp) {
+    // Strictly YYYY-MM-DD
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-') return false;
+    auto field = [&](size_t pos, size_t len, int& out) {
+        auto [ptr, ec] = std::from_chars(text.data() + pos, text.data() + pos + len, out);
+        return ec == std::errc() && ptr == text.data() + pos + len;
+    };
+    int y = 0, m = 0, d = 0;
+    if (!field(0, 4, y) || !field(5, 2, m) || !field(8, 2, d)) return false;
+    if (y < 1970 || m < 1 || m > 12 || d < 1) return false;
+    static const int monthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    if (d > monthDays[m - 1] + (m == 2 && leap ? 1 : 0)) return false;
+    timestamp = daysFromCivil(y, static_cast<unsigned>(m), static_cast<unsigned>(d)) * 86400;
+    return true;
+}
+
+std::string formatDate(std::int64_t timestamp) {
+    // Inverse of daysFromCivil
+    std::int64_t z = timestamp / 86400 + 719468;
+    const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const auto doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    const std::int64_t y = static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2);
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%04lld-%02u-%02u", static_cast<long long>(y), m, d);
+    return buf;
+}
+
+bool parseBytes(std::string_view text, size_t& bytes) {
+    std::uint64_t value = 0;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || end == text.data()) return false;
+    std::string_view unit(end, static_cast<size_t>(text.data() + text.size() - end));
+    unsigned shift = 0;
+    if (unit == "K" || unit == "k") shift = 10;
+    else if (unit == "M" || unit == "m") shift = 20;
+    else if (unit == "G" || unit == "g") shift = 30;
+    else if (!unit.empty()) return false;
+    if (value > (UINT64_MAX >> shift) || (value << shift) > SIZE_MAX) return false;
+    bytes = static_cast<size_t>(value << shift);
+    return true;
+}
+
+std::string formatBytes(size_t bytes) {
+    char buf[32];
+    if (bytes < 1024) {
+        std::snprintf(buf, sizeof(buf), "%zu B", bytes);
+    } else if (bytes < (size_t{1} << 20)) {
+        std::snprintf(buf, sizeof(buf), "%.1f KiB", static_cast<double>(bytes) / 1024.0);
+    } else if (bytes < (size_t{1} << 30)) {
+        std::snprintf(buf, sizeof(buf), "%.1f MiB", static_cast<double>(bytes) / (1024.0 * 1024.0));
+    } else {
+        std::snprintf(buf, sizeof(buf), "%.2f GiB", static_cast<double>(bytes) / (1024.0 * 1024.0 * 1024.0));
+    }
+    return buf;
+}
+
 }  // namespace Utils
\ No newline at end of file